@@ -80,6 +80,7 @@ typedef struct {
 	b32   generic;
 	b32   report;
 	b32   sanitize;
+	b32   trace;
 
 	b32   encode_video;
 	c8   *video_name;
@@ -344,23 +345,15 @@ check_rebuild_self(Arena arena, s32 argc, char *argv[])
 	}
 }
 
-function b32
-str8_equal(str8 a, str8 b)
-{
-	b32 result = a.len == b.len;
-	for (sz i = 0; result && i < a.len; i++)
-		result = a.data[i] == b.data[i];
-	return result;
-}
-
 function void
 usage(char *argv0)
 {
-	die("%s [--debug] [--report] [--sanitize] [--encode-video 'output']\n"
+	die("%s [--debug] [--report] [--sanitize] [--trace] [--encode-video 'output']\n"
 	    "    --debug:         dynamically link and build with debug symbols\n"
 	    "    --generic:       compile for a generic target (x86-64-v3 or armv8 with NEON)\n"
 	    "    --report:        print compilation stats (clang only)\n"
 	    "    --sanitize:      build with ASAN and UBSAN\n"
+	    "    --trace:         keep CPU trace zones in release builds\n"
 	    "    --encode-video:  encode '" RAW_OUTPUT_PATH "' to 'output'\n"
 	    , argv0);
 }
@@ -386,6 +379,8 @@ parse_options(s32 argc, char *argv[])
 			result.report = 1;
 		} else if (str8_equal(str, str8("--sanitize"))) {
 			result.sanitize = 1;
+		} else if (str8_equal(str, str8("--trace"))) {
+			result.trace = 1;
 		} else {
 			usage(argv0);
 		}
@@ -416,6 +411,8 @@ cmd_base(Arena *a, Options *o)
 
 	if (o->sanitize) cmd_append(a, &result, "-fsanitize=address,undefined");
 
+	if (o->trace) cmd_append(a, &result, "-DCPU_TRACE=1");
+
 	if (o->report) {
 		if (is_clang) cmd_append(a, &result, "-fproc-stat-report");
 		else printf("warning: timing not supported with this compiler\n");
@@ -438,7 +435,7 @@ function void
 cmd_append_ldflags(Arena *a, CommandList *cc, b32 shared)
 {
 	cmd_pdb(a, cc);
-	if (is_w32)  cmd_append(a, cc, "-lopengl32", "-lgdi32", "-lwinmm");
+	if (is_w32)  cmd_append(a, cc, "-lopengl32", "-lgdi32", "-lwinmm", "-lsynchronization");
 	if (is_unix) cmd_append(a, cc, "-lGL");
 }
 
@@ -0,0 +1,493 @@
+/* See LICENSE for license details. */
+/* NOTE(rnp): dependency free frame encoders. All encoders take frames as read back from
+ * OpenGL with GL_RGBA/GL_UNSIGNED_INT_8_8_8_8: one u32 per pixel laid out as 0xRRGGBBAA
+ * with the bottom row first. Output is written top row first.
+ *
+ * QOI:  https://qoiformat.org/qoi-specification.pdf
+ * JPEG: ITU T.81 baseline sequential DCT, Huffman coded, 4:2:0 chroma subsampling
+ * AVI:  RIFF AVI 1.0 with an idx1 index; sizes are 32-bit so files must stay below 4GB
+ */
+
+#define QOI_HEADER_SIZE 14
+#define QOI_END_SIZE     8
+
+/* NOTE(rnp): worst case size of an encoded frame for any of the encoders below */
+#define ENCODED_FRAME_SIZE_BOUND(w, h) ((sz)(w) * (sz)(h) * 5 + KB(4))
+
+typedef struct {
+	u32 index[64];
+	u32 previous;
+	u32 run;
+} QOIEncoder;
+
+function void
+stream_append_u16_be(Stream *s, u16 n)
+{
+	u8 bytes[2] = {n >> 8, n & 0xFF};
+	stream_append(s, bytes, sizeof(bytes));
+}
+
+function void
+stream_append_u32_be(Stream *s, u32 n)
+{
+	u8 bytes[4] = {n >> 24, (n >> 16) & 0xFF, (n >> 8) & 0xFF, n & 0xFF};
+	stream_append(s, bytes, sizeof(bytes));
+}
+
+function void
+stream_append_u16_le(Stream *s, u16 n)
+{
+	u8 bytes[2] = {n & 0xFF, n >> 8};
+	stream_append(s, bytes, sizeof(bytes));
+}
+
+function void
+stream_append_u32_le(Stream *s, u32 n)
+{
+	u8 bytes[4] = {n & 0xFF, (n >> 8) & 0xFF, (n >> 16) & 0xFF, n >> 24};
+	stream_append(s, bytes, sizeof(bytes));
+}
+
+/* NOTE(rnp): the QOI encoder can be fed pixels in pieces (e.g. one row at a time) */
+function void
+qoi_encode_begin(Stream *s, QOIEncoder *e, u32 width, u32 height)
+{
+	zero_struct(e);
+	e->previous = 0x000000FFUL;
+	stream_append(s, "qoif", 4);
+	stream_append_u32_be(s, width);
+	stream_append_u32_be(s, height);
+	stream_append_byte(s, 4); /* channels   */
+	stream_append_byte(s, 0); /* colorspace */
+}
+
+function void
+qoi_flush_run(Stream *s, QOIEncoder *e)
+{
+	if (e->run) {
+		stream_append_byte(s, 0xC0 | (e->run - 1));
+		e->run = 0;
+	}
+}
+
+function void
+qoi_encode_pixels(Stream *s, QOIEncoder *e, u32 *pixels, sz count)
+{
+	for (sz i = 0; i < count; i++) {
+		u32 p = pixels[i];
+		if (p == e->previous) {
+			if (++e->run == 62) qoi_flush_run(s, e);
+			continue;
+		}
+		qoi_flush_run(s, e);
+
+		u8 r  = p >> 24, g  = p >> 16, b  = p >> 8, a  = p;
+		u8 pr = e->previous >> 24, pg = e->previous >> 16, pb = e->previous >> 8;
+		u8 pa = e->previous;
+
+		u32 index = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+		if (e->index[index] == p) {
+			stream_append_byte(s, index);
+		} else {
+			e->index[index] = p;
+			if (a == pa) {
+				s8 dr = r - pr, dg = g - pg, db = b - pb;
+				s8 dr_dg = dr - dg, db_dg = db - dg;
+				if (BETWEEN(dr, -2, 1) && BETWEEN(dg, -2, 1) && BETWEEN(db, -2, 1)) {
+					stream_append_byte(s, 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+				} else if (BETWEEN(dg, -32, 31) && BETWEEN(dr_dg, -8, 7) && BETWEEN(db_dg, -8, 7)) {
+					stream_append_byte(s, 0x80 | (dg + 32));
+					stream_append_byte(s, (dr_dg + 8) << 4 | (db_dg + 8));
+				} else {
+					u8 op[4] = {0xFE, r, g, b};
+					stream_append(s, op, sizeof(op));
+				}
+			} else {
+				u8 op[5] = {0xFF, r, g, b, a};
+				stream_append(s, op, sizeof(op));
+			}
+		}
+		e->previous = p;
+	}
+}
+
+function void
+qoi_encode_end(Stream *s, QOIEncoder *e)
+{
+	qoi_flush_run(s, e);
+	u8 end[QOI_END_SIZE] = {0, 0, 0, 0, 0, 0, 0, 1};
+	stream_append(s, end, sizeof(end));
+}
+
+function void
+qoi_encode_frame(Stream *s, u32 *pixels, u32 width, u32 height)
+{
+	QOIEncoder e;
+	qoi_encode_begin(s, &e, width, height);
+	for (u32 y = height; y > 0; y--)
+		qoi_encode_pixels(s, &e, pixels + (y - 1) * width, width);
+	qoi_encode_end(s, &e);
+}
+
+read_only global u8 jpeg_zigzag[64] = {
+	 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+read_only global u8 jpeg_luma_quantization[64] = {
+	16,  11,  10,  16,  24,  40,  51,  61,
+	12,  12,  14,  19,  26,  58,  60,  55,
+	14,  13,  16,  24,  40,  57,  69,  56,
+	14,  17,  22,  29,  51,  87,  80,  62,
+	18,  22,  37,  56,  68, 109, 103,  77,
+	24,  35,  55,  64,  81, 104, 113,  92,
+	49,  64,  78,  87, 103, 121, 120, 101,
+	72,  92,  95,  98, 112, 100, 103,  99,
+};
+
+read_only global u8 jpeg_chroma_quantization[64] = {
+	17, 18, 24, 47, 99, 99, 99, 99,
+	18, 21, 26, 66, 99, 99, 99, 99,
+	24, 26, 56, 99, 99, 99, 99, 99,
+	47, 66, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+/* NOTE(rnp): standard huffman tables from ITU T.81 Annex K.3 */
+read_only global u8 jpeg_dc_luma_bits[16]   = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+read_only global u8 jpeg_dc_chroma_bits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+read_only global u8 jpeg_dc_values[12]      = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+read_only global u8 jpeg_ac_luma_bits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D};
+read_only global u8 jpeg_ac_luma_values[162] = {
+	0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+	0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+	0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+	0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+	0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+	0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+	0xF9, 0xFA,
+};
+
+read_only global u8 jpeg_ac_chroma_bits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+read_only global u8 jpeg_ac_chroma_values[162] = {
+	0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+	0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+	0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+	0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+	0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+	0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+	0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+	0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+	0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+	0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+	0xF9, 0xFA,
+};
+
+typedef struct {
+	Stream *stream;
+	u64     bits;
+	u32     bit_count;
+} JPEGBitWriter;
+
+function void
+jpeg_build_huffman_table(JPEGHuffmanTable *t, u8 *bits, u8 *values)
+{
+	u32 code = 0, k = 0;
+	for (u32 length = 1; length <= 16; length++) {
+		for (u32 i = 0; i < bits[length - 1]; i++, k++) {
+			t->codes[values[k]] = code++;
+			t->sizes[values[k]] = length;
+		}
+		code <<= 1;
+	}
+}
+
+/* NOTE(rnp): uses trig functions; call once before handing the tables to worker threads */
+function void
+jpeg_init_tables(JPEGTables *t, u32 quality)
+{
+	quality   = CLAMP(quality, 1, 100);
+	u32 scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+	for (u32 i = 0; i < 64; i++) {
+		u32 luma   = (jpeg_luma_quantization[i]   * scale + 50) / 100;
+		u32 chroma = (jpeg_chroma_quantization[i] * scale + 50) / 100;
+		t->quantization[0][i]       = CLAMP(luma,   1, 255);
+		t->quantization[1][i]       = CLAMP(chroma, 1, 255);
+		t->quantization_scale[0][i] = 1.0f / t->quantization[0][i];
+		t->quantization_scale[1][i] = 1.0f / t->quantization[1][i];
+	}
+
+	for (u32 u = 0; u < 8; u++) {
+		f32 c = u == 0 ? sqrt_f32(0.5f) : 1.0f;
+		for (u32 x = 0; x < 8; x++)
+			t->dct[u][x] = 0.5f * c * cos_f32((2 * x + 1) * u * PI / 16);
+	}
+
+	jpeg_build_huffman_table(t->huffman + 0, jpeg_dc_luma_bits,   jpeg_dc_values);
+	jpeg_build_huffman_table(t->huffman + 1, jpeg_ac_luma_bits,   jpeg_ac_luma_values);
+	jpeg_build_huffman_table(t->huffman + 2, jpeg_dc_chroma_bits, jpeg_dc_values);
+	jpeg_build_huffman_table(t->huffman + 3, jpeg_ac_chroma_bits, jpeg_ac_chroma_values);
+}
+
+function void
+jpeg_put_bits(JPEGBitWriter *w, u32 code, u32 length)
+{
+	w->bits       = (w->bits << length) | (code & ((1UL << length) - 1));
+	w->bit_count += length;
+	while (w->bit_count >= 8) {
+		u8 byte = w->bits >> (w->bit_count - 8);
+		stream_append_byte(w->stream, byte);
+		/* NOTE(rnp): byte stuffing */
+		if (byte == 0xFF) stream_append_byte(w->stream, 0);
+		w->bit_count -= 8;
+	}
+}
+
+function void
+jpeg_flush_bits(JPEGBitWriter *w)
+{
+	if (w->bit_count) {
+		u32 pad = 8 - w->bit_count;
+		jpeg_put_bits(w, (1UL << pad) - 1, pad);
+	}
+}
+
+function u32
+jpeg_magnitude_category(s32 value)
+{
+	u32 result = 0;
+	for (u32 v = value < 0 ? -value : value; v; v >>= 1)
+		result++;
+	return result;
+}
+
+function s32
+jpeg_encode_block(JPEGBitWriter *w, JPEGTables *t, f32 block[64], u32 component, s32 previous_dc)
+{
+	f32 tmp[64], coefficients[64];
+	/* NOTE(rnp): separable DCT-II: rows then columns */
+	for (u32 y = 0; y < 8; y++) {
+		for (u32 u = 0; u < 8; u++) {
+			f32 sum = 0;
+			for (u32 x = 0; x < 8; x++) sum += t->dct[u][x] * block[y * 8 + x];
+			tmp[y * 8 + u] = sum;
+		}
+	}
+	for (u32 u = 0; u < 8; u++) {
+		for (u32 v = 0; v < 8; v++) {
+			f32 sum = 0;
+			for (u32 y = 0; y < 8; y++) sum += t->dct[v][y] * tmp[y * 8 + u];
+			coefficients[v * 8 + u] = sum;
+		}
+	}
+
+	s32 quantized[64];
+	u32 table = component ? 1 : 0;
+	for (u32 i = 0; i < 64; i++) {
+		u32 n = jpeg_zigzag[i];
+		f32 q = coefficients[n] * t->quantization_scale[table][n];
+		quantized[i] = (s32)(q < 0 ? q - 0.5f : q + 0.5f);
+	}
+
+	JPEGHuffmanTable *dc = t->huffman + 2 * table;
+	JPEGHuffmanTable *ac = t->huffman + 2 * table + 1;
+
+	s32 diff = quantized[0] - previous_dc;
+	u32 category = jpeg_magnitude_category(diff);
+	jpeg_put_bits(w, dc->codes[category], dc->sizes[category]);
+	if (category) jpeg_put_bits(w, diff < 0 ? diff - 1 : diff, category);
+
+	u32 run = 0;
+	for (u32 i = 1; i < 64; i++) {
+		s32 value = quantized[i];
+		if (value == 0) {
+			run++;
+			continue;
+		}
+		while (run > 15) {
+			jpeg_put_bits(w, ac->codes[0xF0], ac->sizes[0xF0]);
+			run -= 16;
+		}
+		category   = jpeg_magnitude_category(value);
+		u32 symbol = run << 4 | category;
+		jpeg_put_bits(w, ac->codes[symbol], ac->sizes[symbol]);
+		jpeg_put_bits(w, value < 0 ? value - 1 : value, category);
+		run = 0;
+	}
+	/* NOTE(rnp): end of block */
+	if (run) jpeg_put_bits(w, ac->codes[0], ac->sizes[0]);
+
+	return quantized[0];
+}
+
+function void
+jpeg_write_huffman_table(Stream *s, u8 class_and_id, u8 *bits, u8 *values, u32 value_count)
+{
+	stream_append_byte(s, class_and_id);
+	stream_append(s, bits, 16);
+	stream_append(s, values, value_count);
+}
+
+function void
+jpeg_write_headers(Stream *s, JPEGTables *t, u32 width, u32 height)
+{
+	u8 soi_app0[] = {
+		0xFF, 0xD8,
+		0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00,
+		0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+	};
+	stream_append(s, soi_app0, sizeof(soi_app0));
+
+	stream_append_u16_be(s, 0xFFDB);
+	stream_append_u16_be(s, 2 + 2 * 65);
+	for (u32 table = 0; table < 2; table++) {
+		stream_append_byte(s, table);
+		for (u32 i = 0; i < 64; i++)
+			stream_append_byte(s, t->quantization[table][jpeg_zigzag[i]]);
+	}
+
+	u8 sof0[] = {
+		0xFF, 0xC0, 0x00, 0x11, 0x08, height >> 8, height & 0xFF, width >> 8, width & 0xFF,
+		0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01,
+	};
+	stream_append(s, sof0, sizeof(sof0));
+
+	stream_append_u16_be(s, 0xFFC4);
+	stream_append_u16_be(s, 2 + 4 * 17 + 2 * countof(jpeg_dc_values) + 2 * countof(jpeg_ac_luma_values));
+	jpeg_write_huffman_table(s, 0x00, jpeg_dc_luma_bits,   jpeg_dc_values,        countof(jpeg_dc_values));
+	jpeg_write_huffman_table(s, 0x10, jpeg_ac_luma_bits,   jpeg_ac_luma_values,   countof(jpeg_ac_luma_values));
+	jpeg_write_huffman_table(s, 0x01, jpeg_dc_chroma_bits, jpeg_dc_values,        countof(jpeg_dc_values));
+	jpeg_write_huffman_table(s, 0x11, jpeg_ac_chroma_bits, jpeg_ac_chroma_values, countof(jpeg_ac_chroma_values));
+
+	u8 sos[] = {
+		0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3F, 0x00,
+	};
+	stream_append(s, sos, sizeof(sos));
+}
+
+function void
+jpeg_encode_frame(Stream *s, JPEGTables *t, u32 *pixels, u32 width, u32 height)
+{
+	jpeg_write_headers(s, t, width, height);
+
+	JPEGBitWriter w = {.stream = s};
+	s32 previous_dc[3] = {0};
+	for (u32 my = 0; my < height; my += 16) {
+		for (u32 mx = 0; mx < width; mx += 16) {
+			f32 y_blocks[4][64], cb[64] = {0}, cr[64] = {0};
+			for (u32 j = 0; j < 16; j++) {
+				/* NOTE(rnp): flip vertically and replicate edge pixels */
+				u32 row = height - 1 - MIN(my + j, height - 1);
+				for (u32 i = 0; i < 16; i++) {
+					u32 p = pixels[row * width + MIN(mx + i, width - 1)];
+					f32 r = (p >> 24) & 0xFF, g = (p >> 16) & 0xFF, b = (p >> 8) & 0xFF;
+
+					u32 block = (j / 8) * 2 + i / 8;
+					y_blocks[block][(j % 8) * 8 + i % 8] = 0.299f * r + 0.587f * g + 0.114f * b - 128;
+
+					u32 c = (j / 2) * 8 + i / 2;
+					cb[c] += 0.25f * (-0.168736f * r - 0.331264f * g + 0.5f      * b);
+					cr[c] += 0.25f * ( 0.5f      * r - 0.418688f * g - 0.081312f * b);
+				}
+			}
+			for (u32 i = 0; i < 4; i++)
+				previous_dc[0] = jpeg_encode_block(&w, t, y_blocks[i], 0, previous_dc[0]);
+			previous_dc[1] = jpeg_encode_block(&w, t, cb, 1, previous_dc[1]);
+			previous_dc[2] = jpeg_encode_block(&w, t, cr, 2, previous_dc[2]);
+		}
+	}
+	jpeg_flush_bits(&w);
+
+	stream_append_u16_be(s, 0xFFD9);
+}
+
+#define AVI_HEADER_SIZE 224
+
+function void
+avi_write_header(Stream *s, u32 width, u32 height, u32 frame_rate, u32 frame_count,
+                 u32 movi_size, u32 largest_frame, u32 file_size)
+{
+	stream_append(s, "RIFF", 4);
+	stream_append_u32_le(s, file_size - 8);
+	stream_append(s, "AVI ", 4);
+
+	stream_append(s, "LIST", 4);
+	stream_append_u32_le(s, 192);
+	stream_append(s, "hdrl", 4);
+
+	stream_append(s, "avih", 4);
+	stream_append_u32_le(s, 56);
+	stream_append_u32_le(s, 1000000 / frame_rate);
+	stream_append_u32_le(s, largest_frame * frame_rate);
+	stream_append_u32_le(s, 0);
+	stream_append_u32_le(s, 0x10); /* AVIF_HASINDEX */
+	stream_append_u32_le(s, frame_count);
+	stream_append_u32_le(s, 0);
+	stream_append_u32_le(s, 1);
+	stream_append_u32_le(s, largest_frame);
+	stream_append_u32_le(s, width);
+	stream_append_u32_le(s, height);
+	for (u32 i = 0; i < 4; i++) stream_append_u32_le(s, 0);
+
+	stream_append(s, "LIST", 4);
+	stream_append_u32_le(s, 116);
+	stream_append(s, "strl", 4);
+
+	stream_append(s, "strh", 4);
+	stream_append_u32_le(s, 56);
+	stream_append(s, "vidsMJPG", 8);
+	stream_append_u32_le(s, 0);
+	stream_append_u32_le(s, 0);   /* priority, language */
+	stream_append_u32_le(s, 0);
+	stream_append_u32_le(s, 1);
+	stream_append_u32_le(s, frame_rate);
+	stream_append_u32_le(s, 0);
+	stream_append_u32_le(s, frame_count);
+	stream_append_u32_le(s, largest_frame);
+	stream_append_u32_le(s, U32_MAX);
+	stream_append_u32_le(s, 0);
+	stream_append_u16_le(s, 0);
+	stream_append_u16_le(s, 0);
+	stream_append_u16_le(s, width);
+	stream_append_u16_le(s, height);
+
+	stream_append(s, "strf", 4);
+	stream_append_u32_le(s, 40);
+	stream_append_u32_le(s, 40);
+	stream_append_u32_le(s, width);
+	stream_append_u32_le(s, height);
+	stream_append_u16_le(s, 1);
+	stream_append_u16_le(s, 24);
+	stream_append(s, "MJPG", 4);
+	stream_append_u32_le(s, width * height * 3);
+	for (u32 i = 0; i < 4; i++) stream_append_u32_le(s, 0);
+
+	stream_append(s, "LIST", 4);
+	stream_append_u32_le(s, movi_size);
+	stream_append(s, "movi", 4);
+
+	assert(s->errors || s->widx == AVI_HEADER_SIZE);
+}
+
+function void
+avi_write_index(Stream *s, AVIIndexEntry *entries, u32 count)
+{
+	stream_append(s, "idx1", 4);
+	stream_append_u32_le(s, count * 16);
+	for (u32 i = 0; i < count; i++) {
+		stream_append(s, "00dc", 4);
+		stream_append_u32_le(s, 0x10); /* AVIIF_KEYFRAME */
+		stream_append_u32_le(s, entries[i].offset);
+		stream_append_u32_le(s, entries[i].size);
+	}
+}
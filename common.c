@@ -5,24 +5,69 @@
 #include <stdio.h>
 
 #include "options.h"
+#include "codec.c"
 
 #define RENDER_TARGET_SIZE   RENDER_TARGET_WIDTH, RENDER_TARGET_HEIGHT
 #define TOTAL_OUTPUT_FRAMES (OUTPUT_FRAME_RATE * OUTPUT_TIME_SECONDS - 1)
+#define OUTPUT_FRAME_SIZE   (sizeof(u32) * RENDER_TARGET_WIDTH * RENDER_TARGET_HEIGHT)
 
-#define MODEL_RENDER_MODEL_MATRIX_LOC   0
-#define MODEL_RENDER_VIEW_MATRIX_LOC    1
-#define MODEL_RENDER_PROJ_MATRIX_LOC    2
-#define MODEL_RENDER_CLIP_FRACTION_LOC  3
-#define MODEL_RENDER_SWIZZLE_LOC        4
-#define MODEL_RENDER_LOG_SCALE_LOC      5
-#define MODEL_RENDER_DYNAMIC_RANGE_LOC  6
-#define MODEL_RENDER_THRESHOLD_LOC      7
-#define MODEL_RENDER_GAMMA_LOC          8
-#define MODEL_RENDER_BB_COLOUR_LOC      9
-#define MODEL_RENDER_BB_FRACTION_LOC   10
-#define MODEL_RENDER_GAIN_LOC          11
+#define MODEL_RENDER_VIEW_MATRIX_LOC    0
+#define MODEL_RENDER_PROJ_MATRIX_LOC    1
+#define MODEL_RENDER_BB_COLOUR_LOC      5
+#define MODEL_RENDER_BB_FRACTION_LOC    6
+#define MODEL_RENDER_MAX_SAMPLES_LOC    8
+#define MODEL_RENDER_ABSORPTION_LOC     9
+#define MODEL_RENDER_CLIP_GEOMETRY_LOC 10
+#define MODEL_RENDER_ATLAS_AXIS_LOC    11
+#define MODEL_RENDER_ATLAS_SLOTS_LOC   12
+#define MODEL_RENDER_ISOSURFACE_COLOUR_LOC 13
+#define MODEL_RENDER_ORDERED_DEPTH_LOC 14
+
+/* NOTE(rnp): must match the layout of VolumeParameters */
+#define VOLUME_PARAMETERS_GLSL \
+	"struct Volume {\n" \
+	"\tmat4  model;\n" \
+	"\tfloat clip_fraction;\n" \
+	"\tfloat threshold_scale;\n" \
+	"\tfloat step_size;\n" \
+	"\tfloat brick_cutoff;\n" \
+	"\tbool  swizzle;\n" \
+	"\tuint  atlas_slot;\n" \
+	"\tuint  draw_order;\n" \
+	"};\n\n" \
+	"layout(std430, binding = 0) readonly restrict buffer VolumeParameters {\n" \
+	"\tVolume volumes[];\n" \
+	"};\n\n"
+
+#define ACCUMULATE_WEIGHT_LOC 0
+
+#define COMPOSITE_LAYER_MASK_LOC 0
+#define COMPOSITE_BACKGROUND_LOC 1
+
+#define VOLUME_BRICK_SIZE 8
+
+/* NOTE(rnp): size of each volume's layer of the transfer function lookup texture;
+ * x: sample magnitude over the threshold in dB, y: depth coordinate for the depth weight.
+ * x covers TRANSFER_LUT_DECIBELS up to the threshold; a linear axis leaves only a few
+ * texels for the bottom of a large dynamic range, which shows up as banding */
+#define TRANSFER_LUT_WIDTH    1024
+#define TRANSFER_LUT_HEIGHT   64
+#define TRANSFER_LUT_DECIBELS 120.0f
+
+/* NOTE(rnp): must match transfer_lut_coordinate() */
+#define TRANSFER_LUT_GLSL \
+	"#define TRANSFER_LUT_SIZE vec2(" str(TRANSFER_LUT_WIDTH) ", " str(TRANSFER_LUT_HEIGHT) ")\n" \
+	"\n" \
+	"vec2 transfer_lut_coordinate(float magnitude, float t)\n" \
+	"{\n" \
+	"\t/* NOTE: 20 * log10(x) = 20 * log10(2) * log2(x) */\n" \
+	"\tfloat db     = 6.0205999 * log2(max(magnitude, 1e-30));\n" \
+	"\tvec2  result = clamp(vec2(1 + db / " str(TRANSFER_LUT_DECIBELS) ", t), 0, 1);\n" \
+	"\treturn (result * (TRANSFER_LUT_SIZE - 1) + 0.5) / TRANSFER_LUT_SIZE;\n" \
+	"}\n\n"
 
 #define CYCLE_T_UPDATE_SPEED 0.25f
+#define SCRUB_FRAME_STEP     4
 #define BG_CLEAR_COLOUR      (v4){{0.12, 0.1, 0.1, 1}}
 
 struct gl_debug_ctx {
@@ -30,13 +75,369 @@ struct gl_debug_ctx {
 	OS     *os;
 };
 
+read_only global str8 frame_sink_kind_names[FrameSinkKind_Count] = {
+	[FrameSinkKind_Raw]   = str8("raw"),
+	[FrameSinkKind_QOI]   = str8("qoi"),
+	[FrameSinkKind_MJPEG] = str8("mjpeg"),
+};
+
+read_only global str8 frame_sink_extensions[FrameSinkKind_Count] = {
+	[FrameSinkKind_Raw]   = str8(".raw"),
+	[FrameSinkKind_QOI]   = str8(".qoi"),
+	[FrameSinkKind_MJPEG] = str8(".avi"),
+};
+
+read_only global str8 sweep_parameter_names[SweepParameter_Count] = {
+	[SweepParameter_Threshold]    = str8("threshold"),
+	[SweepParameter_Gain]         = str8("gain"),
+	[SweepParameter_DynamicRange] = str8("dynamic_range"),
+	[SweepParameter_Elevation]    = str8("elevation"),
+};
+
+read_only global str8 render_profile_names[RenderProfile_Count] = {
+	[RenderProfile_Auto]     = str8("auto"),
+	[RenderProfile_Hardware] = str8("hardware"),
+	[RenderProfile_Software] = str8("software"),
+};
+
+read_only global str8 render_mode_names[RenderMode_Count] = {
+	[RenderMode_Surface]            = str8("surface"),
+	[RenderMode_MIP]                = str8("mip"),
+	[RenderMode_EmissionAbsorption] = str8("emission_absorption"),
+	[RenderMode_Isosurface]         = str8("isosurface"),
+};
+
+read_only global str8 gpu_pass_names[GPUPass_Count] = {
+	[GPUPass_Scene]    = str8("scene"),
+	[GPUPass_Resolve]  = str8("resolve"),
+	[GPUPass_Mipmaps]  = str8("mipmaps"),
+	[GPUPass_Overlay]  = str8("overlay"),
+	[GPUPass_Readback] = str8("readback_copy"),
+};
+
+/* NOTE(rnp): GL_RENDERER substrings of CPU rasterisers */
+read_only global str8 software_renderer_names[] = {
+	str8("llvmpipe"),
+	str8("softpipe"),
+	str8("SwiftShader"),
+	str8("Software Rasterizer"),
+	str8("GDI Generic"),
+};
+
+read_only global c8 *frame_sink_output_paths[FrameSinkKind_Count] = {
+	[FrameSinkKind_Raw]   = RAW_OUTPUT_PATH,
+	[FrameSinkKind_QOI]   = QOI_OUTPUT_PATH,
+	[FrameSinkKind_MJPEG] = AVI_OUTPUT_PATH,
+};
+
+function b32
+work_queue_do_next(WorkQueue *q)
+{
+	b32 result = 0;
+	u32 read   = atomic_load_u32(&q->read_index);
+	if (read != atomic_load_u32(&q->write_index)) {
+		/* NOTE(rnp): the item must be copied before it is claimed; afterwards the
+		 * producer is free to overwrite it */
+		WorkQueueItem item = q->items[read % countof(q->items)];
+		if (atomic_cas_u32(&q->read_index, &read, read + 1)) {
+			item.fn(item.user_data);
+			result = 1;
+		}
+	}
+	return result;
+}
+
+function OS_THREAD_ENTRY_POINT_FN(work_queue_thread)
+{
+	WorkQueue *q = (WorkQueue *)user_context;
+	TRACE_THREAD("worker");
+	for (;;) {
+		u32 write = atomic_load_u32(&q->write_index);
+		if (atomic_load_u32(&q->read_index) == write)
+			os_wait_on_value(&q->write_index, write, U32_MAX);
+		else
+			work_queue_do_next(q);
+	}
+	return 0;
+}
+
+/* NOTE(rnp): the processors are split evenly between process_count processes which each
+ * start their own queue; the thread pushing work also runs it while it waits */
+function void
+work_queue_init(WorkQueue *q, u32 process_count)
+{
+	q->thread_count = MAX(os_get_processor_count() / MAX(process_count, 1), 2) - 1;
+	for (u32 i = 0; i < q->thread_count; i++)
+		os_create_thread(work_queue_thread, (sptr)q);
+}
+
+function void
+work_queue_push(WorkQueue *q, work_queue_fn *fn, sptr user_data)
+{
+	u32 write = q->write_index;
+	/* NOTE(rnp): help out while the queue is full */
+	while (write - atomic_load_u32(&q->read_index) >= countof(q->items))
+		work_queue_do_next(q);
+	q->items[write % countof(q->items)] = (WorkQueueItem){.fn = fn, .user_data = user_data};
+	atomic_store_u32(&q->write_index, write + 1);
+	os_wake_waiters(&q->write_index);
+}
+
+function WORK_QUEUE_FN(frame_sink_encode_job)
+{
+	FrameSinkSlot *slot = (FrameSinkSlot *)user_data;
+	FrameSink     *s    = slot->sink;
+	stream_reset(&slot->encoded, 0);
+	switch (s->kind) {
+	case FrameSinkKind_QOI: {
+		qoi_encode_frame(&slot->encoded, (u32 *)slot->pixels, s->size.w, s->size.h);
+	} break;
+	case FrameSinkKind_MJPEG: {
+		jpeg_encode_frame(&slot->encoded, &s->jpeg_tables, (u32 *)slot->pixels, s->size.w, s->size.h);
+	} break;
+	InvalidDefaultCase;
+	}
+	atomic_store_u32(&slot->state, FrameSlotState_Done);
+	os_wake_waiters(&slot->state);
+}
+
+function b32
+frame_sink_open(FrameSink *s, WorkQueue *q, FrameSinkKind kind, c8 *path, sv2 size)
+{
+	sz pixels_size  = (sz)size.w * size.h * sizeof(u32);
+	sz encoded_size = kind == FrameSinkKind_Raw ? 0 : ENCODED_FRAME_SIZE_BOUND(size.w, size.h);
+	u32 slot_count  = MIN(countof(s->slots), 2 * (q->thread_count + 1));
+	sz needed       = slot_count * (pixels_size + encoded_size) + MB(1);
+
+	/* NOTE(rnp): backing memory is kept between exports and only grows */
+	Arena memory = s->memory;
+	if (memory.end - memory.beg < needed)
+		memory = os_alloc_arena(needed);
+
+	zero_struct(s);
+	s->memory = memory;
+	if (!memory.beg) return 0;
+
+	s->kind       = kind;
+	s->size       = size;
+	s->work_queue = q;
+	s->slot_count = slot_count;
+	s->file       = os_create_file(path);
+	if (s->file == INVALID_FILE) return 0;
+
+	for (u32 i = 0; i < slot_count; i++) {
+		FrameSinkSlot *slot = s->slots + i;
+		slot->sink   = s;
+		slot->pixels = arena_commit(&memory, pixels_size);
+		if (encoded_size) {
+			slot->encoded.data = arena_commit(&memory, encoded_size);
+			slot->encoded.cap  = encoded_size;
+		}
+	}
+
+	if (kind == FrameSinkKind_MJPEG) {
+		jpeg_init_tables(&s->jpeg_tables, OUTPUT_JPEG_QUALITY);
+		s->avi_index_capacity = (memory.end - memory.beg) / sizeof(*s->avi_index);
+		s->avi_index          = (AVIIndexEntry *)memory.beg;
+
+		/* NOTE(rnp): placeholder, the real header is written on close */
+		u8 header[AVI_HEADER_SIZE] = {0};
+		s->errors |= !os_write_file(s->file, (str8){.len = sizeof(header), .data = header});
+		s->bytes_written = sizeof(header);
+	}
+
+	return 1;
+}
+
+function void
+frame_sink_write_slot(FrameSink *s, FrameSinkSlot *slot)
+{
+	while (atomic_load_u32(&slot->state) != FrameSlotState_Done) {
+		if (!work_queue_do_next(s->work_queue))
+			os_wait_on_value(&slot->state, FrameSlotState_Queued, U32_MAX);
+	}
+
+	str8 data = {.len = (sz)s->size.w * s->size.h * sizeof(u32), .data = slot->pixels};
+	if (s->kind != FrameSinkKind_Raw) {
+		s->errors |= slot->encoded.errors;
+		data = stream_to_str8(&slot->encoded);
+	}
+
+	if (s->kind == FrameSinkKind_MJPEG) {
+		u8 chunk[8];
+		Stream header = {.data = chunk, .cap = sizeof(chunk)};
+		stream_append(&header, "00dc", 4);
+		stream_append_u32_le(&header, data.len);
+		s->errors |= !os_write_file(s->file, stream_to_str8(&header));
+
+		if (s->frames_written < s->avi_index_capacity) {
+			/* NOTE(rnp): offsets are relative to the 'movi' fourcc */
+			AVIIndexEntry *e = s->avi_index + s->frames_written;
+			e->offset = s->bytes_written - (AVI_HEADER_SIZE - 4);
+			e->size   = data.len;
+		} else {
+			s->errors = 1;
+		}
+		s->largest_frame  = MAX(s->largest_frame, data.len);
+		s->bytes_written += sizeof(chunk);
+	}
+
+	s->errors        |= !os_write_file(s->file, data);
+	s->bytes_written += data.len;
+
+	if (s->kind == FrameSinkKind_MJPEG && (data.len & 1)) {
+		s->errors |= !os_write_file(s->file, str8("\0"));
+		s->bytes_written++;
+	}
+
+	s->frames_written++;
+	atomic_store_u32(&slot->state, FrameSlotState_Free);
+}
+
+/* NOTE(rnp): returns the buffer the next frame should be written into */
+function u8 *
+frame_sink_acquire(FrameSink *s)
+{
+	FrameSinkSlot *slot = s->slots + s->frames_submitted % s->slot_count;
+	if (atomic_load_u32(&slot->state) != FrameSlotState_Free) {
+		assert(s->frames_written + s->slot_count == s->frames_submitted);
+		frame_sink_write_slot(s, slot);
+	}
+	return slot->pixels;
+}
+
+function void
+frame_sink_submit(FrameSink *s)
+{
+	FrameSinkSlot *slot = s->slots + s->frames_submitted++ % s->slot_count;
+	if (s->kind == FrameSinkKind_Raw) {
+		slot->state = FrameSlotState_Done;
+	} else {
+		slot->state = FrameSlotState_Queued;
+		work_queue_push(s->work_queue, frame_sink_encode_job, (sptr)slot);
+	}
+
+	/* NOTE(rnp): write out any finished frames without blocking */
+	while (s->frames_written < s->frames_submitted) {
+		FrameSinkSlot *next = s->slots + s->frames_written % s->slot_count;
+		if (atomic_load_u32(&next->state) != FrameSlotState_Done)
+			break;
+		frame_sink_write_slot(s, next);
+	}
+}
+
+function b32
+frame_sink_close(FrameSink *s)
+{
+	while (s->frames_written < s->frames_submitted)
+		frame_sink_write_slot(s, s->slots + s->frames_written % s->slot_count);
+
+	if (s->kind == FrameSinkKind_MJPEG) {
+		u32 count = MIN(s->frames_written, s->avi_index_capacity);
+		Stream index = {.data = (u8 *)(s->avi_index + count),
+		                .cap  = s->memory.end - (u8 *)(s->avi_index + count)};
+		avi_write_index(&index, s->avi_index, count);
+		s->errors |= index.errors || !os_write_file(s->file, stream_to_str8(&index));
+
+		u8 buffer[AVI_HEADER_SIZE];
+		Stream header = {.data = buffer, .cap = sizeof(buffer)};
+		u32 movi_size = s->bytes_written - (AVI_HEADER_SIZE - 4);
+		u32 file_size = s->bytes_written + index.widx;
+		avi_write_header(&header, s->size.w, s->size.h, OUTPUT_FRAME_RATE, count, movi_size,
+		                 s->largest_frame, file_size);
+		s->errors |= !os_set_file_position(s->file, 0);
+		s->errors |= !os_write_file(s->file, stream_to_str8(&header));
+	}
+
+	os_close_file(s->file);
+	s->file = INVALID_FILE;
+	return !s->errors;
+}
+
+function sv2
+output_mip_size(sv2 size, u32 level)
+{
+	sv2 result = {.w = MAX(1, size.w >> level), .h = MAX(1, size.h >> level)};
+	return result;
+}
+
+function sz
+output_mip_bytes(sv2 size, u32 level)
+{
+	sv2 mip   = output_mip_size(size, level);
+	sz result = (sz)mip.w * mip.h * sizeof(u32);
+	return result;
+}
+
+/* NOTE(rnp): bytes needed to hold one frame at every level in mip_levels */
+function sz
+export_frame_bytes(sv2 size, u32 mip_levels)
+{
+	sz result = 0;
+	for (u32 level = 0; level < EXPORT_MAX_MIP_LEVELS; level++)
+		if (mip_levels & (1u << level))
+			result += output_mip_bytes(size, level);
+	return result;
+}
+
+function b32
+export_sinks_close(ExportSinks *e)
+{
+	b32 result = 1;
+	for (u32 level = 0; level < EXPORT_MAX_MIP_LEVELS; level++)
+		if (e->mip_levels & (1u << level))
+			result &= frame_sink_close(e->sinks + level);
+	e->mip_levels = 0;
+	return result;
+}
+
+/* NOTE(rnp): level 0 is written to path and level N to path with "_mipN" inserted
+ * before the extension (e.g. /tmp/out.raw -> /tmp/out_mip3.raw) */
+function b32
+export_sinks_open(ExportSinks *e, WorkQueue *q, FrameSinkKind kind, str8 path, u32 mip_levels,
+                  sv2 size)
+{
+	str8 stem = path, extension = {0};
+	sz dot = str8_scan_backwards(path, '.');
+	if (dot >= 0 && str8_scan_backwards(path, '/') < dot) {
+		stem.len  = dot;
+		extension = str8_cut_head(path, dot);
+	}
+
+	b32 result    = 1;
+	e->mip_levels = 0;
+	mip_levels   |= 1;
+	for (u32 level = 0; result && level < EXPORT_MAX_MIP_LEVELS; level++) {
+		if (!(mip_levels & (1u << level)))
+			continue;
+
+		u8 buffer[1024];
+		Stream s = {.data = buffer, .cap = sizeof(buffer)};
+		stream_append_str8(&s, stem);
+		if (level) {
+			stream_append_str8(&s, str8("_mip"));
+			stream_append_u64(&s, level);
+		}
+		stream_append_str8(&s, extension);
+		stream_append_byte(&s, 0);
+
+		result = !s.errors && frame_sink_open(e->sinks + level, q, kind, (c8 *)buffer,
+		                                      output_mip_size(size, level));
+		if (result) e->mip_levels |= 1u << level;
+	}
+
+	if (!result) export_sinks_close(e);
+
+	return result;
+}
+
 function f32
 get_frame_time_step(ViewerContext *ctx)
 {
 	f32 result = 0;
-	/* NOTE(rnp): if we are outputting frames do a constant time step */
+	/* NOTE(rnp): if we are outputting frames the time step is derived from the frame index */
 	if (ctx->output_frames_count > 0) {
-		result = 1.0f / (OUTPUT_FRAME_RATE * OUTPUT_TIME_SECONDS * CYCLE_T_UPDATE_SPEED);
+		ctx->do_update = 1;
 	} else {
 		f64 now = glfwGetTime();
 		result = ctx->demo_mode * (now - ctx->last_time);
@@ -46,6 +447,24 @@ get_frame_time_step(ViewerContext *ctx)
 	return result;
 }
 
+/* NOTE(rnp): cycle_t positions which can be cached are those which lie exactly on
+ * the output frame grid; these are the positions reached by scrubbing and exporting */
+function f32
+cycle_t_from_grid(u32 grid_index)
+{
+	f32 result = (f32)grid_index / (OUTPUT_FRAME_RATE * OUTPUT_TIME_SECONDS);
+	return result;
+}
+
+function u32
+cycle_t_grid_index(f32 cycle_t)
+{
+	u32 result = (u32)(cycle_t * (OUTPUT_FRAME_RATE * OUTPUT_TIME_SECONDS) + 0.5f);
+	if (cycle_t < 0 || cycle_t_from_grid(result) != cycle_t)
+		result = U32_MAX;
+	return result;
+}
+
 function void
 gl_debug_logger(u32 src, u32 type, u32 id, u32 lvl, s32 len, const char *msg, const void *userctx)
 {
@@ -58,13 +477,11 @@ gl_debug_logger(u32 src, u32 type, u32 id, u32 lvl, s32 len, const char *msg, co
 	stream_reset(e, 0);
 }
 
-function u32
-compile_shader(OS *os, Arena a, u32 type, str8 shader, str8 name)
+/* NOTE(rnp): writes the info log of a shader which failed to compile. querying the
+ * status waits for the compile to finish */
+function b32
+check_shader(OS *os, Arena a, u32 sid, str8 name)
 {
-	u32 sid = glCreateShader(type);
-	glShaderSource(sid, 1, (const char **)&shader.data, (int *)&shader.len);
-	glCompileShader(sid);
-
 	s32 res = 0;
 	glGetShaderiv(sid, GL_COMPILE_STATUS, &res);
 
@@ -76,23 +493,52 @@ compile_shader(OS *os, Arena a, u32 type, str8 shader, str8 name)
 		glGetShaderiv(sid, GL_INFO_LOG_LENGTH, &len);
 		glGetShaderInfoLog(sid, len, &out_len, (char *)(buf.data + buf.widx));
 		stream_commit(&buf, out_len);
-		glDeleteShader(sid);
 		os_write_file(os->error_handle, stream_to_str8(&buf));
+	}
+
+	return res != GL_FALSE;
+}
+
+/* NOTE(rnp): only starts the compile; with GL_KHR_parallel_shader_compile the driver
+ * may finish it in the background until the status is first queried */
+function u32
+start_shader_compile(u32 type, str8 shader)
+{
+	u32 result = glCreateShader(type);
+	glShaderSource(result, 1, (const char **)&shader.data, (int *)&shader.len);
+	glCompileShader(result);
+	return result;
+}
 
+function u32
+compile_shader(OS *os, Arena a, u32 type, str8 shader, str8 name)
+{
+	TRACE_BEGIN(compile_shader);
+	u32 sid = start_shader_compile(type, shader);
+	if (!check_shader(os, a, sid, name)) {
+		glDeleteShader(sid);
 		sid = 0;
 	}
-
+	TRACE_END(compile_shader);
 	return sid;
 }
 
 function u32
-link_program(OS *os, Arena a, u32 *shader_ids, u32 shader_id_count)
+start_program_link(u32 *shader_ids, u32 shader_id_count)
 {
-	s32 success = 0;
-	u32 result  = glCreateProgram();
+	u32 result = glCreateProgram();
 	for (u32 i = 0; i < shader_id_count; i++)
 		glAttachShader(result, shader_ids[i]);
 	glLinkProgram(result);
+	return result;
+}
+
+/* NOTE(rnp): returns program or 0 after deleting it when the link failed */
+function u32
+check_program(OS *os, Arena a, u32 program)
+{
+	s32 success = 0;
+	u32 result  = program;
 	glGetProgramiv(result, GL_LINK_STATUS, &success);
 	if (success == GL_FALSE) {
 		s32 len    = 0;
@@ -108,6 +554,15 @@ link_program(OS *os, Arena a, u32 *shader_ids, u32 shader_id_count)
 	return result;
 }
 
+function u32
+link_program(OS *os, Arena a, u32 *shader_ids, u32 shader_id_count)
+{
+	TRACE_BEGIN(link_program);
+	u32 result = check_program(os, a, start_program_link(shader_ids, shader_id_count));
+	TRACE_END(link_program);
+	return result;
+}
+
 function u32
 load_shader(OS *os, Arena arena, str8 vs_text, str8 fs_text, str8 info_name, str8 label)
 {
@@ -128,563 +583,4714 @@ load_shader(OS *os, Arena arena, str8 vs_text, str8 fs_text, str8 info_name, str
 	return result;
 }
 
-typedef struct {
-	RenderContext *render_context;
-	str8 vertex_text;
-	str8 fragment_header;
-} ShaderReloadContext;
-
-function FILE_WATCH_CALLBACK_FN(reload_shader)
+/* NOTE(rnp): links one program per fragment shader in fs_texts against a shared vertex
+ * shader. every compile and link is started before any status is queried so that drivers
+ * which compile in parallel can work on all of them at once. programs which fail are 0;
+ * returns the number which succeeded */
+function u32
+load_shader_variants(OS *os, Arena arena, str8 vs_text, str8 *fs_texts, str8 *info_names,
+                     u32 count, u32 *programs)
 {
-	ShaderReloadContext *ctx = (typeof(ctx))user_data;
-	str8 header    = push_str8(&tmp, ctx->fragment_header);
-	str8 fragment  = os_read_whole_file(&tmp, (c8 *)path.data);
-	fragment.data -= header.len;
-	fragment.len  += header.len;
-	assert(fragment.data == header.data);
-	u32 new_program = load_shader(os, tmp, ctx->vertex_text, fragment, path, path);
-	if (new_program) {
-		glDeleteProgram(ctx->render_context->shader);
-		ctx->render_context->shader = new_program;
+	TRACE_BEGIN(load_shader_variants);
+	u32 *fs_ids = push_array(&arena, u32, count);
+	u32  vs_id  = start_shader_compile(GL_VERTEX_SHADER, vs_text);
+	for (u32 i = 0; i < count; i++)
+		fs_ids[i] = start_shader_compile(GL_FRAGMENT_SHADER, fs_texts[i]);
+	for (u32 i = 0; i < count; i++)
+		programs[i] = start_program_link((u32 []){vs_id, fs_ids[i]}, 2);
+
+	u32 result    = 0;
+	b32 vs_failed = !check_shader(os, arena, vs_id, info_names[0]);
+	for (u32 i = 0; i < count; i++) {
+		if (vs_failed || !check_shader(os, arena, fs_ids[i], info_names[i])) {
+			glDeleteProgram(programs[i]);
+			programs[i] = 0;
+		} else {
+			programs[i] = check_program(os, arena, programs[i]);
+		}
+		glDeleteShader(fs_ids[i]);
+
+		if (programs[i]) {
+			Stream buf = arena_stream(arena);
+			stream_append_str8s(&buf, str8("loaded: "), info_names[i], str8("\n"));
+			os_write_file(os->error_handle, stream_to_str8(&buf));
+			LABEL_GL_OBJECT(GL_PROGRAM, programs[i], info_names[i]);
+			result++;
+		}
 	}
-	return 1;
+	glDeleteShader(vs_id);
+	TRACE_END(load_shader_variants);
+
+	return result;
 }
 
 function u32
-load_complex_texture(Arena arena, c8 *file_path, u32 width, u32 height, u32 depth)
+load_compute_shader(OS *os, Arena arena, str8 text, str8 info_name, str8 label)
 {
 	u32 result = 0;
-	glCreateTextures(GL_TEXTURE_3D, 1, &result);
-	glTextureStorage3D(result, 1, GL_RG32F, width, height, depth);
-	glTextureParameteri(result, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-	glTextureParameteri(result, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-	glTextureParameteri(result, GL_TEXTURE_WRAP_R, GL_MIRRORED_REPEAT);
-	glTextureParameteri(result, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTextureParameteri(result, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	u32 id = compile_shader(os, arena, GL_COMPUTE_SHADER, text, info_name);
+	if (id) result = link_program(os, arena, &id, 1);
+	glDeleteShader(id);
 
-	str8 raw = os_read_whole_file(&arena, file_path);
-	if (raw.len) glTextureSubImage3D(result, 0, 0, 0, 0, width, height, depth, GL_RG, GL_FLOAT, raw.data);
+	if (result) {
+		Stream buf = arena_stream(arena);
+		stream_append_str8s(&buf, str8("loaded: "), info_name, str8("\n"));
+		os_write_file(os->error_handle, stream_to_str8(&buf));
+		LABEL_GL_OBJECT(GL_PROGRAM, result, label);
+	}
 
 	return result;
 }
 
-function RenderModel
-render_model_from_arrays(f32 *vertices, f32 *normals, u16 *indices, u32 index_count)
-{
-	RenderModel result = {0};
-
-	s32 buffer_size    = index_count * (6 * sizeof(f32) + sizeof(u16));
-	s32 indices_offset = index_count * (6 * sizeof(f32));
-	s32 vert_size      = index_count * 3 * sizeof(f32);
-	s32 ind_size       = index_count * sizeof(u16);
-
-	result.elements        = index_count;
-	result.elements_offset = indices_offset;
+/* NOTE(rnp): a fragment shader file is built once per variant with that variant's
+ * defines placed after the #version line of fragment_header. a reload only replaces the
+ * programs if every variant built and then bumps reload_count (if any) */
+typedef struct {
+	u32  *programs;
+	u32  *reload_count;
+	str8 *variant_defines;
+	str8 *variant_names;
+	u32   variant_count;
+	str8 vertex_text;
+	str8 fragment_header;
+} ShaderReloadContext;
 
-	glCreateBuffers(1, &result.buffer);
-	glNamedBufferStorage(result.buffer, buffer_size, 0, GL_DYNAMIC_STORAGE_BIT);
-	glNamedBufferSubData(result.buffer, 0,              vert_size, vertices);
-	glNamedBufferSubData(result.buffer, vert_size,      vert_size, normals);
-	glNamedBufferSubData(result.buffer, indices_offset, ind_size,  indices);
+function FILE_WATCH_CALLBACK_FN(reload_shader)
+{
+	ShaderReloadContext *ctx = (typeof(ctx))user_data;
+	str8 fragment = os_read_whole_file(&tmp, (c8 *)path.data);
 
-	glCreateVertexArrays(1, &result.vao);
-	glVertexArrayVertexBuffer(result.vao, 0, result.buffer, 0,         3 * sizeof(f32));
-	glVertexArrayVertexBuffer(result.vao, 1, result.buffer, vert_size, 3 * sizeof(f32));
-	glVertexArrayElementBuffer(result.vao, result.buffer);
+	str8 version = ctx->fragment_header;
+	for (version.len = 0; version.len < ctx->fragment_header.len;)
+		if (version.data[version.len++] == '\n') break;
+	str8 header = str8_cut_head(ctx->fragment_header, version.len);
 
-	glEnableVertexArrayAttrib(result.vao, 0);
-	glEnableVertexArrayAttrib(result.vao, 1);
+	u32   count = ctx->variant_count;
+	str8 *texts = push_array(&tmp, str8, count);
+	str8 *names = push_array(&tmp, str8, count);
+	for (u32 i = 0; i < count; i++) {
+		Stream s = arena_stream(tmp);
+		stream_append_str8s(&s, version, ctx->variant_defines[i], header, fragment);
+		texts[i] = arena_stream_commit_zero(&tmp, &s);
 
-	glVertexArrayAttribFormat(result.vao, 0, 3, GL_FLOAT, 0, 0);
-	glVertexArrayAttribFormat(result.vao, 1, 3, GL_FLOAT, 0, vert_size);
+		s = arena_stream(tmp);
+		stream_append_str8(&s, path);
+		if (ctx->variant_names[i].len)
+			stream_append_str8s(&s, str8(" ("), ctx->variant_names[i], str8(")"));
+		names[i] = arena_stream_commit_zero(&tmp, &s);
+	}
 
-	glVertexArrayAttribBinding(result.vao, 0, 0);
-	glVertexArrayAttribBinding(result.vao, 1, 0);
+	u32 *programs = push_array(&tmp, u32, count);
+	b32  replace  = load_shader_variants(os, tmp, ctx->vertex_text, texts, names, count, programs) == count;
+	for (u32 i = 0; i < count; i++) {
+		if (replace) SWAP(ctx->programs[i], programs[i]);
+		glDeleteProgram(programs[i]);
+	}
+	if (replace && ctx->reload_count) *ctx->reload_count += 1;
+	return 1;
+}
 
-	return result;
+function void
+gpu_timers_init(GPUTimers *t)
+{
+	for (u32 i = 0; i < GPU_TIMER_FRAMES; i++)
+		glCreateQueries(GL_TIMESTAMP, 2 * GPU_TIMER_ZONES, t->frames[i].queries[0]);
+	t->enabled = 1;
 }
 
-function RenderModel
-load_render_model(Arena arena, c8 *positions_file_name, c8 *indices_file_name, c8 *normals_file_name)
+/* NOTE(rnp): adds the passes of the oldest recorded frame to the history. unless wait is
+ * set nothing is done (and 0 is returned) while its queries are still in flight */
+function b32
+gpu_timers_collect_frame(GPUTimers *t, b32 wait)
 {
-	str8 positions = os_read_whole_file(&arena, positions_file_name);
-	str8 normals   = os_read_whole_file(&arena, normals_file_name);
-	str8 indices   = os_read_whole_file(&arena, indices_file_name);
+	GPUTimerFrame *f = t->frames + t->read_index % GPU_TIMER_FRAMES;
 
-	RenderModel result = render_model_from_arrays((f32 *)positions.data, (f32 *)normals.data,
-	                                              (u16 *)indices.data, indices.len / sizeof(u16));
-	return result;
+	/* NOTE(rnp): queries complete in order so the last one covers the whole frame */
+	s32 available = 1;
+	if (!wait) glGetQueryObjectiv(f->queries[f->zone_count - 1][1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+	if (available) {
+		f32 ms[GPUPass_Count] = {0};
+		u32 ran = 0;
+		for (u32 i = 0; i < f->zone_count; i++) {
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(f->queries[i][0], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(f->queries[i][1], GL_QUERY_RESULT, &end);
+			ms[f->passes[i]] += (f32)(end - begin) / 1e6f;
+			ran |= 1u << f->passes[i];
+		}
+		for (u32 pass = 0; pass < GPUPass_Count; pass++) {
+			if (ran & (1u << pass))
+				t->history[pass][t->history_count[pass]++ % GPU_TIMER_HISTORY] = ms[pass];
+		}
+		f->zone_count = 0;
+		t->read_index++;
+	}
+	return available;
 }
 
 function void
-scroll_callback(GLFWwindow *window, f64 x, f64 y)
+gpu_timers_collect(GPUTimers *t, b32 wait)
 {
-	ViewerContext *ctx  = glfwGetWindowUserPointer(window);
-	ctx->camera_fov += y;
-	ctx->do_update   = 1;
+	while (t->read_index != t->write_index && gpu_timers_collect_frame(t, wait));
 }
 
+/* NOTE(rnp): ends the frame being recorded if any pass was timed in it */
 function void
-key_callback(GLFWwindow *window, s32 key, s32 scancode, s32 action, s32 modifiers)
+gpu_timers_next_frame(GPUTimers *t)
 {
-	ViewerContext *ctx = glfwGetWindowUserPointer(window);
-	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-		ctx->should_exit = 1;
-
-	if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
-		ctx->demo_mode = !ctx->demo_mode;
-
-	if (key == GLFW_KEY_F12 && action == GLFW_PRESS && ctx->output_frames_count == 0) {
-		sz frames       = TOTAL_OUTPUT_FRAMES;
-		sz needed_bytes = sizeof(u32) * RENDER_TARGET_HEIGHT * RENDER_TARGET_WIDTH * frames;
-		if (!ctx->video_arena.beg) {
-			ctx->video_arena = os_alloc_arena(needed_bytes);
-			if (!ctx->video_arena.beg) {
-				fputs("failed to allocate space for output video, video "
-				      "won't be saved\n", stderr);
-			}
-		}
-		if (ctx->video_arena.beg) {
-			ctx->output_frames_count = TOTAL_OUTPUT_FRAMES;
-			ctx->cycle_t = 0;
+	if (t->frames[t->write_index % GPU_TIMER_FRAMES].zone_count) {
+		t->write_index++;
+		gpu_timers_collect(t, 0);
+		if (t->write_index - t->read_index == GPU_TIMER_FRAMES) {
+			t->frames[t->read_index++ % GPU_TIMER_FRAMES].zone_count = 0;
+			t->dropped_frames++;
 		}
 	}
+}
 
-	if (key == GLFW_KEY_A && action != GLFW_RELEASE)
-		ctx->cycle_t += 4.0f / (OUTPUT_TIME_SECONDS * OUTPUT_FRAME_RATE);
-	if (key == GLFW_KEY_D && action != GLFW_RELEASE)
-		ctx->cycle_t -= 4.0f / (OUTPUT_TIME_SECONDS * OUTPUT_FRAME_RATE);
-	if (key == GLFW_KEY_W && action != GLFW_RELEASE)
-		ctx->camera_angle += 5 * PI / 180.0f;
-	if (key == GLFW_KEY_S && action != GLFW_RELEASE)
-		ctx->camera_angle -= 5 * PI / 180.0f;
-
-	ctx->do_update = 1;
+/* NOTE(rnp): timed passes must not nest. once a frame runs out of zones the remaining
+ * passes are skipped rather than starting a new frame, which would count one frame twice */
+function u32
+gpu_timer_begin(GPUTimers *t, GPUPass pass)
+{
+	u32 result = GPU_TIMER_NO_ZONE;
+	GPUTimerFrame *f = t->frames + t->write_index % GPU_TIMER_FRAMES;
+	if (t->enabled && f->zone_count == GPU_TIMER_ZONES) {
+		t->skipped_zones++;
+	} else if (t->enabled) {
+		result = f->zone_count++;
+		f->passes[result] = pass;
+		glQueryCounter(f->queries[result][0], GL_TIMESTAMP);
+	}
+	return result;
 }
 
 function void
-fb_callback(GLFWwindow *window, s32 w, s32 h)
+gpu_timer_end(GPUTimers *t, u32 zone)
 {
-	ViewerContext *ctx = glfwGetWindowUserPointer(window);
-	ctx->window_size   = (sv2){.w = w, .h = h};
+	if (zone != GPU_TIMER_NO_ZONE)
+		glQueryCounter(t->frames[t->write_index % GPU_TIMER_FRAMES].queries[zone][1], GL_TIMESTAMP);
 }
 
+/* NOTE(rnp): waits for every recorded frame and clears the history */
 function void
-init_viewer(ViewerContext *ctx)
+gpu_timers_reset(GPUTimers *t)
 {
-	ctx->demo_mode     = 1;
-	ctx->window_size   = (sv2){.w = 640, .h = 640};
-	ctx->camera_radius = CAMERA_RADIUS;
-	ctx->camera_angle  = -CAMERA_ELEVATION_ANGLE * PI / 180.0f;
-	ctx->camera_fov    = 60.0f;
+	gpu_timers_next_frame(t);
+	gpu_timers_collect(t, 1);
+	mem_clear(t->history_count, 0, sizeof(t->history_count));
+	t->dropped_frames = 0;
+	t->skipped_zones  = 0;
+}
+
+function GPUTimerStats
+gpu_timer_stats(GPUTimers *t, GPUPass pass)
+{
+	GPUTimerStats result = {.count = MIN(t->history_count[pass], GPU_TIMER_HISTORY)};
+	f32 sorted[GPU_TIMER_HISTORY];
+	for (u32 i = 0; i < result.count; i++) {
+		f32 value = t->history[pass][i];
+		u32 j     = i;
+		for (; j > 0 && sorted[j - 1] > value; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j]   = value;
+		result.avg += value;
+	}
+	if (result.count) {
+		result.min  = sorted[0];
+		result.avg /= result.count;
+		/* NOTE(rnp): nearest rank */
+		result.p99  = sorted[(99 * result.count + 99) / 100 - 1];
+	}
+	return result;
+}
+
+function void
+gpu_timers_print(GPUTimers *t)
+{
+	gpu_timers_collect(t, 0);
+	for (u32 pass = 0; pass < GPUPass_Count; pass++) {
+		GPUTimerStats st = gpu_timer_stats(t, pass);
+		printf("gpu %-8.*s min %8.3f avg %8.3f p99 %8.3f ms (%u frames)\n",
+		       (s32)gpu_pass_names[pass].len, (c8 *)gpu_pass_names[pass].data,
+		       st.min, st.avg, st.p99, st.count);
+	}
+	if (t->dropped_frames)
+		printf("gpu timers: %u frames dropped while in flight\n", t->dropped_frames);
+	if (t->skipped_zones)
+		printf("gpu timers: %u passes untimed, more than " str(GPU_TIMER_ZONES) " in a frame\n",
+		       t->skipped_zones);
+}
+
+/* NOTE(rnp): called once an export finished; waits for the last frames to be timed */
+function void
+gpu_timers_write_csv(GPUTimers *t, Arena scratch)
+{
+	if (!t->enabled) return;
+
+	gpu_timers_next_frame(t);
+	gpu_timers_collect(t, 1);
+
+	Stream csv = arena_stream(scratch);
+	stream_append_str8(&csv, str8("pass,frames,min_ms,avg_ms,p99_ms\n"));
+	for (u32 pass = 0; pass < GPUPass_Count; pass++) {
+		GPUTimerStats st = gpu_timer_stats(t, pass);
+		stream_append_str8s(&csv, gpu_pass_names[pass], str8(","));
+		stream_append_u64(&csv, st.count);
+		stream_append_byte(&csv, ',');
+		stream_append_f64(&csv, st.min, 1000);
+		stream_append_byte(&csv, ',');
+		stream_append_f64(&csv, st.avg, 1000);
+		stream_append_byte(&csv, ',');
+		stream_append_f64(&csv, st.p99, 1000);
+		stream_append_byte(&csv, '\n');
+	}
+	if (csv.errors || !os_write_new_file(GPU_TIMER_CSV_PATH, stream_to_str8(&csv)))
+		fputs("failed to write " GPU_TIMER_CSV_PATH "\n", stderr);
+}
+
+#if CPU_TRACE
+function void
+stream_append_trace_event(Stream *s, str8 name, c8 *phase, u32 tid)
+{
+	stream_append_str8s(s, str8("{\"name\":\""), name, str8("\",\"ph\":\""),
+	                    c_str_to_str8(phase), str8("\",\"pid\":0,\"tid\":"));
+	stream_append_u64(s, tid);
+}
+
+/* NOTE(rnp): threads may still be recording; the zones they overwrite meanwhile are lost */
+function void
+trace_write_json(c8 *path)
+{
+	TraceContext *t = &trace_context;
+	u32 thread_count = MIN(atomic_load_u32(&t->thread_count), countof(t->buffers));
+
+	u64 now_ticks   = read_cpu_timer();
+	f64 now_seconds = glfwGetTime();
+	f64 us_per_tick = 0;
+	if (now_ticks > t->sync_ticks && now_seconds > t->sync_seconds)
+		us_per_tick = (now_seconds - t->sync_seconds) * 1e6 / (f64)(now_ticks - t->sync_ticks);
+
+	/* NOTE(rnp): times are relative to the first zone still held */
+	u64 origin = now_ticks;
+	sz  size   = KB(4);
+	for (u32 i = 0; i < thread_count; i++) {
+		TraceBuffer *b = t->buffers[i];
+		if (!b) continue;
+		u64 count = atomic_load_u64(&b->count);
+		u64 first = count > b->capacity ? count - b->capacity : 0;
+		for (u64 j = first; j < count; j++)
+			origin = MIN(origin, b->events[j % b->capacity].begin);
+		size += (count - first + 1) * 160;
+	}
+
+	Arena  memory = os_alloc_arena(size);
+	Stream s      = arena_stream(memory);
+	str8   separator = str8("");
+	stream_append_str8(&s, str8("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+	for (u32 i = 0; i < thread_count; i++) {
+		TraceBuffer *b = t->buffers[i];
+		if (!b) continue;
+
+		stream_append_str8(&s, separator);
+		stream_append_trace_event(&s, str8("thread_name"), "M", b->tid);
+		stream_append_str8s(&s, str8(",\"args\":{\"name\":\""), b->name, str8("\"}}"));
+		separator = str8(",\n");
+
+		u64 count = atomic_load_u64(&b->count);
+		u64 first = count > b->capacity ? count - b->capacity : 0;
+		for (u64 j = first; j < count; j++) {
+			TraceEvent *e = b->events + j % b->capacity;
+			stream_append_str8(&s, separator);
+			stream_append_trace_event(&s, c_str_to_str8(e->name), "X", b->tid);
+			stream_append_str8(&s, str8(",\"ts\":"));
+			stream_append_f64(&s, (f64)(e->begin - origin) * us_per_tick, 1000);
+			stream_append_str8(&s, str8(",\"dur\":"));
+			stream_append_f64(&s, (f64)(e->end - e->begin) * us_per_tick, 1000);
+			stream_append_byte(&s, '}');
+		}
+	}
+	stream_append_str8(&s, str8("\n]}\n"));
+
+	if (s.errors || !os_write_new_file(path, stream_to_str8(&s)))
+		fprintf(stderr, "failed to write trace: %s\n", path);
+}
+
+/* NOTE(rnp): forked export workers inherit the parent's rings, so each writes its own file */
+function void
+trace_write_worker_json(u32 worker_index)
+{
+	u8 buffer[256];
+	Stream path = {.data = buffer, .cap = sizeof(buffer)};
+	stream_append_str8(&path, str8(TRACE_WORKER_OUTPUT_PREFIX));
+	stream_append_u64(&path, worker_index);
+	stream_append_str8(&path, str8(".json"));
+	stream_append_byte(&path, 0);
+	if (!path.errors) trace_write_json((c8 *)path.data);
+}
+#endif
+
+/* NOTE(rnp): storage for complex (real, imaginary) samples. same shape volumes are
+ * stacked in these so edges are clamped rather than wrapped into a neighbour. format is
+ * GL_RG32F or GL_RG16F */
+function u32
+create_complex_texture(uv3 size, u32 format)
+{
+	u32 result = 0;
+	glCreateTextures(GL_TEXTURE_3D, 1, &result);
+	glTextureStorage3D(result, 1, format, size.x, size.y, size.z);
+	glTextureParameteri(result, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(result, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(result, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(result, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(result, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	return result;
+}
+
+function uv3
+brick_grid_size(uv3 dim)
+{
+	uv3 result;
+	for (u32 i = 0; i < 3; i++)
+		result.E[i] = (dim.E[i] + VOLUME_BRICK_SIZE - 1) / VOLUME_BRICK_SIZE;
+	return result;
+}
+
+typedef struct {
+	BrickGrid *grid;
+	f32       *data;
+	uv3        dim;
+	u32        brick_y;
+	u32        brick_z;
+	u32       *remaining;
+} BrickReduceJob;
+
+/* NOTE(rnp): reduces one row of bricks along x */
+function WORK_QUEUE_FN(brick_reduce_job)
+{
+	BrickReduceJob *job = (BrickReduceJob *)user_data;
+	BrickGrid *g   = job->grid;
+	uv3        dim = job->dim;
+	v2 *ranges = g->ranges + ((sz)job->brick_z * g->size.y + job->brick_y) * g->size.x;
+
+	u32 y0 = job->brick_y * VOLUME_BRICK_SIZE, y1 = MIN(y0 + VOLUME_BRICK_SIZE, dim.y);
+	u32 z0 = job->brick_z * VOLUME_BRICK_SIZE, z1 = MIN(z0 + VOLUME_BRICK_SIZE, dim.z);
+	for (u32 bx = 0; bx < g->size.x; bx++) {
+		u32 x0    = bx * VOLUME_BRICK_SIZE;
+		u32 count = MIN(VOLUME_BRICK_SIZE, dim.x - x0);
+
+		/* NOTE(rnp): squared magnitudes are reduced lane wise so that the inner loop
+		 * vectorizes; the lanes are only combined once the brick is done */
+		f32 lo[VOLUME_BRICK_SIZE], hi[VOLUME_BRICK_SIZE];
+		for (u32 i = 0; i < VOLUME_BRICK_SIZE; i++) {
+			lo[i] = F32_INFINITY;
+			hi[i] = 0;
+		}
+
+		for (u32 z = z0; z < z1; z++) {
+			for (u32 y = y0; y < y1; y++) {
+				f32 *p = job->data + 2 * (((sz)z * dim.y + y) * dim.x + x0);
+				if (count == VOLUME_BRICK_SIZE) {
+					for (u32 i = 0; i < VOLUME_BRICK_SIZE; i++) {
+						f32 m = p[2 * i] * p[2 * i] + p[2 * i + 1] * p[2 * i + 1];
+						lo[i] = MIN(lo[i], m);
+						hi[i] = MAX(hi[i], m);
+					}
+				} else {
+					for (u32 i = 0; i < count; i++) {
+						f32 m = p[2 * i] * p[2 * i] + p[2 * i + 1] * p[2 * i + 1];
+						lo[i] = MIN(lo[i], m);
+						hi[i] = MAX(hi[i], m);
+					}
+				}
+			}
+		}
+
+		for (u32 i = 1; i < VOLUME_BRICK_SIZE; i++) {
+			lo[0] = MIN(lo[0], lo[i]);
+			hi[0] = MAX(hi[0], hi[i]);
+		}
+		ranges[bx] = (v2){{sqrt_f32(lo[0]), sqrt_f32(hi[0])}};
+	}
+
+	if (atomic_add_u32(job->remaining, -1) == 1)
+		os_wake_waiters(job->remaining);
+}
+
+/* NOTE(rnp): fills the grid's ranges; these must not alias raw */
+function void
+brick_grid_from_data(WorkQueue *q, BrickGrid *grid, Arena scratch, str8 raw, uv3 dim)
+{
+	sz brick_count = (sz)grid->size.x * grid->size.y * grid->size.z;
+	if (raw.len >= (sz)dim.x * dim.y * dim.z * 2 * sizeof(f32)) {
+		u32 job_count = grid->size.y * grid->size.z;
+		u32 remaining = job_count;
+		BrickReduceJob *jobs = push_array(&scratch, BrickReduceJob, job_count);
+		for (u32 i = 0; i < job_count; i++) {
+			jobs[i] = (BrickReduceJob){
+				.grid      = grid,
+				.data      = (f32 *)raw.data,
+				.dim       = dim,
+				.brick_y   = i % grid->size.y,
+				.brick_z   = i / grid->size.y,
+				.remaining = &remaining,
+			};
+			work_queue_push(q, brick_reduce_job, (sptr)(jobs + i));
+		}
+
+		for (u32 left; (left = atomic_load_u32(&remaining));) {
+			if (!work_queue_do_next(q))
+				os_wait_on_value(&remaining, left, U32_MAX);
+		}
+	} else {
+		/* NOTE(rnp): missing or short data; never skip anything */
+		for (sz i = 0; i < brick_count; i++)
+			grid->ranges[i] = (v2){{0, F32_INFINITY}};
+	}
+}
+
+/* NOTE(rnp): marching cubes cases. corner i of a cell is at (i & 1, (i >> 1) & 1, i >> 2)
+ * and edge e runs along axis e / 4 from the corner whose bits on the other two axes are
+ * e % 4 (next axis first). corners at or above the level are inside. the triangles are
+ * built from the cell's faces rather than kept as a table: on each face the inside
+ * corners are always separated, which is the same choice the neighbouring cell makes
+ * for the shared face, so the surface has no holes */
+global u8 marching_cubes_triangles[256][16];
+global u8 marching_cubes_index_counts[256];
+
+function u32
+marching_cubes_edge(u32 corner_a, u32 corner_b)
+{
+	u32 axis = ctz_u32(corner_a ^ corner_b), lo = corner_a & corner_b;
+	u32 result = axis * 4 + ((lo >> (axis + 1) % 3) & 1) + 2 * ((lo >> (axis + 2) % 3) & 1);
+	return result;
+}
+
+/* NOTE(rnp): bit mask of the cell faces (2 * axis + side) an edge lies on */
+function u32
+marching_cubes_edge_faces(u32 edge)
+{
+	u32 axis = edge / 4, u = (axis + 1) % 3, w = (axis + 2) % 3;
+	u32 result = 1u << (2 * u + (edge & 1)) | 1u << (2 * w + ((edge >> 1) & 1));
+	return result;
+}
+
+function void
+marching_cubes_init_tables(void)
+{
+	for (u32 c = 0; c < 256; c++) {
+		/* NOTE(rnp): walking each face counter clockwise seen from outside the cell,
+		 * every run of inside corners is cut off by a segment from the edge leaving the
+		 * run to the edge entering it. every crossed edge leaves a run on one of its
+		 * faces and enters one on the other so the segments chain into closed loops */
+		u8 next[12];
+		for (u32 e = 0; e < 12; e++) next[e] = 0xFF;
+		for (u32 face = 0; face < 6; face++) {
+			u32 a = face / 2, side = face % 2, u = (a + 1) % 3, w = (a + 2) % 3;
+			u32 corners[4] = {side << a, side << a | 1 << u, side << a | 1 << u | 1 << w, side << a | 1 << w};
+			if (!side) SWAP(corners[1], corners[3]);
+
+			u32 inside[4];
+			for (u32 i = 0; i < 4; i++) inside[i] = (c >> corners[i]) & 1;
+			for (u32 i = 0; i < 4; i++) {
+				if (inside[i] || !inside[(i + 1) % 4]) continue;
+				u32 j = (i + 1) % 4;
+				while (!inside[j] || inside[(j + 1) % 4]) j = (j + 1) % 4;
+				next[marching_cubes_edge(corners[j], corners[(j + 1) % 4])] =
+					marching_cubes_edge(corners[i], corners[(i + 1) % 4]);
+			}
+		}
+
+		u32 count = 0, used = 0;
+		for (u32 e = 0; e < 12; e++) {
+			if (next[e] == 0xFF || (used & (1u << e))) continue;
+			u8  loop[12];
+			u32 length = 0;
+			for (u32 k = e; !(used & (1u << k)); k = next[k]) {
+				used |= 1u << k;
+				loop[length++] = k;
+			}
+
+			/* NOTE(rnp): fan out from a vertex which keeps every triangle off of the
+			 * cell's faces; loops which visit a face twice would otherwise put a
+			 * triangle in the face shared with the neighbouring cell */
+			u32 origin = 0;
+			for (b32 found = 0; !found && origin < length; origin += !found) {
+				found = 1;
+				for (u32 i = 1; i + 1 < length; i++) {
+					found &= !(marching_cubes_edge_faces(loop[origin]) &
+					           marching_cubes_edge_faces(loop[(origin + i) % length]) &
+					           marching_cubes_edge_faces(loop[(origin + i + 1) % length]));
+				}
+			}
+			origin %= length;
+
+			for (u32 i = 1; i + 1 < length; i++) {
+				marching_cubes_triangles[c][count++] = loop[origin];
+				marching_cubes_triangles[c][count++] = loop[(origin + i) % length];
+				marching_cubes_triangles[c][count++] = loop[(origin + i + 1) % length];
+			}
+		}
+		marching_cubes_index_counts[c] = count;
+	}
+}
+
+/* NOTE(rnp): sector volumes are stored in (angle, range, elevation) sample space about
+ * the apex of their clipping pyramid. they are resampled once, when loaded, onto a
+ * Cartesian grid spanning the bounding box so that the renderer never has to transform
+ * coordinates per fragment. the pyramid's edges are the edges of the sector */
+typedef struct {
+	v4  box;    /* lateral (x, y) and depth (z, w) extent in mm relative to the apex */
+	f32 angle;  /* half angle spanned by the lateral samples */
+	v2  range;  /* mm from the apex spanned by the range samples */
+} SectorGeometry;
+
+function SectorGeometry
+sector_geometry(VolumeDisplayItem *v)
+{
+	v3  min        = v->min_coord_mm;
+	v3  max        = v->max_coord_mm;
+	f32 top        = 1 - v->clip_fraction;
+	f32 half_width = 0.5f * (max.x - min.x);
+	f32 apex       = (min.z - top * max.z) / (1 - top);
+
+	SectorGeometry result;
+	result.box   = (v4){{-half_width, half_width, min.z - apex, max.z - apex}};
+	result.angle = atan2_f32(half_width, max.z - apex);
+	/* NOTE(rnp): the nearest arc passes through the top corners of the pyramid so
+	 * that the whole sector lies inside of it */
+	result.range = (v2){{(min.z - apex) / cos_f32(result.angle), max.z - apex}};
+	return result;
+}
+
+#define SCAN_CONVERT_ROWS 16
+typedef struct {
+	SectorGeometry geometry;
+	f32 *input;
+	f32 *output;
+	uv3  dim;
+	b32  swizzle;
+	u32  first_row;
+	u32 *remaining;
+} ScanConvertJob;
+
+function void
+scan_convert_job(sptr user_data)
+{
+	ScanConvertJob *job = (ScanConvertJob *)user_data;
+	SectorGeometry  *g  = &job->geometry;
+
+	/* NOTE(rnp): x is always lateral; depth and elevation are swapped by swizzle */
+	u32 lateral_count   = job->dim.x;
+	u32 depth_count     = job->swizzle ? job->dim.z : job->dim.y;
+	u32 elevation_count = job->swizzle ? job->dim.y : job->dim.z;
+	sz  depth_stride     = job->swizzle ? (sz)job->dim.x * job->dim.y : job->dim.x;
+	sz  elevation_stride = job->swizzle ? job->dim.x : (sz)job->dim.x * job->dim.y;
+
+	f32 angle_scale = 0.5f / g->angle;
+	f32 range_scale = 1.0f / (g->range.y - g->range.x);
+
+	u32 last_row = MIN(job->first_row + SCAN_CONVERT_ROWS, depth_count);
+	for (u32 row = job->first_row; row < last_row; row++) {
+		f32 pz = g->box.z + (g->box.w - g->box.z) * ((f32)row + 0.5f) / depth_count;
+		for (u32 x = 0; x < lateral_count; x++) {
+			f32 px = g->box.x + (g->box.y - g->box.x) * ((f32)x + 0.5f) / lateral_count;
+			f32 u  = atan2_f32(px, pz) * angle_scale + 0.5f;
+			f32 t  = (sqrt_f32(px * px + pz * pz) - g->range.x) * range_scale;
+
+			f32 *out = job->output + 2 * (row * depth_stride + x);
+			if (u < 0 || u > 1 || t < 0 || t > 1) {
+				for (u32 e = 0; e < elevation_count; e++) {
+					out[2 * e * elevation_stride + 0] = 0;
+					out[2 * e * elevation_stride + 1] = 0;
+				}
+				continue;
+			}
+
+			/* NOTE(rnp): bilinear with clamped edges; this matches the compute shader */
+			f32 fx = u * lateral_count - 0.5f;
+			f32 fy = t * depth_count   - 0.5f;
+			s32 x0 = (s32)floor_f32(fx), y0 = (s32)floor_f32(fy);
+			f32 wx = fx - x0, wy = fy - y0;
+			u32 x1 = MIN(x0 + 1, (s32)lateral_count - 1);
+			u32 y1 = MIN(y0 + 1, (s32)depth_count   - 1);
+			x0 = MAX(x0, 0);
+			y0 = MAX(y0, 0);
+
+			f32 *in = job->input;
+			sz i00 = 2 * (y0 * depth_stride + x0), i01 = 2 * (y0 * depth_stride + x1);
+			sz i10 = 2 * (y1 * depth_stride + x0), i11 = 2 * (y1 * depth_stride + x1);
+			f32 w00 = (1 - wx) * (1 - wy), w01 = wx * (1 - wy);
+			f32 w10 = (1 - wx) * wy,       w11 = wx * wy;
+			for (u32 e = 0; e < elevation_count; e++) {
+				sz base = 2 * e * elevation_stride;
+				for (u32 c = 0; c < 2; c++) {
+					out[base + c] = w00 * in[base + i00 + c] + w01 * in[base + i01 + c] +
+					                w10 * in[base + i10 + c] + w11 * in[base + i11 + c];
+				}
+			}
+		}
+	}
+
+	if (atomic_add_u32(job->remaining, -1) == 1)
+		os_wake_waiters(job->remaining);
+}
+
+function void
+scan_convert_cpu(WorkQueue *q, SectorGeometry geometry, Arena scratch, f32 *output, f32 *input,
+                 uv3 dim, b32 swizzle)
+{
+	u32 depth_count = swizzle ? dim.z : dim.y;
+	u32 job_count   = (depth_count + SCAN_CONVERT_ROWS - 1) / SCAN_CONVERT_ROWS;
+	u32 remaining   = job_count;
+	ScanConvertJob *jobs = push_array(&scratch, ScanConvertJob, job_count);
+	for (u32 i = 0; i < job_count; i++) {
+		jobs[i] = (ScanConvertJob){
+			.geometry  = geometry,
+			.input     = input,
+			.output    = output,
+			.dim       = dim,
+			.swizzle   = swizzle,
+			.first_row = i * SCAN_CONVERT_ROWS,
+			.remaining = &remaining,
+		};
+		work_queue_push(q, scan_convert_job, (sptr)(jobs + i));
+	}
+
+	for (u32 left; (left = atomic_load_u32(&remaining));) {
+		if (!work_queue_do_next(q))
+			os_wait_on_value(&remaining, left, U32_MAX);
+	}
+}
+
+#define SCAN_CONVERT_GROUP_SIZE  8
+#define SCAN_CONVERT_BOX_LOC     0
+#define SCAN_CONVERT_SECTOR_LOC  1
+#define SCAN_CONVERT_OFFSET_LOC  2
+#define SCAN_CONVERT_SWIZZLE_LOC 3
+
+/* NOTE(rnp): same resampling as scan_convert_job(); writes straight into the atlas.
+ * output_format must match the format the program was built for */
+function void
+scan_convert_gpu(u32 program, SectorGeometry geometry, u32 output, u32 output_format,
+                 uv3 output_offset, str8 input, uv3 dim, b32 swizzle)
+{
+	u32 texture = create_complex_texture(dim, GL_RG32F);
+	glTextureSubImage3D(texture, 0, 0, 0, 0, dim.x, dim.y, dim.z, GL_RG, GL_FLOAT, input.data);
+
+	v4 sector = {{0.5f / geometry.angle, geometry.range.x, 1.0f / (geometry.range.y - geometry.range.x)}};
+	s32 offset[3] = {output_offset.x, output_offset.y, output_offset.z};
+	glProgramUniform4fv(program, SCAN_CONVERT_BOX_LOC,     1, geometry.box.E);
+	glProgramUniform4fv(program, SCAN_CONVERT_SECTOR_LOC,  1, sector.E);
+	glProgramUniform3iv(program, SCAN_CONVERT_OFFSET_LOC,  1, offset);
+	glProgramUniform1i(program,  SCAN_CONVERT_SWIZZLE_LOC, swizzle);
+
+	glUseProgram(program);
+	glBindTextureUnit(0, texture);
+	glBindImageTexture(0, output, 0, GL_TRUE, 0, GL_WRITE_ONLY, output_format);
+	glDispatchCompute((dim.x + SCAN_CONVERT_GROUP_SIZE - 1) / SCAN_CONVERT_GROUP_SIZE,
+	                  (dim.y + SCAN_CONVERT_GROUP_SIZE - 1) / SCAN_CONVERT_GROUP_SIZE, dim.z);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glDeleteTextures(1, &texture);
+}
+
+/* NOTE(rnp): index_size is sizeof(u16) or sizeof(u32) */
+function RenderModel
+render_model_from_arrays(f32 *vertices, f32 *normals, u32 vertex_count, void *indices,
+                         u32 index_count, u32 index_size)
+{
+	RenderModel result = {0};
+
+	sz vert_size      = (sz)vertex_count * 3 * sizeof(f32);
+	sz ind_size       = (sz)index_count * index_size;
+	sz indices_offset = 2 * vert_size;
+	sz buffer_size    = indices_offset + ind_size;
+
+	result.elements        = index_count;
+	result.elements_offset = indices_offset;
+	result.index_type      = index_size == sizeof(u32) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+
+	glCreateBuffers(1, &result.buffer);
+	glNamedBufferStorage(result.buffer, MAX(buffer_size, 1), 0, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferSubData(result.buffer, 0,              vert_size, vertices);
+	glNamedBufferSubData(result.buffer, vert_size,      vert_size, normals);
+	glNamedBufferSubData(result.buffer, indices_offset, ind_size,  indices);
+
+	glCreateVertexArrays(1, &result.vao);
+	glVertexArrayVertexBuffer(result.vao, 0, result.buffer, 0,         3 * sizeof(f32));
+	glVertexArrayVertexBuffer(result.vao, 1, result.buffer, vert_size, 3 * sizeof(f32));
+	glVertexArrayElementBuffer(result.vao, result.buffer);
+
+	glEnableVertexArrayAttrib(result.vao, 0);
+	glEnableVertexArrayAttrib(result.vao, 1);
+
+	glVertexArrayAttribFormat(result.vao, 0, 3, GL_FLOAT, 0, 0);
+	glVertexArrayAttribFormat(result.vao, 1, 3, GL_FLOAT, 0, 0);
+
+	glVertexArrayAttribBinding(result.vao, 0, 0);
+	glVertexArrayAttribBinding(result.vao, 1, 1);
+
+	return result;
+}
+
+function RenderModel
+load_render_model(Arena arena, c8 *positions_file_name, c8 *indices_file_name, c8 *normals_file_name)
+{
+	str8 positions = os_read_whole_file(&arena, positions_file_name);
+	str8 normals   = os_read_whole_file(&arena, normals_file_name);
+	str8 indices   = os_read_whole_file(&arena, indices_file_name);
+
+	RenderModel result = render_model_from_arrays((f32 *)positions.data, (f32 *)normals.data,
+	                                              positions.len / (3 * sizeof(f32)), indices.data,
+	                                              indices.len / sizeof(u16), sizeof(u16));
+	return result;
+}
+
+function void
+vertex_array_add_volume_instances(u32 vao, u32 instances)
+{
+	glVertexArrayVertexBuffer(vao, 2, instances, 0, sizeof(u32));
+	glVertexArrayBindingDivisor(vao, 2, 1);
+	glEnableVertexArrayAttrib(vao, 2);
+	glVertexArrayAttribIFormat(vao, 2, 1, GL_UNSIGNED_INT, 0);
+	glVertexArrayAttribBinding(vao, 2, 2);
+}
+
+/* NOTE(rnp): groups volumes of the same shape into atlases and assigns each volume a
+ * slot and an index in the parameter buffer. the instances of an atlas are contiguous
+ * so that they can be drawn with a single call */
+function void
+init_volume_atlases(ViewerContext *ctx)
+{
+	s32 max_size = 0;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &max_size);
+
+	ctx->volume_atlases = push_array(&ctx->arena, VolumeAtlas, countof(volumes));
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + i;
+		uv3 size = {{v->width, v->height, v->depth}};
+
+		VolumeAtlas *atlas = 0;
+		for (u32 j = 0; !atlas && j < ctx->volume_atlas_count; j++) {
+			VolumeAtlas *a = ctx->volume_atlases + j;
+			if (a->used < a->slots && a->size.x == size.x && a->size.y == size.y && a->size.z == size.z)
+				atlas = a;
+		}
+
+		if (!atlas) {
+			atlas = ctx->volume_atlases + ctx->volume_atlas_count++;
+			atlas->size = size;
+			for (u32 axis = 1; axis < 3; axis++)
+				if (size.E[axis] < size.E[atlas->axis]) atlas->axis = axis;
+
+			u32 remaining = 0;
+			for (u32 j = i; j < countof(volumes); j++) {
+				remaining += volumes[j].width == size.x && volumes[j].height == size.y &&
+				             volumes[j].depth == size.z;
+			}
+			atlas->slots = CLAMP((u32)max_size / size.E[atlas->axis], 1, remaining);
+
+			uv3 texture_size = size;
+			texture_size.E[atlas->axis] *= atlas->slots;
+			atlas->texture = create_complex_texture(texture_size, ctx->profile.volume_format);
+
+			uv3 bricks = brick_grid_size(size);
+			bricks.E[atlas->axis] *= atlas->slots;
+			glCreateTextures(GL_TEXTURE_3D, 1, &atlas->brick_texture);
+			glTextureStorage3D(atlas->brick_texture, 1, GL_RG32F, bricks.x, bricks.y, bricks.z);
+			glTextureParameteri(atlas->brick_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTextureParameteri(atlas->brick_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+
+		v->atlas      = atlas - ctx->volume_atlases;
+		v->atlas_slot = atlas->used++;
+	}
+
+	u32 instance = 0;
+	for (u32 i = 0; i < ctx->volume_atlas_count; i++) {
+		ctx->volume_atlases[i].first_instance = instance;
+		instance += ctx->volume_atlases[i].used;
+	}
+
+	if (SCAN_CONVERT_ON_GPU) {
+		/* NOTE(rnp): the image format has to match the atlases' format */
+		Arena  scratch = ctx->arena;
+		Stream text    = arena_stream(scratch);
+		stream_append_str8s(&text, str8("#version 460 core\n#define VOLUME_FORMAT "),
+		                    ctx->profile.volume_format == GL_RG16F ? str8("rg16f") : str8("rg32f"),
+		                    str8("\n"));
+		stream_append_str8(&text, str8(""
+			"\n"
+			"layout(local_size_x = " str(SCAN_CONVERT_GROUP_SIZE) ", local_size_y = " str(SCAN_CONVERT_GROUP_SIZE) ") in;\n"
+			"\n"
+			"layout(location = " str(SCAN_CONVERT_BOX_LOC)     ") uniform vec4  u_box;\n"
+			"layout(location = " str(SCAN_CONVERT_SECTOR_LOC)  ") uniform vec4  u_sector;\n"
+			"layout(location = " str(SCAN_CONVERT_OFFSET_LOC)  ") uniform ivec3 u_output_offset;\n"
+			"layout(location = " str(SCAN_CONVERT_SWIZZLE_LOC) ") uniform bool  u_swizzle;\n"
+			"\n"
+			"layout(binding = 0)        uniform sampler3D u_input;\n"
+			"layout(binding = 0, VOLUME_FORMAT) uniform writeonly image3D u_output;\n"
+			"\n"
+			"vec2 fetch(ivec2 lateral_depth, int elevation)\n"
+			"{\n"
+			"\tivec3 coord = u_swizzle ? ivec3(lateral_depth.x, elevation, lateral_depth.y)\n"
+			"\t                        : ivec3(lateral_depth, elevation);\n"
+			"\treturn texelFetch(u_input, coord, 0).xy;\n"
+			"}\n"
+			"\n"
+			"void main()\n"
+			"{\n"
+			"\tivec3 size  = textureSize(u_input, 0);\n"
+			"\tivec3 voxel = ivec3(gl_GlobalInvocationID);\n"
+			"\tif (any(greaterThanEqual(voxel, size))) return;\n"
+			"\n"
+			"\tivec2 count     = u_swizzle ? size.xz  : size.xy;\n"
+			"\tivec2 index     = u_swizzle ? voxel.xz : voxel.xy;\n"
+			"\tint   elevation = u_swizzle ? voxel.y  : voxel.z;\n"
+			"\n"
+			"\tvec2 p = mix(u_box.xz, u_box.yw, (vec2(index) + 0.5) / vec2(count));\n"
+			"\tvec2 s = vec2(atan(p.x, p.y) * u_sector.x + 0.5, (length(p) - u_sector.y) * u_sector.z);\n"
+			"\n"
+			"\tvec2 value = vec2(0);\n"
+			"\tif (all(greaterThanEqual(s, vec2(0))) && all(lessThanEqual(s, vec2(1)))) {\n"
+			"\t\tvec2  f  = s * vec2(count) - 0.5;\n"
+			"\t\tivec2 i0 = ivec2(floor(f));\n"
+			"\t\tvec2  w  = f - vec2(i0);\n"
+			"\t\tivec2 i1 = min(i0 + 1, count - 1);\n"
+			"\t\ti0 = max(i0, 0);\n"
+			"\t\tvec2 a = mix(fetch(i0, elevation),              fetch(ivec2(i1.x, i0.y), elevation), w.x);\n"
+			"\t\tvec2 b = mix(fetch(ivec2(i0.x, i1.y), elevation), fetch(i1, elevation),              w.x);\n"
+			"\t\tvalue  = mix(a, b, w.y);\n"
+			"\t}\n"
+			"\timageStore(u_output, u_output_offset + voxel, vec4(value, 0, 0));\n"
+			"}\n"));
+		str8 shader = arena_stream_commit_zero(&scratch, &text);
+		ctx->scan_convert_shader = load_compute_shader(&ctx->os, scratch, shader,
+		                                               str8("scan convert"), str8("ScanConvert"));
+	}
+
+	/* NOTE(rnp): gl_BaseInstance is not core until 4.6; an instanced attribute holding
+	 * its own index gives the vertex shader the same value */
+	u32 instance_ids[countof(volumes)];
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + i;
+		v->instance     = ctx->volume_atlases[v->atlas].first_instance + v->atlas_slot;
+		instance_ids[i] = i;
+	}
+
+	glCreateBuffers(1, &ctx->volume_instances);
+	glNamedBufferStorage(ctx->volume_instances, sizeof(instance_ids), instance_ids, 0);
+	glCreateBuffers(1, &ctx->volume_parameters);
+	glNamedBufferStorage(ctx->volume_parameters, countof(volumes) * sizeof(VolumeParameters),
+	                     0, GL_DYNAMIC_STORAGE_BIT);
+	/* NOTE(rnp): a command per instance followed by the same commands in draw order */
+	glCreateBuffers(1, &ctx->volume_commands);
+	glNamedBufferStorage(ctx->volume_commands, 2 * countof(volumes) * sizeof(DrawArraysIndirectCommand),
+	                     0, GL_DYNAMIC_STORAGE_BIT);
+	ctx->volume_draw_order = push_array(&ctx->arena, u32, countof(volumes));
+
+	vertex_array_add_volume_instances(ctx->unit_cube.vao, ctx->volume_instances);
+
+	RenderModel *m = &ctx->volume_proxies;
+	glCreateBuffers(1, &m->buffer);
+	glCreateVertexArrays(1, &m->vao);
+	glVertexArrayVertexBuffer(m->vao, 0, m->buffer, 0, 3 * sizeof(f32));
+	glEnableVertexArrayAttrib(m->vao, 0);
+	glVertexArrayAttribFormat(m->vao, 0, 3, GL_FLOAT, 0, 0);
+	glVertexArrayAttribBinding(m->vao, 0, 0);
+	vertex_array_add_volume_instances(m->vao, ctx->volume_instances);
+
+	/* NOTE(rnp): one layer per volume instance; filled by update_transfer_function() */
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &ctx->transfer_function);
+	glTextureStorage3D(ctx->transfer_function, 1, GL_RGBA16F, TRANSFER_LUT_WIDTH,
+	                   TRANSFER_LUT_HEIGHT, countof(volumes));
+	glTextureParameteri(ctx->transfer_function, GL_TEXTURE_WRAP_S,     GL_CLAMP_TO_EDGE);
+	glTextureParameteri(ctx->transfer_function, GL_TEXTURE_WRAP_T,     GL_CLAMP_TO_EDGE);
+	glTextureParameteri(ctx->transfer_function, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(ctx->transfer_function, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+#define SLICE_GROUP_SIZE           8
+#define SLICE_ORIGIN_LOC           0
+#define SLICE_U_AXIS_LOC           1
+#define SLICE_V_AXIS_LOC           2
+#define SLICE_VOLUME_OFFSET_LOC    3
+#define SLICE_VOLUME_SIZE_LOC      4
+#define SLICE_THRESHOLD_SCALE_LOC  5
+#define SLICE_SWIZZLE_LOC          6
+#define SLICE_TRANSFER_LAYER_LOC   7
+#define SLICE_BACKGROUND_LOC       8
+
+/* NOTE(rnp): each slice is extracted into its own texture by a compute shader. slices
+ * are given in object space where the volume is the [-1, 1] cube */
+function void
+init_slices(ViewerContext *ctx)
+{
+	ctx->slice_shader = load_compute_shader(&ctx->os, ctx->arena, str8(""
+		"#version 460 core\n"
+		"\n"
+		"layout(local_size_x = " str(SLICE_GROUP_SIZE) ", local_size_y = " str(SLICE_GROUP_SIZE) ") in;\n"
+		"\n"
+		"layout(location = " str(SLICE_ORIGIN_LOC)          ") uniform vec3  u_origin;\n"
+		"layout(location = " str(SLICE_U_AXIS_LOC)          ") uniform vec3  u_u_axis;\n"
+		"layout(location = " str(SLICE_V_AXIS_LOC)          ") uniform vec3  u_v_axis;\n"
+		"layout(location = " str(SLICE_VOLUME_OFFSET_LOC)   ") uniform ivec3 u_volume_offset;\n"
+		"layout(location = " str(SLICE_VOLUME_SIZE_LOC)     ") uniform ivec3 u_volume_size;\n"
+		"layout(location = " str(SLICE_THRESHOLD_SCALE_LOC) ") uniform float u_threshold_scale;\n"
+		"layout(location = " str(SLICE_SWIZZLE_LOC)         ") uniform bool  u_swizzle;\n"
+		"layout(location = " str(SLICE_TRANSFER_LAYER_LOC)  ") uniform uint  u_transfer_layer;\n"
+		"layout(location = " str(SLICE_BACKGROUND_LOC)      ") uniform vec4  u_background;\n"
+		"\n"
+		"layout(binding = 0) uniform sampler3D      u_texture;\n"
+		"layout(binding = 2) uniform sampler2DArray u_transfer;\n"
+		"layout(binding = 0, rgba8) uniform writeonly image2D u_slice;\n"
+		"\n"
+		TRANSFER_LUT_GLSL
+		"vec2 fetch(ivec3 coord)\n"
+		"{\n"
+		"\tcoord = clamp(coord, ivec3(0), u_volume_size - 1);\n"
+		"\treturn texelFetch(u_texture, u_volume_offset + coord, 0).xy;\n"
+		"}\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"\tivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+		"\tif (any(greaterThanEqual(texel, imageSize(u_slice)))) return;\n"
+		"\n"
+		"\tvec2 st = (vec2(texel) + 0.5) / vec2(imageSize(u_slice));\n"
+		"\tvec3 p  = u_origin + st.x * u_u_axis + st.y * u_v_axis;\n"
+		"\n"
+		"\tvec4 result = u_background;\n"
+		"\tif (all(lessThanEqual(abs(p), vec3(1)))) {\n"
+		"\t\tvec3 coord = (p + 1) / 2;\n"
+		"\t\tvec3 tex   = u_swizzle ? coord.xzy : coord;\n"
+		"\n"
+		"\t\t/* NOTE: trilinear; the atlas is not filtered so that volumes do not bleed */\n"
+		"\t\tvec3  f  = tex * vec3(u_volume_size) - 0.5;\n"
+		"\t\tivec3 i  = ivec3(floor(f));\n"
+		"\t\tvec3  w  = f - vec3(i);\n"
+		"\t\tvec2 c00 = mix(fetch(i + ivec3(0, 0, 0)), fetch(i + ivec3(1, 0, 0)), w.x);\n"
+		"\t\tvec2 c10 = mix(fetch(i + ivec3(0, 1, 0)), fetch(i + ivec3(1, 1, 0)), w.x);\n"
+		"\t\tvec2 c01 = mix(fetch(i + ivec3(0, 0, 1)), fetch(i + ivec3(1, 0, 1)), w.x);\n"
+		"\t\tvec2 c11 = mix(fetch(i + ivec3(0, 1, 1)), fetch(i + ivec3(1, 1, 1)), w.x);\n"
+		"\t\tvec2 smp = mix(mix(c00, c10, w.y), mix(c01, c11, w.y), w.z);\n"
+		"\n"
+		"\t\tvec2 lut = transfer_lut_coordinate(length(smp) * u_threshold_scale, coord.y);\n"
+		"\t\tresult = vec4(texture(u_transfer, vec3(lut, u_transfer_layer)).rgb, 1);\n"
+		"\t}\n"
+		"\timageStore(u_slice, texel, result);\n"
+		"}\n"), str8("slice"), str8("Slice"));
+
+	for (u32 i = 0; i < countof(mpr_slices); i++) {
+		MPRSliceItem *s = mpr_slices + i;
+		glCreateTextures(GL_TEXTURE_2D, 1, &s->texture);
+		glTextureStorage2D(s->texture, 1, GL_RGBA8, MPR_SLICE_SIZE, MPR_SLICE_SIZE);
+		glTextureParameteri(s->texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(s->texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		LABEL_GL_OBJECT(GL_TEXTURE, s->texture, str8("Slice"));
+	}
+}
+
+#define PROJECTION_AXES_LOC            0
+#define PROJECTION_DEPTH_AXIS_LOC      1
+#define PROJECTION_VOLUME_OFFSET_LOC   2
+#define PROJECTION_VOLUME_SIZE_LOC     3
+#define PROJECTION_THRESHOLD_SCALE_LOC 4
+#define PROJECTION_TRANSFER_LAYER_LOC  5
+#define PROJECTION_BACKGROUND_LOC      6
+
+function void
+init_projections(ViewerContext *ctx)
+{
+	ctx->projection_shader = load_compute_shader(&ctx->os, ctx->arena, str8(""
+		"#version 460 core\n"
+		"\n"
+		"layout(local_size_x = " str(SLICE_GROUP_SIZE) ", local_size_y = " str(SLICE_GROUP_SIZE) ") in;\n"
+		"\n"
+		"layout(location = " str(PROJECTION_AXES_LOC)            ") uniform ivec3 u_axes;\n"
+		"layout(location = " str(PROJECTION_DEPTH_AXIS_LOC)      ") uniform int   u_depth_axis;\n"
+		"layout(location = " str(PROJECTION_VOLUME_OFFSET_LOC)   ") uniform ivec3 u_volume_offset;\n"
+		"layout(location = " str(PROJECTION_VOLUME_SIZE_LOC)     ") uniform ivec3 u_volume_size;\n"
+		"layout(location = " str(PROJECTION_THRESHOLD_SCALE_LOC) ") uniform float u_threshold_scale;\n"
+		"layout(location = " str(PROJECTION_TRANSFER_LAYER_LOC)  ") uniform uint  u_transfer_layer;\n"
+		"layout(location = " str(PROJECTION_BACKGROUND_LOC)      ") uniform vec4  u_background;\n"
+		"\n"
+		"layout(binding = 0) uniform sampler3D      u_texture;\n"
+		"layout(binding = 2) uniform sampler2DArray u_transfer;\n"
+		"layout(binding = 0, rgba8) uniform writeonly image2D u_projection;\n"
+		"\n"
+		TRANSFER_LUT_GLSL
+		"void main()\n"
+		"{\n"
+		"\tivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+		"\tivec2 size  = imageSize(u_projection);\n"
+		"\tif (any(greaterThanEqual(texel, size))) return;\n"
+		"\n"
+		"\tivec3 coord;\n"
+		"\tcoord[u_axes.x] = texel.x;\n"
+		"\tcoord[u_axes.y] = texel.y;\n"
+		"\n"
+		"\tint   count      = u_volume_size[u_axes.z];\n"
+		"\tfloat depth_size = float(u_axes.z == u_depth_axis ? count : size[u_axes.x == u_depth_axis ? 0 : 1]);\n"
+		"\tfloat value  = 0;\n"
+		"\tvec3  colour = vec3(0);\n"
+		"\tfor (int i = 0; i < count; i++) {\n"
+		"\t\tcoord[u_axes.z] = i;\n"
+		"\t\tfloat smp = length(texelFetch(u_texture, u_volume_offset + coord, 0).xy);\n"
+		"\t\tvec2  lut = transfer_lut_coordinate(smp * u_threshold_scale, (coord[u_depth_axis] + 0.5) / depth_size);\n"
+		"\t\tvec4 display = texture(u_transfer, vec3(lut, u_transfer_layer));\n"
+		"\t\tif (display.a > value) {\n"
+		"\t\t\tvalue  = display.a;\n"
+		"\t\t\tcolour = display.rgb;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\timageStore(u_projection, texel, value > 0 ? vec4(colour, 1) : u_background);\n"
+		"}\n"), str8("projection"), str8("Projection"));
+}
+
+#define GALLERY_SPRITE_PROJECTION_LOC 0
+
+/* NOTE(rnp): std430 layout of an entry in the gallery sprite buffer */
+typedef struct {
+	v4  rect;   /* view space x0, y0, x1, y1 */
+	f32 depth;  /* view space z */
+	u32 layer;
+	u32 _pad[2];
+} GallerySprite;
+
+function void
+init_gallery(ViewerContext *ctx)
+{
+	Gallery *g    = &ctx->gallery;
+	g->item_count = GALLERY_ITEMS ? GALLERY_ITEMS : countof(volumes);
+	g->items      = push_array(&ctx->arena, GalleryItem, g->item_count);
+
+	RenderContext *rc = &g->sprite_render_context;
+	rc->shader = load_shader(&ctx->os, ctx->arena, str8(""
+		"#version 460 core\n"
+		"\n"
+		"struct Sprite {\n"
+		"\tvec4  rect;\n"
+		"\tfloat depth;\n"
+		"\tuint  layer;\n"
+		"};\n"
+		"\n"
+		"layout(std430, binding = 1) readonly restrict buffer Sprites {\n"
+		"\tSprite sprites[];\n"
+		"};\n"
+		"\n"
+		"layout(location = " str(GALLERY_SPRITE_PROJECTION_LOC) ") uniform mat4 u_projection;\n"
+		"\n"
+		"layout(location = 0) out vec2 f_texture_coordinate;\n"
+		"layout(location = 1) flat out uint f_layer;\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"\tSprite sprite = sprites[gl_InstanceID];\n"
+		"\tvec2   corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+		"\tf_texture_coordinate = corner;\n"
+		"\tf_layer              = sprite.layer;\n"
+		"\tgl_Position = u_projection * vec4(mix(sprite.rect.xy, sprite.rect.zw, corner), sprite.depth, 1);\n"
+		"}\n"), str8(""
+		"#version 460 core\n"
+		"\n"
+		"layout(location = 0) in vec2 texture_coordinate;\n"
+		"layout(location = 1) flat in uint layer;\n"
+		"\n"
+		"layout(location = 0) out vec4 out_colour;\n"
+		"\n"
+		"layout(binding = 0) uniform sampler2DArray u_impostors;\n"
+		"\n"
+		"/* NOTE: impostors hold premultiplied colour */\n"
+		"void main()\n"
+		"{\n"
+		"\tout_colour = texture(u_impostors, vec3(texture_coordinate, layer));\n"
+		"\tif (out_colour.a == 0) discard;\n"
+		"}\n"), str8("gallery sprite"), str8("Gallery Sprite"));
+	if (!rc->shader) return;
+
+	glCreateVertexArrays(1, &rc->vao);
+
+	glCreateBuffers(1, &g->sprites);
+	glNamedBufferStorage(g->sprites, g->item_count * sizeof(GallerySprite), 0, GL_DYNAMIC_STORAGE_BIT);
+
+	/* NOTE(rnp): one layer per cell; a layer is attached to the framebuffer to redraw it */
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &g->impostor_texture);
+	glTextureStorage3D(g->impostor_texture, 1, GL_RGBA8, GALLERY_IMPOSTOR_SIZE,
+	                   GALLERY_IMPOSTOR_SIZE, g->item_count);
+	glTextureParameteri(g->impostor_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(g->impostor_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(g->impostor_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(g->impostor_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	LABEL_GL_OBJECT(GL_TEXTURE, g->impostor_texture, str8("Gallery Impostors"));
+
+	glCreateRenderbuffers(1, &g->impostor_depth);
+	glNamedRenderbufferStorageMultisample(g->impostor_depth, 0, GL_DEPTH24_STENCIL8,
+	                                      GALLERY_IMPOSTOR_SIZE, GALLERY_IMPOSTOR_SIZE);
+	glCreateFramebuffers(1, &g->impostor_fb);
+	glNamedFramebufferRenderbuffer(g->impostor_fb, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+	                               g->impostor_depth);
+}
+
+/* NOTE(rnp): returns 0 (and drops the event) if the consumer is a whole queue behind */
+function b32
+viewer_event_push(ViewerEventQueue *q, ViewerEvent event)
+{
+	u32 write  = q->write_index;
+	b32 result = write - atomic_load_u32(&q->read_index) < countof(q->items);
+	if (result) {
+		q->items[write % countof(q->items)] = event;
+		atomic_store_u32(&q->write_index, write + 1);
+		os_wake_waiters(&q->write_index);
+	}
+	return result;
+}
+
+function void
+scroll_callback(GLFWwindow *window, f64 x, f64 y)
+{
+	ViewerContext *ctx = glfwGetWindowUserPointer(window);
+	viewer_event_push(&ctx->events, (ViewerEvent){.kind = ViewerEventKind_Scroll, .scroll = y});
+}
+
+function void
+key_callback(GLFWwindow *window, s32 key, s32 scancode, s32 action, s32 modifiers)
+{
+	ViewerContext *ctx = glfwGetWindowUserPointer(window);
+	viewer_event_push(&ctx->events, (ViewerEvent){.kind = ViewerEventKind_Key,
+	                  .key = {.key = key, .action = action, .modifiers = modifiers}});
+}
+
+/* NOTE(rnp): returns 1 if the key changed what is drawn */
+function b32
+viewer_key(ViewerContext *ctx, s32 key, s32 action, s32 modifiers)
+{
+	b32 result = 0;
+	b32 press  = action == GLFW_PRESS;
+	b32 repeat = action != GLFW_RELEASE;
+
+	if (key == GLFW_KEY_ESCAPE && press)
+		ctx->should_exit = 1;
+
+	if (key == GLFW_KEY_SPACE && press) {
+		ctx->demo_mode = !ctx->demo_mode;
+		result = 1;
+	}
+
+	if (key == GLFW_KEY_R && press) {
+		ctx->render_mode = (ctx->render_mode + 1) % RenderMode_Count;
+		result = 1;
+	}
+
+	if ((key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET) && repeat) {
+		f32 step = key == GLFW_KEY_LEFT_BRACKET ? -THRESHOLD_STEP : THRESHOLD_STEP;
+		for (u32 i = 0; i < countof(volumes); i++)
+			volumes[i].threshold += step;
+		result = 1;
+	}
+
+	if (key == GLFW_KEY_T && press)
+		gpu_timers_print(&ctx->gpu_timers);
+
+	if (key == GLFW_KEY_F12 && press && ctx->output_frames_count == 0) {
+		if (export_sinks_open(&ctx->export_sinks, ctx->work_queue, OUTPUT_FORMAT,
+		                      c_str_to_str8(frame_sink_output_paths[OUTPUT_FORMAT]),
+		                      OUTPUT_MIP_LEVELS, (sv2){{RENDER_TARGET_SIZE}}))
+		{
+			ctx->output_frames_count = TOTAL_OUTPUT_FRAMES;
+			ctx->cycle_t = 0;
+			gpu_timers_reset(&ctx->gpu_timers);
+			result = 1;
+		} else {
+			fputs("failed to open output file, video won't be saved\n", stderr);
+		}
+	}
+
+	/* NOTE(rnp): scrubbing snaps to the output frame grid so that frames can be cached */
+	u32 grid_count = OUTPUT_FRAME_RATE * OUTPUT_TIME_SECONDS;
+	u32 grid_index = (u32)(ctx->cycle_t * grid_count + 0.5f) % grid_count;
+	if (key == GLFW_KEY_A && repeat) {
+		ctx->cycle_t = cycle_t_from_grid((grid_index + SCRUB_FRAME_STEP) % grid_count);
+		result = 1;
+	}
+	if (key == GLFW_KEY_D && repeat) {
+		ctx->cycle_t = cycle_t_from_grid((grid_index + grid_count - SCRUB_FRAME_STEP) % grid_count);
+		result = 1;
+	}
+	if ((key == GLFW_KEY_W || key == GLFW_KEY_S) && repeat) {
+		ctx->camera_angle += (key == GLFW_KEY_W ? 5 : -5) * PI / 180.0f;
+		result = 1;
+	}
+
+	if (key == GLFW_KEY_M && press && ctx->slice_shader) {
+		ctx->show_slices = !ctx->show_slices;
+		result = 1;
+	}
+	if (key == GLFW_KEY_P && press && ctx->projection_shader) {
+		ctx->projection_volume = (ctx->projection_volume + 1) % (countof(volumes) + 1);
+		result = 1;
+	}
+
+	Gallery *gallery  = &ctx->gallery;
+	u32 gallery_rows  = (gallery->item_count + GALLERY_COLUMNS - 1) / GALLERY_COLUMNS;
+	if (key == GLFW_KEY_G && press && gallery->sprite_render_context.shader) {
+		gallery->shown = !gallery->shown;
+		result = 1;
+	}
+	if (key == GLFW_KEY_PAGE_DOWN && repeat && gallery->first_row + 1 < gallery_rows) {
+		gallery->first_row++;
+		result = 1;
+	}
+	if (key == GLFW_KEY_PAGE_UP && repeat && gallery->first_row > 0) {
+		gallery->first_row--;
+		result = 1;
+	}
+
+	/* NOTE(rnp): hidden slices are left alone */
+	if (ctx->show_slices) {
+		MPRSliceItem *slice = mpr_slices + ctx->selected_slice;
+		if (key == GLFW_KEY_TAB && press) {
+			ctx->selected_slice = (ctx->selected_slice + 1) % countof(mpr_slices);
+			result = 1;
+		}
+		if ((key == GLFW_KEY_UP || key == GLFW_KEY_DOWN) && repeat) {
+			slice->offset_mm += (key == GLFW_KEY_UP ? 1 : -1) * MPR_OFFSET_STEP_MM;
+			result = 1;
+		}
+		if ((key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT) && repeat) {
+			f32 angle = (key == GLFW_KEY_LEFT ? -1 : 1) * MPR_ROTATE_STEP * PI / 180.0f;
+			f32 sa = sin_f32(angle), ca = cos_f32(angle);
+			v3  n  = slice->normal;
+			if (modifiers & GLFW_MOD_SHIFT) slice->normal = (v3){{n.x, ca * n.y - sa * n.z, sa * n.y + ca * n.z}};
+			else                            slice->normal = (v3){{ca * n.x - sa * n.y, sa * n.x + ca * n.y, n.z}};
+			result = 1;
+		}
+	}
+
+	return result;
+}
+
+function void
+release_render_targets(ViewerContext *ctx)
+{
+	RenderTarget *rt = &ctx->multisample_target;
+	if (RENDER_ACCUMULATION_SAMPLES) {
+		glDeleteTextures(1, rt->textures);
+		glDeleteRenderbuffers(1, rt->textures + 1);
+		glDeleteTextures(1, ctx->accumulation_target.textures);
+		glDeleteFramebuffers(1, &ctx->accumulation_target.fb);
+	} else {
+		glDeleteRenderbuffers(countof(rt->textures), rt->textures);
+	}
+	glDeleteFramebuffers(1, &rt->fb);
+
+	rt = &ctx->interactive_target;
+	glDeleteRenderbuffers(countof(rt->textures), rt->textures);
+	glDeleteFramebuffers(1, &rt->fb);
+
+	glDeleteTextures(countof(ctx->output_target.textures), ctx->output_target.textures);
+	glDeleteFramebuffers(1, &ctx->output_target.fb);
+	glDeleteTextures(1, ctx->cache_target.textures);
+	glDeleteFramebuffers(1, &ctx->cache_target.fb);
+	glDeleteTextures(countof(ctx->volume_layers.textures), ctx->volume_layers.textures);
+	glDeleteFramebuffers(1, &ctx->volume_layers.fb);
+
+	zero_struct(&ctx->multisample_target);
+	zero_struct(&ctx->accumulation_target);
+	zero_struct(&ctx->interactive_target);
+	zero_struct(&ctx->output_target);
+	zero_struct(&ctx->cache_target);
+	zero_struct(&ctx->volume_layers);
+}
+
+/* NOTE(rnp): (re)creates every render target at size. export contexts always use the full
+ * render target size while interactive contexts follow the size the view is displayed at */
+function void
+init_render_targets(ViewerContext *ctx, sv2 size)
+{
+	release_render_targets(ctx);
+
+	RenderTarget *rt = &ctx->multisample_target;
+	rt->size = size;
+	if (RENDER_ACCUMULATION_SAMPLES) {
+		/* NOTE(rnp): single sampled; the colour is sampled when accumulating */
+		glCreateTextures(GL_TEXTURE_2D, 1, rt->textures);
+		glTextureStorage2D(rt->textures[0], 1, GL_RGBA8, size.w, size.h);
+		glCreateRenderbuffers(1, rt->textures + 1);
+		glNamedRenderbufferStorageMultisample(rt->textures[1], 0, GL_DEPTH24_STENCIL8,
+		                                      size.w, size.h);
+		glCreateFramebuffers(1, &rt->fb);
+		glNamedFramebufferTexture(rt->fb, GL_COLOR_ATTACHMENT0, rt->textures[0], 0);
+		glNamedFramebufferRenderbuffer(rt->fb, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+		                               rt->textures[1]);
+
+		rt = &ctx->accumulation_target;
+		rt->size = size;
+		glCreateTextures(GL_TEXTURE_2D, 1, rt->textures);
+		glTextureStorage2D(rt->textures[0], 1, GL_RGBA16F, size.w, size.h);
+		glCreateFramebuffers(1, &rt->fb);
+		glNamedFramebufferTexture(rt->fb, GL_COLOR_ATTACHMENT0, rt->textures[0], 0);
+		/* NOTE(rnp): alpha is masked off while accumulating so it stays 1 */
+		glClearNamedFramebufferfv(rt->fb, GL_COLOR, 0, (f32 []){0, 0, 0, 1});
+	} else {
+		glCreateRenderbuffers(countof(rt->textures), rt->textures);
+		glNamedRenderbufferStorageMultisample(rt->textures[0], ctx->profile.msaa_samples,
+		                                      GL_RGBA8, size.w, size.h);
+		glNamedRenderbufferStorageMultisample(rt->textures[1], ctx->profile.msaa_samples,
+		                                      GL_DEPTH24_STENCIL8, size.w, size.h);
+		glCreateFramebuffers(1, &rt->fb);
+		glNamedFramebufferRenderbuffer(rt->fb, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rt->textures[0]);
+		glNamedFramebufferRenderbuffer(rt->fb, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rt->textures[1]);
+	}
+
+	/* NOTE(rnp): size is set to the region drawn each frame */
+	if (!ctx->headless) {
+		rt = &ctx->interactive_target;
+		glCreateRenderbuffers(countof(rt->textures), rt->textures);
+		glNamedRenderbufferStorageMultisample(rt->textures[0], ctx->profile.interactive_msaa_samples,
+		                                      GL_RGBA8, size.w, size.h);
+		glNamedRenderbufferStorageMultisample(rt->textures[1], ctx->profile.interactive_msaa_samples,
+		                                      GL_DEPTH24_STENCIL8, size.w, size.h);
+		glCreateFramebuffers(1, &rt->fb);
+		glNamedFramebufferRenderbuffer(rt->fb, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rt->textures[0]);
+		glNamedFramebufferRenderbuffer(rt->fb, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rt->textures[1]);
+	}
+
+	u32 levels = 1;
+	while (levels < EXPORT_MAX_MIP_LEVELS && (MAX(size.w, size.h) >> levels)) levels++;
+
+	rt = &ctx->output_target;
+	glCreateTextures(GL_TEXTURE_2D, countof(rt->textures), rt->textures);
+	rt->size = size;
+	glTextureStorage2D(rt->textures[0], levels, GL_RGBA8,          size.w, size.h);
+	glTextureStorage2D(rt->textures[1], 1, GL_DEPTH_COMPONENT24, size.w, size.h);
+
+	glCreateFramebuffers(1, &rt->fb);
+	glNamedFramebufferTexture(rt->fb, GL_COLOR_ATTACHMENT0, rt->textures[0], 0);
+	glNamedFramebufferTexture(rt->fb, GL_DEPTH_ATTACHMENT,  rt->textures[1], 0);
+
+	/* NOTE(rnp): without the mip chain the overlay only ever samples the base level */
+	u32 min_filter = ctx->profile.output_mips ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+	glTextureParameteri(rt->textures[0], GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(rt->textures[0], GL_TEXTURE_MIN_FILTER, min_filter);
+
+	/* NOTE(rnp): resolve target for frames rendered in the background for the frame cache */
+	rt = &ctx->cache_target;
+	glCreateTextures(GL_TEXTURE_2D, 1, rt->textures);
+	rt->size = size;
+	glTextureStorage2D(rt->textures[0], 1, GL_RGBA8, size.w, size.h);
+	glCreateFramebuffers(1, &rt->fb);
+	glNamedFramebufferTexture(rt->fb, GL_COLOR_ATTACHMENT0, rt->textures[0], 0);
+
+	/* NOTE(rnp): one layer per volume instance with the multisample target's size and
+	 * sample count; the layers are attached one at a time while drawing them */
+	if (ctx->composite_render_context.shader) {
+		rt = &ctx->volume_layers;
+		rt->size = size;
+		glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, countof(rt->textures), rt->textures);
+		glTextureStorage3DMultisample(rt->textures[0], ctx->profile.msaa_samples, GL_RGBA8,
+		                              size.w, size.h, countof(volumes), 1);
+		glTextureStorage3DMultisample(rt->textures[1], ctx->profile.msaa_samples, GL_DEPTH24_STENCIL8,
+		                              size.w, size.h, countof(volumes), 1);
+		glCreateFramebuffers(1, &rt->fb);
+		for (u32 i = 0; i < countof(volumes); i++)
+			volumes[i].layer_hash = 0;
+	}
+}
+
+/* NOTE(rnp): side of the square panels showing slices and projections; they are stacked
+ * in a column on the right of the window when shown */
+function s32
+panel_size(ViewerContext *ctx)
+{
+	s32 count = 0;
+	if (ctx->show_slices)       count += countof(mpr_slices);
+	if (ctx->projection_volume) count += 3;
+
+	s32 result = 0;
+	if (count) result = MIN(ctx->window_size.h / count, ctx->window_size.w / 3);
+	return result;
+}
+
+/* NOTE(rnp): part of the window left for the view */
+function sv2
+view_area_size(ViewerContext *ctx)
+{
+	sv2 result = ctx->window_size;
+	result.w  -= panel_size(ctx);
+	return result;
+}
+
+/* NOTE(rnp): region of the window the output is shown in; letterboxed to the export aspect */
+function sv2
+overlay_target_size(ViewerContext *ctx)
+{
+	f32 aspect_ratio = (f32)RENDER_TARGET_WIDTH / (f32)RENDER_TARGET_HEIGHT;
+	sv2 area         = view_area_size(ctx);
+	sv2 result       = area;
+	if (aspect_ratio > 1) result.h = result.w / aspect_ratio;
+	else                  result.w = result.h * aspect_ratio;
+
+	if (result.w > area.w) {
+		result.w = area.w;
+		result.h = area.w / aspect_ratio;
+	} else if (result.h > area.h) {
+		result.h = area.h;
+		result.w = result.h * aspect_ratio;
+	}
+	return result;
+}
+
+/* NOTE(rnp): the interactive view is drawn at the size it is displayed at. it is capped
+ * at the render target size so frames still fit in the frame cache's buffers */
+function sv2
+view_render_size(ViewerContext *ctx)
+{
+	sv2 result = overlay_target_size(ctx);
+	result.w   = CLAMP(result.w, 1, RENDER_TARGET_WIDTH);
+	result.h   = CLAMP(result.h, 1, RENDER_TARGET_HEIGHT);
+	return result;
+}
+
+/* NOTE(rnp): the output only needs mips when the overlay draws it minified */
+function b32
+overlay_needs_mips(ViewerContext *ctx)
+{
+	sv2 shown  = overlay_target_size(ctx);
+	b32 result = ctx->output_target.size.w > shown.w || ctx->output_target.size.h > shown.h;
+	result    &= ctx->profile.output_mips;
+	return result;
+}
+
+function void
+generate_output_mips(ViewerContext *ctx)
+{
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Mipmaps);
+	glGenerateTextureMipmap(ctx->output_target.textures[0]);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+}
+
+function void
+fb_callback(GLFWwindow *window, s32 w, s32 h)
+{
+	ViewerContext *ctx = glfwGetWindowUserPointer(window);
+	viewer_event_push(&ctx->events, (ViewerEvent){.kind = ViewerEventKind_Resize,
+	                  .size = {.w = w, .h = h}});
+}
+
+function void
+refresh_callback(GLFWwindow *window)
+{
+	ViewerContext *ctx = glfwGetWindowUserPointer(window);
+	viewer_event_push(&ctx->events, (ViewerEvent){.kind = ViewerEventKind_Refresh});
+}
+
+/* NOTE(rnp): applies the events recorded since the last frame. only events which change
+ * what is drawn cause an update */
+function void
+viewer_handle_events(ViewerContext *ctx)
+{
+	ViewerEventQueue *q = &ctx->events;
+
+	/* NOTE(rnp): files_changed is cleared before the watches are scanned; a watch flagged
+	 * meanwhile is either seen now or flags files_changed again */
+	if (atomic_load_u32(&q->files_changed)) {
+		atomic_store_u32(&q->files_changed, 0);
+		FileWatchContext *fwctx = &ctx->os.file_watch_context;
+		for (sz i = 0; i < fwctx->count; i++) {
+			FileWatchDirectory *dir = fwctx->data + i;
+			for (sz j = 0; j < dir->count; j++) {
+				FileWatch *fw = dir->data + j;
+				if (!atomic_load_u32(&fw->pending)) continue;
+				atomic_store_u32(&fw->pending, 0);
+
+				Arena  scratch = ctx->arena;
+				Stream path    = stream_alloc(&scratch, dir->name.len + fw->name.len + 2);
+				stream_append_str8s(&path, dir->name, str8(OS_PATH_SEPARATOR), fw->name);
+				stream_append_byte(&path, 0);
+				stream_commit(&path, -1);
+				ctx->do_update |= fw->callback(&ctx->os, stream_to_str8(&path), fw->user_data, scratch);
+			}
+		}
+	}
+
+	u32 write = atomic_load_u32(&q->write_index);
+	for (u32 read = q->read_index; read != write; read++) {
+		ViewerEvent *e = q->items + read % countof(q->items);
+		switch (e->kind) {
+		case ViewerEventKind_Key: {
+			ctx->do_update |= viewer_key(ctx, e->key.key, e->key.action, e->key.modifiers);
+		} break;
+		case ViewerEventKind_Scroll: {
+			ctx->camera_fov += e->scroll;
+			ctx->do_update  |= e->scroll != 0;
+		} break;
+		case ViewerEventKind_Resize: {
+			ctx->do_update  |= e->size.w != ctx->window_size.w || e->size.h != ctx->window_size.h;
+			ctx->window_size = e->size;
+		} break;
+		case ViewerEventKind_Refresh: {
+			/* NOTE(rnp): the window contents were lost and must be drawn again */
+			ctx->do_update = 1;
+		} break;
+		case ViewerEventKind_Wake: break;
+		}
+		/* NOTE(rnp): the slot is only released once the event has been applied */
+		atomic_store_u32(&q->read_index, read + 1);
+	}
+}
+
+/* NOTE(rnp): ctx->profile.kind may be set before the context is created to override
+ * RENDER_PROFILE. must run before any render target or volume atlas is created */
+function void
+select_render_profile(ViewerContext *ctx)
+{
+	RenderProfile *p = &ctx->profile;
+	str8 renderer    = c_str_to_str8((c8 *)glGetString(GL_RENDERER));
+	if (p->kind == RenderProfile_Auto) p->kind = RENDER_PROFILE;
+	if (p->kind == RenderProfile_Auto) {
+		p->kind = RenderProfile_Hardware;
+		for (u32 i = 0; i < countof(software_renderer_names); i++)
+			if (str8_contains_str8(renderer, software_renderer_names[i]))
+				p->kind = RenderProfile_Software;
+	}
+
+	s32 max_samples = 1;
+	glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+	if (p->kind == RenderProfile_Software) {
+		p->msaa_samples             = SOFTWARE_MSAA_SAMPLES;
+		p->interactive_msaa_samples = SOFTWARE_INTERACTIVE_MSAA_SAMPLES;
+		p->volume_format            = GL_RG16F;
+		p->output_mips              = 0;
+		/* NOTE(rnp): llvmpipe starts one rasteriser thread per processor by default */
+		p->rasteriser_threads       = os_get_processor_count();
+	} else {
+		p->msaa_samples             = RENDER_MSAA_SAMPLES;
+		p->interactive_msaa_samples = INTERACTIVE_MSAA_SAMPLES;
+		p->volume_format            = GL_RG32F;
+		p->output_mips              = 1;
+		p->rasteriser_threads       = 0;
+	}
+	/* NOTE(rnp): the volume layers are multisampled textures which need at least 1 sample */
+	p->msaa_samples             = CLAMP(p->msaa_samples, 1, (u32)max_samples);
+	p->interactive_msaa_samples = MIN(p->interactive_msaa_samples, (u32)max_samples);
+
+	Stream buf = arena_stream(ctx->arena);
+	stream_append_str8s(&buf, str8("render profile: "), render_profile_names[p->kind],
+	                    str8(" ("), renderer, str8(")\n"));
+	os_write_file(ctx->os.error_handle, stream_to_str8(&buf));
+}
+
+function void
+init_viewer(ViewerContext *ctx)
+{
+	ctx->demo_mode     = 1;
+	ctx->window_size   = (sv2){.w = 640, .h = 640};
+	ctx->camera_radius = CAMERA_RADIUS;
+	ctx->camera_angle  = -CAMERA_ELEVATION_ANGLE * PI / 180.0f;
+	ctx->camera_fov    = 60.0f;
+	ctx->dynamic_range = DYNAMIC_RANGE;
+	ctx->render_mode   = RENDER_MODE;
+
+	ctx->work_queue = push_struct(&ctx->arena, WorkQueue);
+	work_queue_init(ctx->work_queue, ctx->process_count);
 
 	if (!glfwInit()) os_fatal(str8("failed to start glfw\n"));
+#if CPU_TRACE
+	if (!trace_context.sync_ticks) {
+		trace_context.sync_ticks   = read_cpu_timer();
+		trace_context.sync_seconds = glfwGetTime();
+	}
+#endif
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	/* NOTE(rnp): headless contexts only ever render into our own framebuffers */
+	if (ctx->headless) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	ctx->window = glfwCreateWindow(ctx->window_size.w, ctx->window_size.h, "3D Viewer", 0, 0);
+	if (!ctx->window) os_fatal(str8("failed to open window\n"));
+	glfwMakeContextCurrent(ctx->window);
+	glfwSetWindowUserPointer(ctx->window, ctx);
+	glfwSwapInterval(1);
+
+	glfwSetKeyCallback(ctx->window, key_callback);
+	glfwSetScrollCallback(ctx->window, scroll_callback);
+	glfwSetWindowRefreshCallback(ctx->window, refresh_callback);
+	glfwSetFramebufferSizeCallback(ctx->window, fb_callback);
+
+	#define X(name, ret, params) name = (name##_fn *)glfwGetProcAddress(#name);
+	OGLProcedureList
+	#undef X
+
+	/* NOTE: set up OpenGL debug logging */
+	struct gl_debug_ctx *gl_debug_ctx = push_struct(&ctx->arena, typeof(*gl_debug_ctx));
+	gl_debug_ctx->stream = stream_alloc(&ctx->arena, KB(4));
+	gl_debug_ctx->os     = &ctx->os;
+	glDebugMessageCallback(gl_debug_logger, gl_debug_ctx);
+#ifdef _DEBUG
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+
+	select_render_profile(ctx);
+
+	/* NOTE(rnp): let the driver pick how many threads it compiles shaders on; shaders are
+	 * then compiled in the background until their status is queried */
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+
+	if (GPU_TIMERS) gpu_timers_init(&ctx->gpu_timers);
+
+	glEnable(GL_MULTISAMPLE);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	if (RENDER_ACCUMULATION_SAMPLES) {
+		RenderContext *arc = &ctx->accumulate_render_context;
+		glCreateVertexArrays(1, &arc->vao);
+		arc->shader = load_shader(&ctx->os, ctx->arena, str8(""
+			"#version 460 core\n"
+			"\n"
+			"void main()\n"
+			"{\n"
+			"\tvec2 pos  = vec2((gl_VertexID & 1) * 4 - 1, (gl_VertexID & 2) * 2 - 1);\n"
+			"\tgl_Position = vec4(pos, 0, 1);\n"
+			"}\n"), str8(""
+			"#version 460 core\n"
+			"\n"
+			"layout(location = 0) out vec4 out_colour;\n"
+			"\n"
+			"layout(location = " str(ACCUMULATE_WEIGHT_LOC) ") uniform float u_weight;\n"
+			"\n"
+			"layout(binding = 0) uniform sampler2D u_texture;\n"
+			"\n"
+			"void main()\n"
+			"{\n"
+			"\tout_colour = vec4(texelFetch(u_texture, ivec2(gl_FragCoord.xy), 0).xyz, u_weight);\n"
+			"}\n"), str8("accumulate"), str8("Accumulate"));
+		if (!arc->shader) os_fatal(str8("failed to compile accumulation shader\n"));
+	}
+
+	if (VOLUME_LAYER_CACHE && !RENDER_ACCUMULATION_SAMPLES && !ctx->headless) {
+		RenderContext *crc = &ctx->composite_render_context;
+		glCreateVertexArrays(1, &crc->vao);
+		crc->shader = load_shader(&ctx->os, ctx->arena, str8(""
+			"#version 460 core\n"
+			"\n"
+			"void main()\n"
+			"{\n"
+			"\tvec2 pos  = vec2((gl_VertexID & 1) * 4 - 1, (gl_VertexID & 2) * 2 - 1);\n"
+			"\tgl_Position = vec4(pos, 0, 1);\n"
+			"}\n"), str8(""
+			"#version 460 core\n"
+			"\n"
+			"layout(location = 0) out vec4 out_colour;\n"
+			"\n"
+			"layout(location = " str(COMPOSITE_LAYER_MASK_LOC) ") uniform uint u_layer_mask;\n"
+			"layout(location = " str(COMPOSITE_BACKGROUND_LOC) ") uniform vec4 u_background;\n"
+			"\n"
+			"layout(binding = 0) uniform sampler2DMSArray u_colour;\n"
+			"layout(binding = 1) uniform sampler2DMSArray u_depth;\n"
+			"\n"
+			"/* NOTE: layers are premultiplied and blended back to front; each pass blends the\n"
+			" * farthest layer in front of the last one blended (ties go by layer index) */\n"
+			"void main()\n"
+			"{\n"
+			"\tivec2 p          = ivec2(gl_FragCoord.xy);\n"
+			"\tint   layers     = textureSize(u_depth).z;\n"
+			"\tvec3  colour     = u_background.rgb;\n"
+			"\tfloat last_depth = 2;\n"
+			"\tint   last_layer = layers;\n"
+			"\tfor (;;) {\n"
+			"\t\tint   layer = -1;\n"
+			"\t\tfloat depth = -1;\n"
+			"\t\tfor (int i = 0; i < layers; i++) {\n"
+			"\t\t\tif ((u_layer_mask & (1u << i)) == 0) continue;\n"
+			"\t\t\tfloat d = texelFetch(u_depth, ivec3(p, i), gl_SampleID).x;\n"
+			"\t\t\tbool  in_front = d < last_depth || (d == last_depth && i < last_layer);\n"
+			"\t\t\tif (d < 1 && in_front && d >= depth) {\n"
+			"\t\t\t\tlayer = i;\n"
+			"\t\t\t\tdepth = d;\n"
+			"\t\t\t}\n"
+			"\t\t}\n"
+			"\t\tif (layer < 0) break;\n"
+			"\n"
+			"\t\tvec4 smp = texelFetch(u_colour, ivec3(p, layer), gl_SampleID);\n"
+			"\t\tcolour     = smp.rgb + (1 - smp.a) * colour;\n"
+			"\t\tlast_depth = depth;\n"
+			"\t\tlast_layer = layer;\n"
+			"\t}\n"
+			"\tout_colour = vec4(colour, 1);\n"
+			"}\n"), str8("composite"), str8("Composite"));
+		if (!crc->shader) os_fatal(str8("failed to compile composite shader\n"));
+	}
+
+	/* NOTE(rnp): interactive contexts start at the window size; see viewer_frame_step() */
+	sv2 render_size = {{RENDER_TARGET_SIZE}};
+	if (!ctx->headless) {
+		glfwGetFramebufferSize(ctx->window, &ctx->window_size.w, &ctx->window_size.h);
+		render_size = view_render_size(ctx);
+	}
+	init_render_targets(ctx, render_size);
+	ctx->interactive_scale = 1;
+	ctx->displayed_scale   = 1;
+	glCreateQueries(GL_TIME_ELAPSED, INTERACTIVE_TIMER_FRAMES, ctx->interactive_timer.queries);
+
+	/* NOTE(rnp): the render mode and whether bounding boxes are drawn are compiled into a
+	 * program per mode instead of being branched on per fragment */
+	ShaderReloadContext *model_rc = push_struct(&ctx->arena, ShaderReloadContext);
+	model_rc->programs        = ctx->model_programs;
+	model_rc->reload_count    = &ctx->model_program_reloads;
+	model_rc->variant_names   = render_mode_names;
+	model_rc->variant_count   = RenderMode_Count;
+	model_rc->variant_defines = push_array(&ctx->arena, str8, RenderMode_Count);
+	for (u32 mode = 0; mode < RenderMode_Count; mode++) {
+		Stream s = arena_stream(ctx->arena);
+		stream_append_str8(&s, str8("#define RENDER_MODE "));
+		stream_append_u64(&s, mode);
+		stream_append_str8(&s, str8("\n#define DRAW_BOUNDING_BOX "));
+		stream_append_u64(&s, BOUNDING_BOX_FRACTION > 0);
+		stream_append_byte(&s, '\n');
+		model_rc->variant_defines[mode] = arena_stream_commit_zero(&ctx->arena, &s);
+	}
+	model_rc->vertex_text = str8(""
+	"#version 460 core\n"
+	"\n"
+	"layout(location = 0) in vec3 v_position;\n"
+	"layout(location = 1) in vec3 v_normal;\n"
+	"layout(location = 2) in uint v_volume;\n"
+	"\n"
+	"layout(location = 0) out vec3 f_normal;\n"
+	"layout(location = 1) out vec3 f_texture_coordinate;\n"
+	"layout(location = 2) out vec3 f_orig_texture_coordinate;\n"
+	"layout(location = 3) out vec3 f_object_position;\n"
+	"layout(location = 4) flat out vec3 f_ray_origin;\n"
+	"layout(location = 5) flat out vec4  f_volume_parameters;\n"
+	"layout(location = 6) flat out uvec3 f_volume_indices;\n"
+	"\n"
+	VOLUME_PARAMETERS_GLSL
+	"layout(location = " str(MODEL_RENDER_VIEW_MATRIX_LOC)   ") uniform mat4  u_view;\n"
+	"layout(location = " str(MODEL_RENDER_PROJ_MATRIX_LOC)   ") uniform mat4  u_projection;\n"
+	"layout(location = " str(MODEL_RENDER_CLIP_GEOMETRY_LOC) ") uniform bool  u_clip_geometry = true;\n"
+	"layout(location = " str(MODEL_RENDER_ORDERED_DEPTH_LOC) ") uniform bool  u_ordered_depth = false;\n"
+	"\n"
+	"\n"
+	"void main()\n"
+	"{\n"
+	"\tVolume volume = volumes[v_volume];\n"
+	"\tf_volume_parameters = vec4(volume.clip_fraction, volume.threshold_scale, volume.step_size, volume.brick_cutoff);\n"
+	"\tf_volume_indices    = uvec3(volume.atlas_slot, volume.swizzle, v_volume);\n"
+	"\tvec3 pos = v_position;\n"
+	"\tf_orig_texture_coordinate = (v_position + 1) / 2;\n"
+	"\tif (u_clip_geometry && v_position.y == -1) pos.x = clamp(v_position.x, -volume.clip_fraction, volume.clip_fraction);\n"
+	"\tvec3 tex_coord = (pos + 1) / 2;\n"
+	"\tf_texture_coordinate = volume.swizzle? tex_coord.xzy : tex_coord;\n"
+	//"\tf_normal    = normalize(mat3(volume.model) * v_normal);\n"
+	"\tf_normal    = v_normal;\n"
+	"\tf_object_position = pos;\n"
+	"\tvec4 camera  = inverse(u_view * volume.model) * vec4(0, 0, 0, 1);\n"
+	"\tf_ray_origin = camera.xyz / camera.w;\n"
+	"\tgl_Position = u_projection * u_view * volume.model * vec4(pos, 1);\n"
+	"\tif (u_ordered_depth) {\n"
+	"\t\tvec4  centre = u_projection * u_view * volume.model * vec4(0, 0, 0, 1);\n"
+	"\t\tfloat depth  = clamp(centre.z / max(centre.w, 1e-6), -1 + 1.0 / 1024, 1 - 1.0 / 4096);\n"
+	"\t\tgl_Position.z = (depth - float(volume.draw_order) / 65536) * gl_Position.w;\n"
+	"\t}\n"
+	"}\n");
+
+	model_rc->fragment_header = str8(""
+	"#version 460 core\n\n"
+	"layout(location = 0) in  vec3 normal;\n"
+	"layout(location = 1) in  vec3 texture_coordinate;\n\n"
+	"layout(location = 2) in  vec3 test_texture_coordinate;\n\n"
+	"layout(location = 3) in  vec3 object_position;\n"
+	"layout(location = 4) flat in vec3 ray_origin;\n"
+	"layout(location = 5) flat in vec4  volume_parameters;\n"
+	"layout(location = 6) flat in uvec3 volume_indices;\n\n"
+	"layout(location = 0) out vec4 out_colour;\n\n"
+	"#define RENDER_MODE_SURFACE 0\n"
+	"#define RENDER_MODE_MIP     1\n"
+	"#define RENDER_MODE_EA      2\n"
+	"#define RENDER_MODE_ISOSURFACE 3\n\n"
+	"layout(location = " str(MODEL_RENDER_BB_COLOUR_LOC)     ") uniform vec4  u_bb_colour   = vec4(" str(BOUNDING_BOX_COLOUR) ");\n"
+	"layout(location = " str(MODEL_RENDER_BB_FRACTION_LOC)   ") uniform float u_bb_fraction = " str(BOUNDING_BOX_FRACTION) ";\n"
+	"layout(location = " str(MODEL_RENDER_MAX_SAMPLES_LOC)   ") uniform float u_max_samples = 256;\n"
+	"layout(location = " str(MODEL_RENDER_ABSORPTION_LOC)    ") uniform float u_absorption  = 8;\n"
+	"layout(location = " str(MODEL_RENDER_ATLAS_AXIS_LOC)    ") uniform uint  u_atlas_axis;\n"
+	"layout(location = " str(MODEL_RENDER_ATLAS_SLOTS_LOC)   ") uniform uint  u_atlas_slots = 1;\n"
+	"layout(location = " str(MODEL_RENDER_ISOSURFACE_COLOUR_LOC) ") uniform vec4 u_isosurface_colour = vec4(" str(ISOSURFACE_COLOUR) ");\n"
+	"\n"
+	"#define BRICK_SIZE " str(VOLUME_BRICK_SIZE) "\n"
+	TRANSFER_LUT_GLSL
+	"layout(binding = 0) uniform sampler3D      u_texture;\n"
+	"layout(binding = 1) uniform sampler3D      u_bricks;\n"
+	"layout(binding = 2) uniform sampler2DArray u_transfer;\n"
+	"\n#line 1\n");
+
+	str8 render_model = str8("render_model.frag.glsl");
+	reload_shader(&ctx->os, render_model, (sptr)model_rc, ctx->arena);
+	os_add_file_watch(&ctx->os, &ctx->arena, render_model, reload_shader, (sptr)model_rc);
+
+	RenderContext *rc = &ctx->overlay_render_context;
+	ShaderReloadContext *overlay_rc = push_struct(&ctx->arena, ShaderReloadContext);
+	overlay_rc->programs        = &rc->shader;
+	overlay_rc->variant_names   = push_struct(&ctx->arena, str8);
+	overlay_rc->variant_defines = push_struct(&ctx->arena, str8);
+	overlay_rc->variant_count   = 1;
+	overlay_rc->vertex_text = str8(""
+	"#version 460 core\n"
+	"\n"
+	"layout(location = 0) in vec2 v_position;\n"
+	"layout(location = 1) in vec2 v_texture_coordinate;\n"
+	"layout(location = 2) in vec3 v_colour;\n"
+	"layout(location = 3) in uint v_flags;\n"
+	"\n"
+	"layout(location = 0) out vec2 f_texture_coordinate;\n"
+	"layout(location = 1) out vec3 f_colour;\n"
+	"layout(location = 2) out uint f_flags;\n"
+	"\n"
+	"layout(location = 0) uniform ivec2 u_screen_size;\n"
+	"\n"
+	"void main()\n"
+	"{\n"
+	"\tf_texture_coordinate = v_texture_coordinate;\n"
+	"\tf_colour             = v_colour;\n"
+	"\tf_flags              = v_flags;\n"
+	"\tgl_Position = vec4(v_position, 0, 1);\n"
+	//"\tgl_Position = vec4(2 * (v_position / vec2(u_screen_size)) - 1, 0, 1);\n"
+	"}\n");
+
+	overlay_rc->fragment_header = str8(""
+	"#version 460 core\n\n"
+	"layout(location = 0) in  vec2 texture_coordinate;\n"
+	"layout(location = 1) in  vec3 colour;\n"
+	"layout(location = 0) out vec4 out_colour;\n"
+	"\n#line 1\n");
+
+	f32 overlay_vertices[] = {
+		-1,  1, 0, 0,
+		-1, -1, 0, 1,
+		 1, -1, 1, 1,
+		-1,  1, 0, 0,
+		 1, -1, 1, 1,
+		 1,  1, 1, 0,
+	};
+	glCreateVertexArrays(1, &rc->vao);
+	glCreateBuffers(1, &rc->vbo);
+
+	glNamedBufferData(rc->vbo, sizeof(overlay_vertices), overlay_vertices, GL_STATIC_DRAW);
+
+	glEnableVertexArrayAttrib(rc->vao, 0);
+	glEnableVertexArrayAttrib(rc->vao, 1);
+	glVertexArrayVertexBuffer(rc->vao, 0, rc->vbo, 0,               4 * sizeof(f32));
+	glVertexArrayVertexBuffer(rc->vao, 1, rc->vbo, 2 * sizeof(f32), 4 * sizeof(f32));
+	glVertexArrayAttribFormat(rc->vao, 0, 2, GL_FLOAT, 0, 0);
+	glVertexArrayAttribFormat(rc->vao, 1, 2, GL_FLOAT, 0, 2 * sizeof(f32));
+	glVertexArrayAttribBinding(rc->vao, 0, 0);
+	glVertexArrayAttribBinding(rc->vao, 1, 0);
+
+	str8 render_overlay = str8("render_overlay.frag.glsl");
+	reload_shader(&ctx->os, render_overlay, (sptr)overlay_rc, ctx->arena);
+	os_add_file_watch(&ctx->os, &ctx->arena, render_overlay, reload_shader, (sptr)overlay_rc);
+
+	f32 unit_cube_vertices[] = {
+		 1.0f,  1.0f, -1.0f,
+		 1.0f,  1.0f, -1.0f,
+		 1.0f,  1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,
+		 1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,
+		 1.0f, -1.0f,  1.0f,
+		 1.0f, -1.0f,  1.0f,
+		 1.0f, -1.0f,  1.0f,
+		-1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,
+		-1.0f, -1.0f, -1.0f,
+		-1.0f, -1.0f, -1.0f,
+		-1.0f, -1.0f, -1.0f,
+		-1.0f,  1.0f,  1.0f,
+		-1.0f,  1.0f,  1.0f,
+		-1.0f,  1.0f,  1.0f,
+		-1.0f, -1.0f,  1.0f,
+		-1.0f, -1.0f,  1.0f,
+		-1.0f, -1.0f,  1.0f
+	};
+	f32 unit_cube_normals[] = {
+		 0.0f,  0.0f, -1.0f,
+		 0.0f,  1.0f,  0.0f,
+		 1.0f,  0.0f,  0.0f,
+		 0.0f,  0.0f, -1.0f,
+		 0.0f, -1.0f,  0.0f,
+		 1.0f,  0.0f,  0.0f,
+		 0.0f,  0.0f,  1.0f,
+		 0.0f,  1.0f,  0.0f,
+		 1.0f,  0.0f,  0.0f,
+		 0.0f,  0.0f,  1.0f,
+		 0.0f, -1.0f,  0.0f,
+		 1.0f,  0.0f,  0.0f,
+		 0.0f,  0.0f, -1.0f,
+		 0.0f,  1.0f,  0.0f,
+		-1.0f,  0.0f,  0.0f,
+		 0.0f,  0.0f, -1.0f,
+		 0.0f, -1.0f,  0.0f,
+		-1.0f,  0.0f,  0.0f,
+		 0.0f,  0.0f,  1.0f,
+		 0.0f,  1.0f,  0.0f,
+		-1.0f,  0.0f,  0.0f,
+		 0.0f,  0.0f,  1.0f,
+		 0.0f, -1.0f,  0.0f,
+		-1.0f,  0.0f,  0.0f
+	};
+	u16 unit_cube_indices[] = {
+		1,  13, 19,
+		1,  19, 7,
+		9,  6,  18,
+		9,  18, 21,
+		23, 20, 14,
+		23, 14, 17,
+		16, 4,  10,
+		16, 10, 22,
+		5,  2,  8,
+		5,  8,  11,
+		15, 12, 0,
+		15, 0,  3
+	};
+
+	ctx->unit_cube = render_model_from_arrays(unit_cube_vertices, unit_cube_normals,
+	                                          countof(unit_cube_vertices) / 3, unit_cube_indices,
+	                                          countof(unit_cube_indices), sizeof(u16));
+
+	marching_cubes_init_tables();
+	init_volume_atlases(ctx);
+	if (!ctx->headless) {
+		init_slices(ctx);
+		init_projections(ctx);
+		init_gallery(ctx);
+	}
+}
+
+function m4
+camera_view(v3 position, v3 normal, v3 orthogonal)
+{
+	v3 right = cross(orthogonal, normal);
+	v3 up    = cross(normal,     right);
+
+	v3 translate;
+	position    = v3_sub((v3){0}, position);
+	translate.x = v3_dot(position, right);
+	translate.y = v3_dot(position, up);
+	translate.z = v3_dot(position, normal);
+
+	m4 transform;
+	transform.c[0] = (v4){{right.x,     up.x,        normal.x,    0}};
+	transform.c[1] = (v4){{right.y,     up.y,        normal.y,    0}};
+	transform.c[2] = (v4){{right.z,     up.z,        normal.z,    0}};
+	transform.c[3] = (v4){{translate.x, translate.y, translate.z, 1}};
+	return transform;
+}
+
+/* NOTE(rnp): magnitude (over the threshold) at lookup x coordinate x; 0 at x = 0 */
+function f32
+transfer_lut_magnitude(f32 x)
+{
+	f32 result = x > 0 ? pow_f32(10.0f, (x - 1) * TRANSFER_LUT_DECIBELS / 20.0f) : 0;
+	return result;
+}
+
+/* NOTE(rnp): lookup x coordinate of a magnitude (over the threshold); magnitudes more than
+ * TRANSFER_LUT_DECIBELS below the threshold map to 0 */
+function f32
+transfer_lut_coordinate(f32 magnitude)
+{
+	f32 result = 0;
+	if (magnitude > 0) result = CLAMP01(1 + 20 * log10_f32(magnitude) / TRANSFER_LUT_DECIBELS);
+	return result;
+}
+
+/* NOTE(rnp): display value of a sample with magnitude u times the threshold at depth
+ * coordinate t; this is what the transfer function texture holds */
+function f32
+transfer_display_value(ViewerContext *ctx, VolumeDisplayItem *v, f32 u, f32 t)
+{
+	f32 x      = CLAMP01((t + 0.4f) / 1.5f);
+	f32 result = pow_f32(u, DISPLAY_GAMMA) * x * x * (3 - 2 * x) * v->gain;
+	if (LOG_SCALE) {
+		result = 20 * log10_f32(result);
+		result = 1 - CLAMP(result, -ctx->dynamic_range, 0) / -ctx->dynamic_range;
+	}
+	return result;
+}
+
+/* NOTE(rnp): input: h [0,360] | s,v [0, 1] *
+ *            output: rgb [0,1]              */
+function v3
+hsv_to_rgb(v3 hsv)
+{
+	v3 result;
+	f32 n[3] = {5, 3, 1};
+	for (u32 i = 0; i < 3; i++) {
+		f32 k = fmod_f32(n[i] + hsv.x / 60, 6);
+		k = CLAMP01(MIN(k, 4 - k));
+		result.E[i] = hsv.z - hsv.z * hsv.y * k;
+	}
+	return result;
+}
+
+/* NOTE(rnp): colour the transfer function gives a display value */
+function v3
+transfer_colour(f32 value)
+{
+	v3 result = {{value, value, value}};
+	if (TRANSFER_COLOUR_MAP == TransferColourMap_HSV)
+		result = hsv_to_rgb((v3){{240 * (1 - CLAMP01(value)), 1, value}});
+	return result;
+}
+
+/* NOTE(rnp): bakes each volume's display transfer function (gamma, gain, log compression,
+ * dynamic range and colour map) into its layer of the lookup texture. the threshold only
+ * scales the lookup so layers are rebuilt only when one of the other parameters changes */
+function void
+update_transfer_function(ViewerContext *ctx, Arena scratch)
+{
+	f32 *texels = 0;
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + i;
+		f32 parameters[] = {v->gain, ctx->dynamic_range};
+		u64 hash = str8_hash((str8){.len = sizeof(parameters), .data = (u8 *)parameters});
+		if (hash == v->transfer_hash)
+			continue;
+		v->transfer_hash = hash;
+
+		if (!texels) texels = push_array(&scratch, f32, 4 * TRANSFER_LUT_WIDTH * TRANSFER_LUT_HEIGHT);
+		f32 *texel = texels;
+		for (u32 y = 0; y < TRANSFER_LUT_HEIGHT; y++) {
+			f32 t = (f32)y / (TRANSFER_LUT_HEIGHT - 1);
+			for (u32 x = 0; x < TRANSFER_LUT_WIDTH; x++) {
+				f32 u      = transfer_lut_magnitude((f32)x / (TRANSFER_LUT_WIDTH - 1));
+				f32 value  = transfer_display_value(ctx, v, u, t);
+				v3  colour = transfer_colour(value);
+				*texel++ = colour.x;
+				*texel++ = colour.y;
+				*texel++ = colour.z;
+				*texel++ = value;
+			}
+		}
+		glTextureSubImage3D(ctx->transfer_function, 0, 0, 0, v->instance, TRANSFER_LUT_WIDTH,
+		                    TRANSFER_LUT_HEIGHT, 1, GL_RGBA, GL_FLOAT, texels);
+	}
+}
+
+/* NOTE(rnp): largest sample magnitude which the transfer function maps to 0 for any depth
+ * weight. this is the last texel of the lookup which is 0 at full weight so that filtering
+ * can not pull in a non zero neighbour. it is pulled in slightly so that rounding
+ * differences with the shader can only ever cause extra samples */
+function f32
+volume_brick_cutoff(ViewerContext *ctx, VolumeDisplayItem *v)
+{
+	f32 result = 0;
+	if (LOG_SCALE && v->gain > 0) {
+		f32 limit = pow_f32(pow_f32(10.0f, -ctx->dynamic_range / 20.0f) / v->gain, 1 / DISPLAY_GAMMA);
+		s32 last  = transfer_lut_coordinate(MIN(limit, 1)) * (TRANSFER_LUT_WIDTH - 1);
+		for (; last > 0; last--) {
+			f32 u = transfer_lut_magnitude((f32)last / (TRANSFER_LUT_WIDTH - 1));
+			if (transfer_display_value(ctx, v, u, 1) <= 0) break;
+		}
+		result = 0.999f * pow_f32(10.0f, v->threshold / 20.0f) *
+		         transfer_lut_magnitude((f32)last / (TRANSFER_LUT_WIDTH - 1));
+	}
+	return result;
+}
+
+/* NOTE(rnp): object space bounds of brick b; axis maps object axes to texture axes */
+function void
+brick_object_bounds(uv3 b, uv3 dim, u32 *axis, v3 *lo, v3 *hi)
+{
+	for (u32 a = 0; a < 3; a++) {
+		u32 t = axis[a];
+		lo->E[a] = 2.0f * (b.E[t] * VOLUME_BRICK_SIZE) / dim.E[t] - 1;
+		hi->E[a] = 2.0f * MIN((b.E[t] + 1) * VOLUME_BRICK_SIZE, dim.E[t]) / dim.E[t] - 1;
+	}
+}
+
+/* NOTE(rnp): outer faces of the bricks which can contribute to the image and are not
+ * entirely outside of the clipping pyramid. bricks containing the bounding box frame are
+ * always included. faces are in object space, wound counter clockwise when viewed from
+ * outside and stored as unindexed triangles in vertices (when provided). returns the
+ * number of faces */
+function sz
+volume_proxy_faces(VolumeDisplayItem *v, Arena arena, f32 cutoff, f32 *vertices)
+{
+	BrickGrid *g = &v->bricks;
+	uv3 dim  = {{v->width, v->height, v->depth}};
+	/* NOTE(rnp): texture axis sampled along each object axis */
+	u32 axis[3] = {0, v->swizzle? 2 : 1, v->swizzle? 1 : 2};
+	f32 clip    = 1 - v->clip_fraction;
+
+	/* NOTE(rnp): number of bricks covered by the frame from each face */
+	uv3 frame;
+	for (u32 t = 0; t < 3; t++) {
+		f32 voxels = BOUNDING_BOX_FRACTION * dim.E[t];
+		frame.E[t] = BOUNDING_BOX_FRACTION > 0 ? (u32)voxels / VOLUME_BRICK_SIZE + 1 : 0;
+	}
+
+	sz  brick_count = (sz)g->size.x * g->size.y * g->size.z;
+	u8 *occupied    = push_array(&arena, u8, brick_count);
+
+	sz i = 0;
+	for (u32 z = 0; z < g->size.z; z++) {
+		for (u32 y = 0; y < g->size.y; y++) {
+			for (u32 x = 0; x < g->size.x; x++, i++) {
+				uv3 b = {{x, y, z}};
+				v3 lo, hi;
+				brick_object_bounds(b, dim, axis, &lo, &hi);
+				f32 near_x = (lo.x <= 0 && hi.x >= 0)? 0 : MIN(ABS(lo.x), ABS(hi.x));
+				b32 inside = near_x <= clip + (1 - clip) * (hi.y + 1) / 2;
+
+				u32 frame_axes = 0;
+				for (u32 t = 0; t < 3; t++)
+					frame_axes += b.E[t] < frame.E[t] || b.E[t] + frame.E[t] >= g->size.E[t];
+
+				occupied[i] = inside && (frame_axes >= 2 || g->ranges[i].y > cutoff);
+			}
+		}
+	}
+
+	sz face_count = 0;
+	i = 0;
+	for (u32 z = 0; z < g->size.z; z++) {
+		for (u32 y = 0; y < g->size.y; y++) {
+			for (u32 x = 0; x < g->size.x; x++, i++) {
+				if (!occupied[i]) continue;
+
+				uv3 b = {{x, y, z}};
+				v3 lo, hi;
+				brick_object_bounds(b, dim, axis, &lo, &hi);
+				for (u32 a = 0; a < 3; a++) {
+					u32 t = axis[a];
+					for (s32 sign = -1; sign <= 1; sign += 2) {
+						uv3 n = b;
+						n.E[t] += sign;
+						if (n.E[t] < g->size.E[t] &&
+						    occupied[((sz)n.z * g->size.y + n.y) * g->size.x + n.x])
+						{
+							continue;
+						}
+
+						if (vertices) {
+							u32 bi = (a + 1) % 3, ci = (a + 2) % 3;
+							f32 corners[4][2] = {
+								{lo.E[bi], lo.E[ci]}, {hi.E[bi], lo.E[ci]},
+								{hi.E[bi], hi.E[ci]}, {lo.E[bi], hi.E[ci]},
+							};
+							u32 order[2][6] = {{0, 3, 2, 0, 2, 1}, {0, 1, 2, 0, 2, 3}};
+							f32 *out = vertices + face_count * 6 * 3;
+							for (u32 k = 0; k < 6; k++, out += 3) {
+								out[a]  = sign > 0 ? hi.E[a] : lo.E[a];
+								out[bi] = corners[order[sign > 0][k]][0];
+								out[ci] = corners[order[sign > 0][k]][1];
+							}
+						}
+						face_count++;
+					}
+				}
+			}
+		}
+	}
+
+	return face_count;
+}
+
+function void
+volume_load(ViewerContext *ctx, VolumeDisplayItem *v)
+{
+	VolumeAtlas *atlas = ctx->volume_atlases + v->atlas;
+	uv3 size = {{v->width, v->height, v->depth}};
+
+	/* NOTE(rnp): the brick grid is kept for rebuilding the proxy mesh; the raw data
+	 * only needs to live until it is uploaded */
+	TRACE_BEGIN(volume_load);
+	BrickGrid *g = &v->bricks;
+	g->size   = brick_grid_size(size);
+	g->ranges = push_array(&ctx->arena, v2, (sz)g->size.x * g->size.y * g->size.z);
+
+	Arena scratch = ctx->arena;
+	str8 raw = os_read_whole_file(&scratch, v->file_path);
+
+	TRACE_BEGIN(volume_upload);
+	uv3 offset = {0};
+	offset.E[atlas->axis] = v->atlas_slot * size.E[atlas->axis];
+	sz data_size = (sz)size.x * size.y * size.z * 2 * sizeof(f32);
+	if (v->geometry == VolumeGeometry_Sector && v->clip_fraction > 0 && raw.len >= data_size) {
+		/* NOTE(rnp): the brick grid is built from the converted data so the GPU
+		 * result is read back in place of the raw samples */
+		SectorGeometry geometry = sector_geometry(v);
+		if (ctx->scan_convert_shader) {
+			scan_convert_gpu(ctx->scan_convert_shader, geometry, atlas->texture,
+			                 ctx->profile.volume_format, offset, raw, size, v->swizzle);
+			glGetTextureSubImage(atlas->texture, 0, offset.x, offset.y, offset.z, size.x, size.y,
+			                     size.z, GL_RG, GL_FLOAT, raw.len, raw.data);
+		} else {
+			f32 *converted = push_array(&scratch, f32, data_size / sizeof(f32));
+			scan_convert_cpu(ctx->work_queue, geometry, scratch, converted, (f32 *)raw.data,
+			                 size, v->swizzle);
+			raw = (str8){.data = (u8 *)converted, .len = data_size};
+			glTextureSubImage3D(atlas->texture, 0, offset.x, offset.y, offset.z,
+			                    size.x, size.y, size.z, GL_RG, GL_FLOAT, raw.data);
+		}
+	} else if (raw.len) {
+		glTextureSubImage3D(atlas->texture, 0, offset.x, offset.y, offset.z,
+		                    size.x, size.y, size.z, GL_RG, GL_FLOAT, raw.data);
+	}
+	TRACE_END(volume_upload);
+
+	brick_grid_from_data(ctx->work_queue, g, scratch, raw, size);
+	if (ctx->profile.volume_format == GL_RG16F && raw.len >= data_size) {
+		f32 peak = 0;
+		for (sz i = 0; i < (sz)g->size.x * g->size.y * g->size.z; i++)
+			peak = MAX(peak, g->ranges[i].y);
+		/* NOTE(rnp): larger half float values are stored as infinity */
+		if (peak > 65504.0f) {
+			Stream buf = arena_stream(scratch);
+			stream_append_str8s(&buf, c_str_to_str8(v->file_path),
+			                    str8(": samples exceed the half float range of the "
+			                         "software render profile\n"));
+			os_write_file(ctx->os.error_handle, stream_to_str8(&buf));
+		}
+	}
+	offset = (uv3){0};
+	offset.E[atlas->axis] = v->atlas_slot * g->size.E[atlas->axis];
+	glTextureSubImage3D(atlas->brick_texture, 0, offset.x, offset.y, offset.z,
+	                    g->size.x, g->size.y, g->size.z, GL_RG, GL_FLOAT, g->ranges);
+
+	/* NOTE(rnp): cutoffs are never negative; forces the proxy to be built */
+	g->proxy_cutoff = -1;
+	v->loaded       = 1;
+	TRACE_END(volume_load);
+}
+
+function DrawArraysIndirectCommand
+volume_proxy_command(VolumeDisplayItem *v)
+{
+	DrawArraysIndirectCommand result = {
+		.count          = v->bricks.proxy_count,
+		.instance_count = 1,
+		.first          = v->bricks.proxy_first,
+		.base_instance  = v->instance,
+	};
+	return result;
+}
+
+/* NOTE(rnp): rebuilds the shared proxy buffer and the draw commands when the proxy of
+ * any loaded volume is out of date */
+function void
+update_volume_proxies(ViewerContext *ctx)
+{
+	b32 dirty = 0;
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + i;
+		BrickGrid         *g = &v->bricks;
+		dirty |= v->loaded && (g->proxy_cutoff != volume_brick_cutoff(ctx, v) ||
+		                       g->proxy_clip_fraction != v->clip_fraction);
+	}
+	if (!dirty) return;
+
+	Arena scratch = ctx->arena;
+	sz face_count = 0;
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + i;
+		if (v->loaded) face_count += volume_proxy_faces(v, scratch, volume_brick_cutoff(ctx, v), 0);
+	}
+
+	f32 *vertices = push_array(&scratch, f32, face_count * 6 * 3);
+	DrawArraysIndirectCommand *commands = push_array(&scratch, DrawArraysIndirectCommand,
+	                                                 countof(volumes));
+	u32 vertex_count = 0;
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + i;
+		BrickGrid         *g = &v->bricks;
+		g->proxy_first = vertex_count;
+		g->proxy_count = 0;
+		if (v->loaded) {
+			f32 cutoff = volume_brick_cutoff(ctx, v);
+			g->proxy_count         = 6 * volume_proxy_faces(v, scratch, cutoff, vertices + 3 * vertex_count);
+			g->proxy_cutoff        = cutoff;
+			g->proxy_clip_fraction = v->clip_fraction;
+		}
+		vertex_count += g->proxy_count;
+
+		commands[v->instance] = volume_proxy_command(v);
+	}
+
+	ctx->volume_proxies.elements = vertex_count;
+	glNamedBufferData(ctx->volume_proxies.buffer, MAX(vertex_count, 1) * 3 * sizeof(f32),
+	                  vertices, GL_STATIC_DRAW);
+	glNamedBufferSubData(ctx->volume_commands, 0, countof(volumes) * sizeof(*commands), commands);
+}
+
+/* NOTE(rnp): maximum intensity projections along the lateral, depth and elevation axes
+ * of a volume. the image axes of each projection are in projection_image_axes (all
+ * lateral, depth, elevation indices); depth is kept vertical wherever it is present */
+read_only global u32 projection_image_axes[3][2] = {{2, 1}, {0, 2}, {0, 1}};
+read_only global str8 projection_names[3] = {str8("lateral"), str8("depth"), str8("elevation")};
+
+typedef struct {
+	u32 projected;  /* texture axis which is reduced */
+	u32 image_x;    /* texture axis along the image's rows */
+	u32 image_y;
+	u32 depth;      /* texture axis of depth; the transfer function depends on it */
+} ProjectionAxes;
+
+function ProjectionAxes
+projection_axes(VolumeDisplayItem *v, u32 projection)
+{
+	u32 axis[3] = {0, v->swizzle? 2 : 1, v->swizzle? 1 : 2};
+	ProjectionAxes result = {
+		.projected = axis[projection],
+		.image_x   = axis[projection_image_axes[projection][0]],
+		.image_y   = axis[projection_image_axes[projection][1]],
+		.depth     = axis[1],
+	};
+	return result;
+}
+
+/* NOTE(rnp): size in mm of a projection's image */
+function v2
+projection_size_mm(VolumeDisplayItem *v, u32 projection)
+{
+	v3  extent = v3_sub(v->max_coord_mm, v->min_coord_mm);
+	f32 mm[3]  = {extent.x, extent.z, extent.y};
+	v2 result  = {{mm[projection_image_axes[projection][0]], mm[projection_image_axes[projection][1]]}};
+	return result;
+}
+
+/* NOTE(rnp): CPU copy of the alpha of a volume's transfer function lookup; sampled like
+ * the texture (bilinear between texel centres) */
+typedef struct {
+	f32 *values;
+	f32  threshold_scale;
+} TransferTable;
+
+function TransferTable
+transfer_table(ViewerContext *ctx, VolumeDisplayItem *v, Arena *arena)
+{
+	TransferTable result = {.threshold_scale = pow_f32(10.0f, -v->threshold / 20.0f)};
+	result.values = push_array(arena, f32, TRANSFER_LUT_WIDTH * TRANSFER_LUT_HEIGHT);
+	for (u32 y = 0; y < TRANSFER_LUT_HEIGHT; y++) {
+		f32 t = (f32)y / (TRANSFER_LUT_HEIGHT - 1);
+		for (u32 x = 0; x < TRANSFER_LUT_WIDTH; x++) {
+			f32 u = transfer_lut_magnitude((f32)x / (TRANSFER_LUT_WIDTH - 1));
+			result.values[y * TRANSFER_LUT_WIDTH + x] = transfer_display_value(ctx, v, u, t);
+		}
+	}
+	return result;
+}
+
+function f32
+transfer_table_lookup(TransferTable *table, f32 magnitude, f32 t)
+{
+	f32 fx = transfer_lut_coordinate(magnitude * table->threshold_scale) * (TRANSFER_LUT_WIDTH - 1);
+	f32 fy = CLAMP01(t) * (TRANSFER_LUT_HEIGHT - 1);
+	u32 x0 = fx, y0 = fy;
+	u32 x1 = MIN(x0 + 1, TRANSFER_LUT_WIDTH  - 1);
+	u32 y1 = MIN(y0 + 1, TRANSFER_LUT_HEIGHT - 1);
+	f32 wx = fx - x0, wy = fy - y0;
+	f32 *r0 = table->values + y0 * TRANSFER_LUT_WIDTH;
+	f32 *r1 = table->values + y1 * TRANSFER_LUT_WIDTH;
+	f32 a   = r0[x0] + wx * (r0[x1] - r0[x0]);
+	f32 b   = r1[x0] + wx * (r1[x1] - r1[x0]);
+	f32 result = a + wy * (b - a);
+	return result;
+}
+
+#define PROJECTION_ROWS  4
+#define PROJECTION_LANES 8
+typedef struct {
+	ProjectionAxes axes;
+	TransferTable *table;
+	f32 *data;
+	f32 *output;
+	uv3  dim;
+	u32  first_row;
+	u32 *remaining;
+} ProjectionJob;
+
+/* NOTE(rnp): each job owns a band along the outer texture axis which is not projected so
+ * that no two jobs write the same pixel. the display value only increases with magnitude
+ * so when depth is constant along the projected axis the squared magnitudes are reduced
+ * first (lane wise, so that it vectorizes) and only the maximum is looked up */
+function WORK_QUEUE_FN(projection_job)
+{
+	ProjectionJob *job = (ProjectionJob *)user_data;
+	ProjectionAxes a   = job->axes;
+	uv3 dim = job->dim;
+
+	u32 stride[3] = {0};
+	stride[a.image_x] = 1;
+	stride[a.image_y] = dim.E[a.image_x];
+
+	u32 outer     = a.projected == 2 ? 1 : 2;
+	u32 middle    = 3 - outer;
+	u32 last_row  = MIN(job->first_row + PROJECTION_ROWS, dim.E[outer]);
+	b32 per_depth = a.projected == a.depth;
+
+	for (u32 o = job->first_row; o < last_row; o++) {
+		if (a.projected != 0) {
+			f32 *out = job->output + (sz)o * stride[outer];
+			for (u32 x = 0; x < dim.x; x++) out[x] = 0;
+		}
+
+		for (u32 m = 0; m < dim.E[middle]; m++) {
+			u32 y = outer == 1 ? o : m;
+			u32 z = outer == 1 ? m : o;
+			f32 *row = job->data + 2 * (((sz)z * dim.y + y) * dim.x);
+			f32  t   = ((a.depth == 1 ? y : z) + 0.5f) / dim.E[a.depth];
+
+			if (a.projected == 0) {
+				f32 lanes[PROJECTION_LANES] = {0};
+				u32 x = 0;
+				for (; x + PROJECTION_LANES <= dim.x; x += PROJECTION_LANES) {
+					for (u32 i = 0; i < PROJECTION_LANES; i++) {
+						f32 *p = row + 2 * (x + i);
+						lanes[i] = MAX(lanes[i], p[0] * p[0] + p[1] * p[1]);
+					}
+				}
+				for (; x < dim.x; x++)
+					lanes[0] = MAX(lanes[0], row[2 * x] * row[2 * x] + row[2 * x + 1] * row[2 * x + 1]);
+				for (u32 i = 1; i < PROJECTION_LANES; i++)
+					lanes[0] = MAX(lanes[0], lanes[i]);
+				job->output[y * stride[1] + z * stride[2]] = transfer_table_lookup(job->table, sqrt_f32(lanes[0]), t);
+			} else {
+				f32 *out = job->output + (sz)o * stride[outer];
+				if (per_depth) {
+					for (u32 x = 0; x < dim.x; x++) {
+						f32 m2 = row[2 * x] * row[2 * x] + row[2 * x + 1] * row[2 * x + 1];
+						out[x] = MAX(out[x], transfer_table_lookup(job->table, sqrt_f32(m2), t));
+					}
+				} else {
+					for (u32 x = 0; x < dim.x; x++)
+						out[x] = MAX(out[x], row[2 * x] * row[2 * x] + row[2 * x + 1] * row[2 * x + 1]);
+				}
+			}
+		}
+
+		if (a.projected != 0 && !per_depth) {
+			/* NOTE(rnp): depth is the outer axis here */
+			f32 *out = job->output + (sz)o * stride[outer];
+			f32  t   = (o + 0.5f) / dim.E[a.depth];
+			for (u32 x = 0; x < dim.x; x++)
+				out[x] = transfer_table_lookup(job->table, sqrt_f32(out[x]), t);
+		}
+	}
+
+	if (atomic_add_u32(job->remaining, -1) == 1)
+		os_wake_waiters(job->remaining);
+}
+
+/* NOTE(rnp): multithreaded CPU path; fills outputs[i] (sized like projection i's image)
+ * with display values */
+function void
+volume_projections_cpu(ViewerContext *ctx, VolumeDisplayItem *v, Arena scratch, f32 *data,
+                       f32 *outputs[3])
+{
+	uv3 dim = {{v->width, v->height, v->depth}};
+	TransferTable table = transfer_table(ctx, v, &scratch);
+
+	u32 job_count = 0;
+	for (u32 p = 0; p < 3; p++) {
+		u32 outer = projection_axes(v, p).projected == 2 ? 1 : 2;
+		job_count += (dim.E[outer] + PROJECTION_ROWS - 1) / PROJECTION_ROWS;
+	}
+
+	u32 remaining = job_count;
+	ProjectionJob *jobs = push_array(&scratch, ProjectionJob, job_count);
+	for (u32 p = 0, i = 0; p < 3; p++) {
+		ProjectionAxes axes = projection_axes(v, p);
+		u32 outer = axes.projected == 2 ? 1 : 2;
+		for (u32 row = 0; row < dim.E[outer]; row += PROJECTION_ROWS, i++) {
+			jobs[i] = (ProjectionJob){
+				.axes      = axes,
+				.table     = &table,
+				.data      = data,
+				.output    = outputs[p],
+				.dim       = dim,
+				.first_row = row,
+				.remaining = &remaining,
+			};
+			work_queue_push(ctx->work_queue, projection_job, (sptr)(jobs + i));
+		}
+	}
+
+	for (u32 left; (left = atomic_load_u32(&remaining));) {
+		if (!work_queue_do_next(ctx->work_queue))
+			os_wait_on_value(&remaining, left, U32_MAX);
+	}
+}
+
+/* NOTE(rnp): projections are only computed again when the volume's display changes */
+function void
+update_projections(ViewerContext *ctx, VolumeDisplayItem *v)
+{
+	update_transfer_function(ctx, ctx->arena);
+	if (!v->loaded) volume_load(ctx, v);
+
+	struct {u64 transfer_hash; f32 threshold; u32 instance;} parameters = {
+		v->transfer_hash, v->threshold, v->instance,
+	};
+	u64 hash = str8_hash((str8){.len = sizeof(parameters), .data = (u8 *)&parameters});
+	if (hash == v->projection_hash && v->projections[0])
+		return;
+	v->projection_hash = hash;
+
+	VolumeAtlas *atlas = ctx->volume_atlases + v->atlas;
+	s32 volume_size[3]   = {atlas->size.x, atlas->size.y, atlas->size.z};
+	s32 volume_offset[3] = {0};
+	volume_offset[atlas->axis] = v->atlas_slot * volume_size[atlas->axis];
+
+	u32 program = ctx->projection_shader;
+	glProgramUniform3iv(program, PROJECTION_VOLUME_OFFSET_LOC,   1, volume_offset);
+	glProgramUniform3iv(program, PROJECTION_VOLUME_SIZE_LOC,     1, volume_size);
+	glProgramUniform1f(program,  PROJECTION_THRESHOLD_SCALE_LOC, pow_f32(10.0f, -v->threshold / 20.0f));
+	glProgramUniform1ui(program, PROJECTION_TRANSFER_LAYER_LOC,  v->instance);
+	glProgramUniform4fv(program, PROJECTION_BACKGROUND_LOC,      1, OUTPUT_BG_CLEAR_COLOUR.E);
+
+	glUseProgram(program);
+	glBindTextureUnit(0, atlas->texture);
+	glBindTextureUnit(2, ctx->transfer_function);
+	for (u32 p = 0; p < 3; p++) {
+		ProjectionAxes axes = projection_axes(v, p);
+		u32 w = atlas->size.E[axes.image_x];
+		u32 h = atlas->size.E[axes.image_y];
+		if (!v->projections[p]) {
+			glCreateTextures(GL_TEXTURE_2D, 1, v->projections + p);
+			glTextureStorage2D(v->projections[p], 1, GL_RGBA8, w, h);
+			glTextureParameteri(v->projections[p], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(v->projections[p], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			LABEL_GL_OBJECT(GL_TEXTURE, v->projections[p], str8("Projection"));
+		}
+
+		s32 image_axes[3] = {axes.image_x, axes.image_y, axes.projected};
+		glProgramUniform3iv(program, PROJECTION_AXES_LOC,       1, image_axes);
+		glProgramUniform1i(program,  PROJECTION_DEPTH_AXIS_LOC, axes.depth);
+		glBindImageTexture(0, v->projections[p], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+		glDispatchCompute((w + SLICE_GROUP_SIZE - 1) / SLICE_GROUP_SIZE,
+		                  (h + SLICE_GROUP_SIZE - 1) / SLICE_GROUP_SIZE, 1);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+/* NOTE(rnp): copy of a volume's samples read back from its atlas slot */
+function f32 *
+volume_read_back(ViewerContext *ctx, VolumeDisplayItem *v, Arena *arena)
+{
+	VolumeAtlas *atlas = ctx->volume_atlases + v->atlas;
+	uv3 offset = {0};
+	offset.E[atlas->axis] = v->atlas_slot * atlas->size.E[atlas->axis];
+	sz   size   = (sz)v->width * v->height * v->depth * 2 * sizeof(f32);
+	f32 *result = push_array(arena, f32, size / sizeof(f32));
+	glGetTextureSubImage(atlas->texture, 0, offset.x, offset.y, offset.z, v->width, v->height,
+	                     v->depth, GL_RG, GL_FLOAT, size, result);
+	return result;
+}
+
+/* NOTE(rnp): headless (--projections); the volume is read back from its atlas slot and
+ * projected on the CPU. images are written top row first as QOI */
+function b32
+export_projections(ViewerContext *ctx)
+{
+	b32 result = 1;
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + i;
+		if (!v->loaded) volume_load(ctx, v);
+
+		Arena scratch = ctx->arena;
+		VolumeAtlas *atlas = ctx->volume_atlases + v->atlas;
+		f32 *data = volume_read_back(ctx, v, &scratch);
+
+		f32 *outputs[3];
+		for (u32 p = 0; p < 3; p++) {
+			ProjectionAxes axes = projection_axes(v, p);
+			outputs[p] = push_array(&scratch, f32, (sz)atlas->size.E[axes.image_x] * atlas->size.E[axes.image_y]);
+		}
+		volume_projections_cpu(ctx, v, scratch, data, outputs);
+
+		for (u32 p = 0; p < 3; p++) {
+			ProjectionAxes axes = projection_axes(v, p);
+			u32 w = atlas->size.E[axes.image_x];
+			u32 h = atlas->size.E[axes.image_y];
+
+			u32 *pixels = push_array(&scratch, u32, (sz)w * h);
+			for (sz j = 0; j < (sz)w * h; j++) {
+				v3 colour = outputs[p][j] > 0 ? transfer_colour(outputs[p][j]) : OUTPUT_BG_CLEAR_COLOUR.xyz;
+				pixels[j] = (u32)(CLAMP01(colour.x) * 255 + 0.5f) << 24 |
+				            (u32)(CLAMP01(colour.y) * 255 + 0.5f) << 16 |
+				            (u32)(CLAMP01(colour.z) * 255 + 0.5f) <<  8 | 0xFF;
+			}
+
+			Stream path = stream_alloc(&scratch, KB(1));
+			stream_append_str8(&path, str8(PROJECTION_OUTPUT_PREFIX));
+			stream_append_u64(&path, i);
+			stream_append_str8s(&path, str8("_"), projection_names[p], str8(".qoi"));
+			stream_append_byte(&path, 0);
+
+			Stream image = stream_alloc(&scratch, ENCODED_FRAME_SIZE_BOUND(w, h));
+			QOIEncoder e;
+			qoi_encode_begin(&image, &e, w, h);
+			qoi_encode_pixels(&image, &e, pixels, (sz)w * h);
+			qoi_encode_end(&image, &e);
+			result &= !image.errors && !path.errors &&
+			          os_write_new_file((c8 *)path.data, stream_to_str8(&image));
+		}
+	}
+	return result;
+}
+
+#define ISOSURFACE_BRICK_SIZE 16
+/* NOTE(rnp): bricks are copied into a local block with a one voxel apron for gradients */
+#define ISOSURFACE_BLOCK_SIZE (ISOSURFACE_BRICK_SIZE + 3)
+
+function f32
+isosurface_level(VolumeDisplayItem *v)
+{
+	f32 result = pow_f32(10.0f, (v->threshold + ISOSURFACE_LEVEL) / 20.0f);
+	return result;
+}
+
+function b32
+isosurface_brick_has_surface(v2 range, f32 level)
+{
+	b32 result = range.x < level && level <= range.y;
+	return result;
+}
+
+typedef struct {
+	Isosurface *surface;
+	uv3  dim;
+	uv3  brick;
+	f32  level;
+	b32  swizzle;
+	b32  extract;   /* otherwise copied from the previous mesh */
+	b32  first;     /* brick ranges are not yet known */
+
+	IsosurfaceBrick previous;
+	f32 *previous_positions;
+	f32 *previous_normals;
+	u32 *previous_indices;
+
+	u32 *remaining;
+} IsosurfaceJob;
+
+/* NOTE(rnp): copies the brick's voxels (one past its last cell on each axis) and their
+ * neighbours, clamped to the volume, into block. returns the voxel count on each axis */
+function uv3
+isosurface_load_block(IsosurfaceJob *job, f32 *block, uv3 *first_voxel)
+{
+	uv3 dim = job->dim, first, count;
+	for (u32 i = 0; i < 3; i++) {
+		first.E[i] = job->brick.E[i] * ISOSURFACE_BRICK_SIZE;
+		count.E[i] = MIN(ISOSURFACE_BRICK_SIZE, dim.E[i] - 1 - first.E[i]) + 1;
+	}
+
+	f32 *magnitudes = job->surface->magnitudes;
+	for (u32 z = 0; z < count.z + 2; z++) {
+		s32 vz = CLAMP((s32)(first.z + z) - 1, 0, (s32)dim.z - 1);
+		for (u32 y = 0; y < count.y + 2; y++) {
+			s32  vy  = CLAMP((s32)(first.y + y) - 1, 0, (s32)dim.y - 1);
+			f32 *row = magnitudes + ((sz)vz * dim.y + vy) * dim.x;
+			f32 *out = block + (z * ISOSURFACE_BLOCK_SIZE + y) * ISOSURFACE_BLOCK_SIZE;
+			for (u32 x = 0; x < count.x + 2; x++)
+				out[x] = row[CLAMP((s32)(first.x + x) - 1, 0, (s32)dim.x - 1)];
+		}
+	}
+
+	*first_voxel = first;
+	return count;
+}
+
+function u32
+isosurface_cell_case(f32 *block, u32 x, u32 y, u32 z, f32 level)
+{
+	u32 result = 0;
+	for (u32 i = 0; i < 8; i++) {
+		u32 index = ((z + 1 + (i >> 2)) * ISOSURFACE_BLOCK_SIZE + y + 1 + ((i >> 1) & 1)) *
+		            ISOSURFACE_BLOCK_SIZE + x + 1 + (i & 1);
+		result |= (u32)(block[index] >= level) << i;
+	}
+	return result;
+}
+
+/* NOTE(rnp): sizes (and on the first extraction the range of) a brick's part of the mesh */
+function WORK_QUEUE_FN(isosurface_count_job)
+{
+	IsosurfaceJob *job = (IsosurfaceJob *)user_data;
+	Isosurface    *s   = job->surface;
+	sz brick_index = ((sz)job->brick.z * s->size.y + job->brick.y) * s->size.x + job->brick.x;
+
+	f32 block[ISOSURFACE_BLOCK_SIZE * ISOSURFACE_BLOCK_SIZE * ISOSURFACE_BLOCK_SIZE];
+	uv3 first;
+	uv3 count = isosurface_load_block(job, block, &first);
+
+	f32 level    = job->level;
+	u32 vertices = 0, indices = 0;
+	v2  range    = {{F32_INFINITY, 0}};
+	for (u32 z = 0; z < count.z; z++) {
+		for (u32 y = 0; y < count.y; y++) {
+			f32 *row = block + ((z + 1) * ISOSURFACE_BLOCK_SIZE + y + 1) * ISOSURFACE_BLOCK_SIZE + 1;
+			for (u32 x = 0; x < count.x; x++) {
+				b32 inside = row[x] >= level;
+				range.x = MIN(range.x, row[x]);
+				range.y = MAX(range.y, row[x]);
+				if (x + 1 < count.x) vertices += inside != (row[x + 1] >= level);
+				if (y + 1 < count.y) vertices += inside != (row[x + ISOSURFACE_BLOCK_SIZE] >= level);
+				if (z + 1 < count.z) vertices += inside != (row[x + ISOSURFACE_BLOCK_SIZE * ISOSURFACE_BLOCK_SIZE] >= level);
+			}
+		}
+	}
+
+	if (vertices) {
+		for (u32 z = 0; z + 1 < count.z; z++)
+			for (u32 y = 0; y + 1 < count.y; y++)
+				for (u32 x = 0; x + 1 < count.x; x++)
+					indices += marching_cubes_index_counts[isosurface_cell_case(block, x, y, z, level)];
+	}
+
+	if (job->first) s->ranges[brick_index] = range;
+	s->bricks[brick_index].vertex_count = vertices;
+	s->bricks[brick_index].index_count  = indices;
+
+	if (atomic_add_u32(job->remaining, -1) == 1)
+		os_wake_waiters(job->remaining);
+}
+
+/* NOTE(rnp): central difference gradient in voxels at a block voxel */
+function v3
+isosurface_gradient(f32 *block, u32 x, u32 y, u32 z)
+{
+	u32 plane = ISOSURFACE_BLOCK_SIZE * ISOSURFACE_BLOCK_SIZE;
+	f32 *p = block + (z + 1) * plane + (y + 1) * ISOSURFACE_BLOCK_SIZE + x + 1;
+	v3 result = {{0.5f * (p[1] - p[-1]),
+	              0.5f * (p[ISOSURFACE_BLOCK_SIZE] - p[-ISOSURFACE_BLOCK_SIZE]),
+	              0.5f * (p[plane] - p[-(s32)plane])}};
+	return result;
+}
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	ctx->window = glfwCreateWindow(ctx->window_size.w, ctx->window_size.h, "3D Viewer", 0, 0);
-	if (!ctx->window) os_fatal(str8("failed to open window\n"));
-	glfwMakeContextCurrent(ctx->window);
-	glfwSetWindowUserPointer(ctx->window, ctx);
-	glfwSwapInterval(1);
+/* NOTE(rnp): writes the brick's vertices, welded along each crossed edge, and triangles.
+ * positions are in the volume's object space; normals point out of the surface towards
+ * lower magnitudes */
+function WORK_QUEUE_FN(isosurface_emit_job)
+{
+	IsosurfaceJob *job = (IsosurfaceJob *)user_data;
+	Isosurface    *s   = job->surface;
+	sz brick_index = ((sz)job->brick.z * s->size.y + job->brick.y) * s->size.x + job->brick.x;
+	IsosurfaceBrick *b = s->bricks + brick_index;
+
+	if (!job->extract) {
+		IsosurfaceBrick *p = &job->previous;
+		mem_copy(s->positions + 3 * (sz)b->first_vertex, job->previous_positions + 3 * (sz)p->first_vertex,
+		         3 * sizeof(f32) * (sz)b->vertex_count);
+		mem_copy(s->normals + 3 * (sz)b->first_vertex, job->previous_normals + 3 * (sz)p->first_vertex,
+		         3 * sizeof(f32) * (sz)b->vertex_count);
+		u32 *in  = job->previous_indices + p->first_index;
+		u32 *out = s->indices + b->first_index;
+		for (u32 i = 0; i < b->index_count; i++)
+			out[i] = in[i] - p->first_vertex + b->first_vertex;
+	} else {
+		f32 block[ISOSURFACE_BLOCK_SIZE * ISOSURFACE_BLOCK_SIZE * ISOSURFACE_BLOCK_SIZE];
+		uv3 first;
+		uv3 count = isosurface_load_block(job, block, &first);
+
+		/* NOTE(rnp): object axis i is texture axis axis[i] */
+		uv3 dim     = job->dim;
+		u32 axis[3] = {0, job->swizzle ? 2 : 1, job->swizzle ? 1 : 2};
+
+		u32 edge_vertices[(ISOSURFACE_BRICK_SIZE + 1) * (ISOSURFACE_BRICK_SIZE + 1) * (ISOSURFACE_BRICK_SIZE + 1) * 3];
+		f32 level  = job->level;
+		u32 vertex = b->first_vertex;
+		for (u32 z = 0; z < count.z; z++) {
+			for (u32 y = 0; y < count.y; y++) {
+				for (u32 x = 0; x < count.x; x++) {
+					uv3 voxel = {{x, y, z}};
+					f32 *p    = block + ((z + 1) * ISOSURFACE_BLOCK_SIZE + y + 1) * ISOSURFACE_BLOCK_SIZE + x + 1;
+					u32 step[3] = {1, ISOSURFACE_BLOCK_SIZE, ISOSURFACE_BLOCK_SIZE * ISOSURFACE_BLOCK_SIZE};
+					for (u32 a = 0; a < 3; a++) {
+						if (voxel.E[a] + 1 >= count.E[a]) continue;
+						f32 m0 = p[0], m1 = p[step[a]];
+						if ((m0 >= level) == (m1 >= level)) continue;
+
+						f32 t = (level - m0) / (m1 - m0);
+						uv3 next = voxel;
+						next.E[a]++;
+						v3 g0 = isosurface_gradient(block, x, y, z);
+						v3 g1 = isosurface_gradient(block, next.x, next.y, next.z);
+
+						v3 position, normal;
+						for (u32 i = 0; i < 3; i++) {
+							u32 ta = axis[i];
+							f32 q  = first.E[ta] + voxel.E[ta] + (ta == a ? t : 0) + 0.5f;
+							position.E[i] = 2 * q / dim.E[ta] - 1;
+							normal.E[i]   = -(g0.E[ta] + t * (g1.E[ta] - g0.E[ta])) * dim.E[ta];
+						}
+						if (v3_dot(normal, normal) > 0) normal = v3_normalize(normal);
+
+						f32 *out_position = s->positions + 3 * (sz)vertex;
+						f32 *out_normal   = s->normals   + 3 * (sz)vertex;
+						for (u32 i = 0; i < 3; i++) {
+							out_position[i] = position.E[i];
+							out_normal[i]   = normal.E[i];
+						}
+
+						u32 local = (z * (ISOSURFACE_BRICK_SIZE + 1) + y) * (ISOSURFACE_BRICK_SIZE + 1) + x;
+						edge_vertices[local * 3 + a] = vertex++;
+					}
+				}
+			}
+		}
+
+		u32 *out = s->indices + b->first_index;
+		for (u32 z = 0; vertex != b->first_vertex && z + 1 < count.z; z++) {
+			for (u32 y = 0; y + 1 < count.y; y++) {
+				for (u32 x = 0; x + 1 < count.x; x++) {
+					u32 c = isosurface_cell_case(block, x, y, z, level);
+					for (u32 i = 0; i < marching_cubes_index_counts[c]; i++) {
+						u32 e  = marching_cubes_triangles[c][i], a = e / 4;
+						uv3 at = {{x, y, z}};
+						at.E[(a + 1) % 3] += e & 1;
+						at.E[(a + 2) % 3] += (e >> 1) & 1;
+						u32 local = (at.z * (ISOSURFACE_BRICK_SIZE + 1) + at.y) * (ISOSURFACE_BRICK_SIZE + 1) + at.x;
+						*out++ = edge_vertices[local * 3 + a];
+					}
+				}
+			}
+		}
+	}
+
+	if (atomic_add_u32(job->remaining, -1) == 1)
+		os_wake_waiters(job->remaining);
+}
+
+function void
+isosurface_run_jobs(WorkQueue *q, IsosurfaceJob *jobs, u32 count, work_queue_fn *fn)
+{
+	u32 remaining = count;
+	for (u32 i = 0; i < count; i++) {
+		jobs[i].remaining = &remaining;
+		work_queue_push(q, fn, (sptr)(jobs + i));
+	}
+
+	for (u32 left; (left = atomic_load_u32(&remaining));) {
+		if (!work_queue_do_next(q))
+			os_wait_on_value(&remaining, left, U32_MAX);
+	}
+}
+
+/* NOTE(rnp): the magnitudes are kept on the CPU from the first extraction on */
+function void
+isosurface_init(ViewerContext *ctx, VolumeDisplayItem *v)
+{
+	Isosurface *s = &v->isosurface;
+	if (!v->loaded) volume_load(ctx, v);
+
+	uv3 dim = {{v->width, v->height, v->depth}};
+	for (u32 i = 0; i < 3; i++)
+		s->size.E[i] = dim.E[i] > 1 ? (dim.E[i] - 1 + ISOSURFACE_BRICK_SIZE - 1) / ISOSURFACE_BRICK_SIZE : 0;
+
+	sz voxel_count = (sz)dim.x * dim.y * dim.z;
+	sz brick_count = (sz)s->size.x * s->size.y * s->size.z;
+	Arena memory = os_alloc_arena(voxel_count * sizeof(f32) + brick_count * (sizeof(v2) +
+	                              sizeof(IsosurfaceBrick)) + KB(4));
+	if (!memory.beg) os_fatal(str8("isosurface: failed to allocate memory\n"));
+
+	s->magnitudes = push_array(&memory, f32, voxel_count);
+	s->ranges     = push_array(&memory, v2, brick_count);
+	s->bricks     = push_array(&memory, IsosurfaceBrick, brick_count);
+
+	Arena scratch = ctx->arena;
+	f32 *samples  = volume_read_back(ctx, v, &scratch);
+	for (sz i = 0; i < voxel_count; i++)
+		s->magnitudes[i] = sqrt_f32(samples[2 * i] * samples[2 * i] + samples[2 * i + 1] * samples[2 * i + 1]);
+
+	s->level = -1;
+}
+
+/* NOTE(rnp): extracts the bricks whose surface may have changed since the mesh was last
+ * built and copies the rest. counting first puts every brick's part of the mesh in a
+ * fixed place so the result does not depend on the order jobs finish in */
+function void
+isosurface_update(ViewerContext *ctx, VolumeDisplayItem *v)
+{
+	Isosurface *s = &v->isosurface;
+	if (!s->magnitudes) isosurface_init(ctx, v);
+
+	f32 level = isosurface_level(v);
+	if (level == s->level) return;
+
+	Arena scratch = ctx->arena;
+	u32 brick_count = s->size.x * s->size.y * s->size.z;
+	IsosurfaceJob   *jobs     = push_array(&scratch, IsosurfaceJob, brick_count);
+	IsosurfaceBrick *previous = push_array(&scratch, IsosurfaceBrick, brick_count);
+	mem_copy(previous, s->bricks, brick_count * sizeof(*previous));
+
+	b32 first = s->level < 0;
+	u32 count = 0;
+	for (u32 i = 0; i < brick_count; i++) {
+		b32 extract = first || isosurface_brick_has_surface(s->ranges[i], s->level) ||
+		              isosurface_brick_has_surface(s->ranges[i], level);
+		if (!extract && !previous[i].index_count) continue;
+		jobs[count++] = (IsosurfaceJob){
+			.surface            = s,
+			.dim                = {{v->width, v->height, v->depth}},
+			.brick              = {{i % s->size.x, (i / s->size.x) % s->size.y, i / (s->size.x * s->size.y)}},
+			.level              = level,
+			.swizzle            = v->swizzle,
+			.extract            = extract,
+			.first              = first,
+			.previous           = previous[i],
+			.previous_positions = s->positions,
+			.previous_normals   = s->normals,
+			.previous_indices   = s->indices,
+		};
+	}
+
+	/* NOTE(rnp): jobs which extract are at most all of them; sort them first so that
+	 * the counting pass only sees those */
+	u32 extract_count = 0;
+	for (u32 i = 0; i < count; i++) {
+		if (jobs[i].extract) {
+			SWAP(jobs[i], jobs[extract_count]);
+			extract_count++;
+		}
+	}
+	isosurface_run_jobs(ctx->work_queue, jobs, extract_count, isosurface_count_job);
+
+	u64 vertex_count = 0, index_count = 0;
+	for (u32 i = 0; i < brick_count; i++) {
+		IsosurfaceBrick *b = s->bricks + i;
+		b->first_vertex = vertex_count;
+		b->first_index  = index_count;
+		vertex_count   += b->vertex_count;
+		index_count    += b->index_count;
+	}
+
+	Arena *mesh_memory = s->mesh_memory + !s->mesh_index;
+	sz needed = vertex_count * 6 * sizeof(f32) + index_count * sizeof(u32) + 3 * 16;
+	if (needed > ISOSURFACE_MESH_MEMORY) {
+		/* NOTE(rnp): an empty mesh is correct for every brick without a surface at this
+		 * level; the next update extracts all of the others */
+		os_write_file(ctx->os.error_handle, str8("isosurface: mesh does not fit in ISOSURFACE_MESH_MEMORY\n"));
+		mem_clear(s->bricks, 0, brick_count * sizeof(*s->bricks));
+		vertex_count = index_count = count = 0;
+	} else if (needed > mesh_memory->end - mesh_memory->beg) {
+		/* NOTE(rnp): grown with headroom so that small level steps reuse it */
+		os_release_arena(*mesh_memory);
+		*mesh_memory = os_alloc_arena(MIN(needed + needed / 2, ISOSURFACE_MESH_MEMORY));
+		if (!mesh_memory->beg) os_fatal(str8("isosurface: failed to allocate memory\n"));
+	}
+	Arena mesh = *mesh_memory;
+
+	s->positions = push_array(&mesh, f32, vertex_count * 3);
+	s->normals   = push_array(&mesh, f32, vertex_count * 3);
+	s->indices   = push_array(&mesh, u32, index_count);
+	isosurface_run_jobs(ctx->work_queue, jobs, count, isosurface_emit_job);
+
+	s->vertex_count = vertex_count;
+	s->index_count  = index_count;
+	s->mesh_index   = !s->mesh_index;
+	s->level        = level;
+
+	if (s->model.vao) {
+		glDeleteVertexArrays(1, &s->model.vao);
+		glDeleteBuffers(1, &s->model.buffer);
+	}
+	s->model = render_model_from_arrays(s->positions, s->normals, vertex_count, s->indices,
+	                                    index_count, sizeof(u32));
+	vertex_array_add_volume_instances(s->model.vao, ctx->volume_instances);
+}
+
+function VolumeParameters
+volume_parameters(ViewerContext *ctx, VolumeDisplayItem *v, f32 rotation, f32 translate_x)
+{
+	v3 scale = v3_sub(v->max_coord_mm, v->min_coord_mm);
+	m4 S;
+	S.c[0] = (v4){{scale.x, 0,       0,       0}};
+	S.c[1] = (v4){{0,       scale.z, 0,       0}};
+	S.c[2] = (v4){{0,       0,       scale.y, 0}};
+	S.c[3] = (v4){{0,       0,       0,       1}};
+
+	m4 T;
+	T.c[0] = (v4){{1, 0, 0, translate_x}};
+	T.c[1] = (v4){{0, 1, 0, 0}};
+	T.c[2] = (v4){{0, 0, 1, 0}};
+	T.c[3] = (v4){{0, 0, 0, 1}};
+
+	f32 sa = sin_f32(rotation);
+	f32 ca = cos_f32(rotation);
+	m4 R;
+	R.c[0] = (v4){{ ca, 0, sa, 0}};
+	R.c[1] = (v4){{ 0,  1, 0,  0}};
+	R.c[2] = (v4){{-sa, 0, ca, 0}};
+	R.c[3] = (v4){{ 0,  0, 0,  1}};
+
+	VolumeParameters result = {
+		.model         = m4_mul(m4_mul(R, S), T),
+		.clip_fraction   = 1 - v->clip_fraction,
+		.threshold_scale = pow_f32(10.0f, -v->threshold / 20.0f),
+		.step_size       = v->step_size? v->step_size : 1,
+		.brick_cutoff    = volume_brick_cutoff(ctx, v),
+		.swizzle         = v->swizzle,
+		.atlas_slot      = v->atlas_slot,
+	};
+	return result;
+}
+
+/* NOTE(rnp): one draw per atlas of instances of the unit cube. when only is set just that
+ * volume is drawn */
+function void
+draw_volume_atlases(ViewerContext *ctx, VolumeDisplayItem *only)
+{
+	u32 program = ctx->model_programs[ctx->render_mode];
+	for (u32 i = 0; i < ctx->volume_atlas_count; i++) {
+		VolumeAtlas *a = ctx->volume_atlases + i;
+		u32 first = a->first_instance;
+		u32 count = a->used;
+		if (only) {
+			if (only->atlas != i) continue;
+			first = only->instance;
+			count = 1;
+		}
+
+		glProgramUniform1ui(program, MODEL_RENDER_ATLAS_AXIS_LOC,  a->axis);
+		glProgramUniform1ui(program, MODEL_RENDER_ATLAS_SLOTS_LOC, a->slots);
+		glBindTextureUnit(0, a->texture);
+		glBindTextureUnit(1, a->brick_texture);
+		RenderModel *m = &ctx->unit_cube;
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m->elements, m->index_type,
+		                                    (void *)m->elements_offset, count, first);
+	}
+}
+
+/* NOTE(rnp): orders the volumes back to front along the view by their centres, stores each
+ * volume's place in its parameters and writes the proxy commands in that order after the
+ * per instance ones */
+function void
+sort_volume_draws(ViewerContext *ctx, m4 view)
+{
+	static_assert(countof(volumes) < 64, "the draw order must fit in the ordered depth range");
+	u32 *order = ctx->volume_draw_order;
+	f32  depth[countof(volumes)];
+	for (u32 i = 0; i < countof(volumes); i++) {
+		v3 c      = volumes[i].centre;
+		v4 centre = m4_mul_v4(view, (v4){{c.x, c.y, c.z, 1}});
+		u32 j = i;
+		for (; j > 0 && depth[j - 1] > centre.z; j--) {
+			depth[j] = depth[j - 1];
+			order[j] = order[j - 1];
+		}
+		depth[j] = centre.z;
+		order[j] = i;
+	}
+
+	DrawArraysIndirectCommand commands[countof(volumes)];
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + order[i];
+		commands[i] = volume_proxy_command(v);
+		glNamedBufferSubData(ctx->volume_parameters, v->instance * sizeof(VolumeParameters) +
+		                     offsetof(VolumeParameters, draw_order), sizeof(u32), &i);
+	}
+	glNamedBufferSubData(ctx->volume_commands, sizeof(commands), sizeof(commands), commands);
+}
+
+/* NOTE(rnp): proxies are drawn in the order of sort_volume_draws(); each run of volumes
+ * sharing an atlas is a single multi draw over its commands. when only is set just that
+ * volume is drawn */
+function void
+draw_volume_proxies(ViewerContext *ctx, VolumeDisplayItem *only)
+{
+	u32  program = ctx->model_programs[ctx->render_mode];
+	u32 *order   = ctx->volume_draw_order;
+	u32  count   = countof(volumes);
+	u32  only_index;
+	if (only) {
+		only_index = (u32)(only - volumes);
+		order      = &only_index;
+		count      = 1;
+	}
+
+	for (u32 first = 0, end; first < count; first = end) {
+		VolumeAtlas *a = ctx->volume_atlases + volumes[order[first]].atlas;
+		for (end = first + 1; end < count && volumes[order[end]].atlas == volumes[order[first]].atlas; end++);
+
+		glProgramUniform1ui(program, MODEL_RENDER_ATLAS_AXIS_LOC,  a->axis);
+		glProgramUniform1ui(program, MODEL_RENDER_ATLAS_SLOTS_LOC, a->slots);
+		glBindTextureUnit(0, a->texture);
+		glBindTextureUnit(1, a->brick_texture);
+		sz command = only ? only->instance : countof(volumes) + first;
+		glMultiDrawArraysIndirect(GL_TRIANGLES, (void *)(command * sizeof(DrawArraysIndirectCommand)),
+		                          end - first, 0);
+	}
+}
+
+/* NOTE(rnp): loads volumes on first use and updates everything the volume draws read; the
+ * parameter buffer, the transfer function and the proxies or isosurfaces. centred volumes
+ * are not moved apart for the multi volume display */
+function void
+update_volumes(ViewerContext *ctx, f32 cycle_t, b32 centred)
+{
+	f32 rotation = cycle_t * 2 * PI;
+
+	/* NOTE(rnp): not in the arena; loading a volume pushes its brick grid */
+	VolumeParameters parameters[countof(volumes)];
+	for (u32 i = 0; i < countof(volumes); i++) {
+		VolumeDisplayItem *v = volumes + i;
+		#if DRAW_ALL_VOLUMES
+		if (!v->loaded) volume_load(ctx, v);
+		parameters[v->instance] = volume_parameters(ctx, v, rotation, centred ? 0 : v->translate_x);
+		#else
+		if (i == single_volume_index && !v->loaded) volume_load(ctx, v);
+		parameters[v->instance] = volume_parameters(ctx, v, rotation, 0);
+		#endif
+		v->centre = m4_mul_v4(parameters[v->instance].model, (v4){{0, 0, 0, 1}}).xyz;
+	}
+	glNamedBufferSubData(ctx->volume_parameters, 0, sizeof(parameters), parameters);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ctx->volume_parameters);
+
+	update_transfer_function(ctx, ctx->arena);
+	glBindTextureUnit(2, ctx->transfer_function);
+
+	if (ctx->render_mode == RenderMode_Isosurface) {
+		for (u32 i = 0; i < countof(volumes); i++) {
+			#if !DRAW_ALL_VOLUMES
+			if (i != single_volume_index) continue;
+			#endif
+			isosurface_update(ctx, volumes + i);
+		}
+	} else if (ctx->render_mode != RenderMode_Surface) {
+		update_volume_proxies(ctx);
+	}
+}
+
+/* NOTE(rnp): draws every volume or, when only is set, just that one */
+function void
+draw_volumes(ViewerContext *ctx, VolumeDisplayItem *only)
+{
+	#if !DRAW_ALL_VOLUMES
+	if (!only) only = volumes + single_volume_index;
+	#endif
+
+	/* NOTE(rnp): scan converting a volume while loading it binds its own program */
+	u32 program = ctx->model_programs[ctx->render_mode];
+	glUseProgram(program);
+	if (ctx->render_mode == RenderMode_Surface) {
+		glProgramUniform1ui(program, MODEL_RENDER_CLIP_GEOMETRY_LOC, 1);
+		glBindVertexArray(ctx->unit_cube.vao);
+		draw_volume_atlases(ctx, only);
+	} else if (ctx->render_mode == RenderMode_Isosurface) {
+		glProgramUniform1ui(program, MODEL_RENDER_CLIP_GEOMETRY_LOC, 0);
+		for (u32 i = 0; i < countof(volumes); i++) {
+			VolumeDisplayItem *v = volumes + i;
+			if (only && v != only) continue;
+
+			RenderModel *m = &v->isosurface.model;
+			glBindVertexArray(m->vao);
+			glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m->elements, m->index_type,
+			                                    (void *)m->elements_offset, 1, v->instance);
+		}
+	} else {
+		glBindVertexArray(ctx->volume_proxies.vao);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ctx->volume_commands);
+
+		/* NOTE(rnp): the proxy faces are where rays end, not surfaces, and they are not
+		 * convex. every fragment of a volume is given the depth of its centre less a step
+		 * per place in the draw order. the depth test then passes only the first fragment
+		 * of a volume over a pixel, so each ray is marched (and blended) once, while the
+		 * volumes drawn after it, which are nearer, still pass. the layer composite sorts
+		 * by this depth too */
+		glProgramUniform1ui(program, MODEL_RENDER_CLIP_GEOMETRY_LOC, 0);
+		glProgramUniform1ui(program, MODEL_RENDER_ORDERED_DEPTH_LOC, 1);
+		draw_volume_proxies(ctx, only);
+	}
+}
+
+/* NOTE(rnp): view and projection of a region; the frustum is given by its extents on the
+ * near plane */
+typedef struct {
+	m4  view;
+	m4  projection;
+	v2  frustum_min;
+	v2  frustum_max;
+	f32 near_plane;
+	f32 far_plane;
+	f32 pixels_per_unit;  /* pixels of the full image per unit on the near plane */
+} SceneCamera;
+
+function m4
+frustum_projection(v2 min, v2 max, f32 n, f32 f)
+{
+	f32 a = -(f + n) / (f - n);
+	f32 b = -2 * f * n / (f - n);
+
+	m4 result;
+	result.c[0] = (v4){{2 * n / (max.x - min.x),         0,                               0,  0}};
+	result.c[1] = (v4){{0,                               2 * n / (max.y - min.y),         0,  0}};
+	result.c[2] = (v4){{(max.x + min.x) / (max.x - min.x), (max.y + min.y) / (max.y - min.y), a, -1}};
+	result.c[3] = (v4){{0,                               0,                               b,  0}};
+	return result;
+}
+
+/* NOTE(rnp): sets up the camera and projection for drawing the region of an image_size
+ * image starting at region_offset (in pixels from the bottom left) into a target of size.
+ * The projection is the sub-frustum of the full image's projection so that tiles can be
+ * stitched together without seams. Regions may extend past the image edges and fractional
+ * offsets shift the image by sub-pixel amounts. Face culling is left enabled for the
+ * ray marched modes. */
+function SceneCamera
+begin_scene_region(ViewerContext *ctx, sv2 size, sv2 image_size, v2 region_offset)
+{
+	ctx->camera_position.x =  0;
+	ctx->camera_position.z = -ctx->camera_radius;
+	ctx->camera_position.y =  ctx->camera_radius * tan_f32(ctx->camera_angle);
+
+	u32 program = ctx->model_programs[ctx->render_mode];
+
+	/* TODO(rnp): set this on hot reload instead of every frame */
+	v2 points = {{image_size.w, image_size.h}};
+	f32 n = 0.1f;
+	f32 f = 400.0f;
+	f32 r = n * tan_f32(ctx->camera_fov / 2 * PI / 180.0f);
+	f32 t = r * points.h / points.w;
+
+	SceneCamera result = {.near_plane = n, .far_plane = f, .pixels_per_unit = points.w / (2 * r)};
+	result.frustum_min.x = -r + 2 * r * (region_offset.x / points.w);
+	result.frustum_max.x = -r + 2 * r * ((region_offset.x + size.w) / points.w);
+	result.frustum_min.y = -t + 2 * t * (region_offset.y / points.h);
+	result.frustum_max.y = -t + 2 * t * ((region_offset.y + size.h) / points.h);
+
+	result.projection = frustum_projection(result.frustum_min, result.frustum_max, n, f);
+	glProgramUniformMatrix4fv(program, MODEL_RENDER_PROJ_MATRIX_LOC, 1, 0, result.projection.E);
+
+	v3 camera   = ctx->camera_position;
+	result.view = camera_view(camera, v3_normalize(v3_sub(camera, (v3){0})), (v3){{0, 1, 0}});
+	glProgramUniformMatrix4fv(program, MODEL_RENDER_VIEW_MATRIX_LOC, 1, 0, result.view.E);
+
+	glProgramUniform1f(program,  MODEL_RENDER_MAX_SAMPLES_LOC,   RAY_MARCH_MAX_SAMPLES);
+	glProgramUniform1f(program,  MODEL_RENDER_ABSORPTION_LOC,    RAY_MARCH_ABSORPTION);
+
+	/* NOTE(rnp): rays are marched from the back faces so each pixel is only marched once
+	 * and the camera may be inside a volume */
+	if (ctx->render_mode == RenderMode_MIP || ctx->render_mode == RenderMode_EmissionAbsorption) {
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_FRONT);
+	}
+	return result;
+}
+
+/* NOTE(rnp): draws the region (see begin_scene_region()) with the size of rt into rt */
+function void
+draw_scene_region(ViewerContext *ctx, RenderTarget *rt, f32 cycle_t, sv2 image_size, v2 region_offset)
+{
+	update_volumes(ctx, cycle_t, 0);
+	SceneCamera camera = begin_scene_region(ctx, rt->size, image_size, region_offset);
+	sort_volume_draws(ctx, camera.view);
+
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Scene);
+	glBindFramebuffer(GL_FRAMEBUFFER, rt->fb);
+	glClearNamedFramebufferfv(rt->fb, GL_COLOR, 0, OUTPUT_BG_CLEAR_COLOUR.E);
+	glClearNamedFramebufferfi(rt->fb, GL_DEPTH_STENCIL, 0, 1, 0);
+	glViewport(0, 0, rt->size.w, rt->size.h);
+
+	draw_volumes(ctx, 0);
+
+	glDisable(GL_CULL_FACE);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+}
+
+/* NOTE(rnp): parameters which change how every volume is drawn. the shader is identified
+ * by its reload count since a reloaded program may be given the name of the old one */
+function void
+stream_append_display_globals(Stream *s, ViewerContext *ctx)
+{
+	b32 log_scale = LOG_SCALE;
+	stream_append(s, &ctx->model_program_reloads, sizeof(ctx->model_program_reloads));
+	stream_append(s, &ctx->dynamic_range,         sizeof(ctx->dynamic_range));
+	stream_append(s, &ctx->render_mode,           sizeof(ctx->render_mode));
+	stream_append(s, &log_scale,                  sizeof(log_scale));
+}
+
+function void
+stream_append_volume_display(Stream *s, VolumeDisplayItem *v)
+{
+	stream_append(s, &v->min_coord_mm,  sizeof(v->min_coord_mm));
+	stream_append(s, &v->max_coord_mm,  sizeof(v->max_coord_mm));
+	stream_append(s, &v->clip_fraction, sizeof(v->clip_fraction));
+	stream_append(s, &v->threshold,     sizeof(v->threshold));
+	stream_append(s, &v->translate_x,   sizeof(v->translate_x));
+	stream_append(s, &v->swizzle,       sizeof(v->swizzle));
+	stream_append(s, &v->gain,          sizeof(v->gain));
+	stream_append(s, &v->step_size,     sizeof(v->step_size));
+}
+
+function u64
+display_parameters_hash(ViewerContext *ctx)
+{
+	u8 buffer[1024];
+	Stream s = {.data = buffer, .cap = sizeof(buffer)};
+
+	stream_append_display_globals(&s, ctx);
+	stream_append(&s, &single_volume_index, sizeof(single_volume_index));
+	for (u32 i = 0; i < countof(volumes); i++)
+		stream_append_volume_display(&s, volumes + i);
+	assert(!s.errors);
+
+	u64 result = str8_hash(stream_to_str8(&s));
+	return result;
+}
+
+/* NOTE(rnp): everything a volume's layer depends on; its own display parameters, its
+ * transform and the camera and projection of the region being drawn */
+function u64
+volume_layer_hash(ViewerContext *ctx, VolumeDisplayItem *v, f32 cycle_t, sv2 image_size,
+                  v2 region_offset, sv2 size)
+{
+	u8 buffer[256];
+	Stream s = {.data = buffer, .cap = sizeof(buffer)};
+
+	stream_append_display_globals(&s, ctx);
+	stream_append_volume_display(&s, v);
+	stream_append(&s, &cycle_t,            sizeof(cycle_t));
+	stream_append(&s, &ctx->camera_angle,  sizeof(ctx->camera_angle));
+	stream_append(&s, &ctx->camera_fov,    sizeof(ctx->camera_fov));
+	stream_append(&s, &ctx->camera_radius, sizeof(ctx->camera_radius));
+	stream_append(&s, &image_size,         sizeof(image_size));
+	stream_append(&s, &region_offset,      sizeof(region_offset));
+	stream_append(&s, &size,               sizeof(size));
+	assert(!s.errors);
+
+	u64 result = str8_hash(stream_to_str8(&s));
+	return result;
+}
+
+/* NOTE(rnp): like draw_scene_region() but each volume is drawn into its own layer of the
+ * volume layer targets, which are then composited into rt by depth. a layer is only
+ * redrawn when something it depends on changed so changing one of several volumes only
+ * costs drawing that volume again */
+function void
+draw_scene_layers(ViewerContext *ctx, RenderTarget *rt, f32 cycle_t, sv2 image_size, v2 region_offset)
+{
+	RenderTarget *layers = &ctx->volume_layers;
+	update_volumes(ctx, cycle_t, 0);
+	begin_scene_region(ctx, layers->size, image_size, region_offset);
+
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Scene);
+
+	/* NOTE(rnp): layers hold premultiplied colour over a transparent background. the
+	 * composite sorts the layers by depth for each sample and blends them back to front */
+	glBindFramebuffer(GL_FRAMEBUFFER, layers->fb);
+	glViewport(0, 0, layers->size.w, layers->size.h);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+	static_assert(countof(volumes) <= 32, "the composite takes a 32 bit layer mask");
+	u32 layer_mask = 0;
+	for (u32 i = 0; i < countof(volumes); i++) {
+		#if !DRAW_ALL_VOLUMES
+		if (i != single_volume_index) continue;
+		#endif
+		VolumeDisplayItem *v = volumes + i;
+		layer_mask |= 1u << v->instance;
+
+		u64 hash = volume_layer_hash(ctx, v, cycle_t, image_size, region_offset, layers->size);
+		if (hash == v->layer_hash) continue;
+		v->layer_hash = hash;
+
+		glNamedFramebufferTextureLayer(layers->fb, GL_COLOR_ATTACHMENT0, layers->textures[0],
+		                               0, v->instance);
+		glNamedFramebufferTextureLayer(layers->fb, GL_DEPTH_STENCIL_ATTACHMENT, layers->textures[1],
+		                               0, v->instance);
+		glClearNamedFramebufferfv(layers->fb, GL_COLOR, 0, (f32 []){0, 0, 0, 0});
+		glClearNamedFramebufferfi(layers->fb, GL_DEPTH_STENCIL, 0, 1, 0);
+		draw_volumes(ctx, v);
+	}
+	glDisable(GL_CULL_FACE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	/* NOTE(rnp): the composite runs per sample and writes every sample of rt */
+	u32 program = ctx->composite_render_context.shader;
+	glBindFramebuffer(GL_FRAMEBUFFER, rt->fb);
+	glViewport(0, 0, rt->size.w, rt->size.h);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glUseProgram(program);
+	glProgramUniform1ui(program, COMPOSITE_LAYER_MASK_LOC, layer_mask);
+	glProgramUniform4fv(program, COMPOSITE_BACKGROUND_LOC, 1, OUTPUT_BG_CLEAR_COLOUR.E);
+	glBindTextureUnit(0, layers->textures[0]);
+	glBindTextureUnit(1, layers->textures[1]);
+	glBindVertexArray(ctx->composite_render_context.vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glEnable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+}
+
+/* NOTE(rnp): is any part of the sphere (in view space) inside of the camera's frustum */
+function b32
+scene_sphere_visible(SceneCamera *camera, v3 centre, f32 radius)
+{
+	f32 n   = camera->near_plane;
+	v2  min = camera->frustum_min;
+	v2  max = camera->frustum_max;
+	b32 result = -centre.z + radius > n;
+	result &=  n * centre.x + max.x * centre.z <= radius * sqrt_f32(n * n + max.x * max.x);
+	result &= -n * centre.x - min.x * centre.z <= radius * sqrt_f32(n * n + min.x * min.x);
+	result &=  n * centre.y + max.y * centre.z <= radius * sqrt_f32(n * n + max.y * max.y);
+	result &= -n * centre.y - min.y * centre.z <= radius * sqrt_f32(n * n + min.y * min.y);
+	return result;
+}
+
+function VolumeDisplayItem *
+gallery_item_volume(u32 index)
+{
+	#if DRAW_ALL_VOLUMES
+	VolumeDisplayItem *result = volumes + index % countof(volumes);
+	#else
+	VolumeDisplayItem *result = volumes + single_volume_index;
+	#endif
+	return result;
+}
+
+/* NOTE(rnp): view matrix which places v, scaled to fit in a sphere of radius, at the view
+ * space position centre. the volume is seen from the same direction as in the view */
+function m4
+gallery_item_view(SceneCamera *camera, VolumeDisplayItem *v, v3 centre, f32 radius)
+{
+	v3  extent = v3_sub(v->max_coord_mm, v->min_coord_mm);
+	f32 scale  = radius / sqrt_f32(v3_dot(extent, extent));
+
+	m4 result;
+	for (u32 i = 0; i < 3; i++)
+		result.c[i] = (v4){.xyz = v3_scale(camera->view.c[i].xyz, scale)};
+	result.c[3] = (v4){{centre.x, centre.y, centre.z, 1}};
+	return result;
+}
+
+/* NOTE(rnp): square on the near plane which the bounding cube of the sphere projects into;
+ * as x0, y0, x1, y1 */
+function v4
+gallery_impostor_rect(f32 n, v3 centre, f32 radius)
+{
+	v2 lo = {{ F32_INFINITY,  F32_INFINITY}};
+	v2 hi = {{-F32_INFINITY, -F32_INFINITY}};
+	for (u32 i = 0; i < 8; i++) {
+		v3 p = {{centre.x + (i & 1 ? radius : -radius),
+		         centre.y + (i & 2 ? radius : -radius),
+		         centre.z + (i & 4 ? radius : -radius)}};
+		f32 x = n * p.x / -p.z;
+		f32 y = n * p.y / -p.z;
+		lo.x = MIN(lo.x, x); lo.y = MIN(lo.y, y);
+		hi.x = MAX(hi.x, x); hi.y = MAX(hi.y, y);
+	}
+	f32 half = MAX(hi.x - lo.x, hi.y - lo.y) / 2;
+	v2  mid  = {{(lo.x + hi.x) / 2, (lo.y + hi.y) / 2}};
+	v4 result = {{mid.x - half, mid.y - half, mid.x + half, mid.y + half}};
+	return result;
+}
+
+/* NOTE(rnp): ray march sample budget for a cell with the given projected radius */
+function f32
+gallery_ray_march_samples(f32 pixels)
+{
+	f32 result = RAY_MARCH_MAX_SAMPLES * MIN(1, pixels / GALLERY_FULL_DETAIL_PIXELS);
+	result     = MAX(result, 16);
+	return result;
+}
+
+function u64
+gallery_impostor_hash(ViewerContext *ctx, VolumeDisplayItem *v)
+{
+	u8 buffer[256];
+	Stream s = {.data = buffer, .cap = sizeof(buffer)};
+	stream_append_display_globals(&s, ctx);
+	stream_append_volume_display(&s, v);
+	stream_append(&s, &ctx->camera_angle,  sizeof(ctx->camera_angle));
+	stream_append(&s, &ctx->camera_fov,    sizeof(ctx->camera_fov));
+	stream_append(&s, &ctx->camera_radius, sizeof(ctx->camera_radius));
+	assert(!s.errors);
+
+	u64 result = str8_hash(stream_to_str8(&s));
+	return result;
+}
+
+typedef struct {
+	u32 index;
+	v3  centre;  /* view space */
+	f32 pixels;  /* projected radius in image pixels */
+	b32 refresh;
+} GalleryCell;
+
+/* NOTE(rnp): draws the cells of the gallery in view into rt. Rows start at the bottom of
+ * the view, level with the origin, and recede along a plane tilted GALLERY_TILT degrees
+ * away from the camera so that each cell's size on screen follows its own depth. cells
+ * which are too small on screen to be worth ray marching are drawn as sprites of their
+ * impostors; up to GALLERY_IMPOSTOR_UPDATES of the impostors which are out of date are
+ * redrawn first */
+function void
+draw_gallery(ViewerContext *ctx, RenderTarget *rt, f32 cycle_t)
+{
+	Gallery *g = &ctx->gallery;
+	update_volumes(ctx, cycle_t, 1);
+	SceneCamera camera = begin_scene_region(ctx, rt->size, rt->size, (v2){0});
+	u32 program        = ctx->model_programs[ctx->render_mode];
+
+	f32 n      = camera.near_plane;
+	f32 depth  = sqrt_f32(v3_dot(ctx->camera_position, ctx->camera_position));
+	f32 pitch  = GALLERY_CELL_MM;
+	f32 radius = 0.45f * pitch;
+	f32 bottom = -depth * rt->size.h / (2 * camera.pixels_per_unit * n);
+	f32 tilt   = GALLERY_TILT * PI / 180.0f;
+	v2  row_step = {{pitch * cos_f32(tilt), pitch * sin_f32(tilt)}};
+	f32 far    = camera.far_plane;
+
+	Arena scratch = ctx->arena;
+	GalleryCell *cells = push_array(&scratch, GalleryCell, g->item_count);
+	u32 cell_count = 0, outdated = 0;
+	for (u32 i = 0; i < g->item_count; i++) {
+		u32 row    = i / GALLERY_COLUMNS;
+		u32 column = i % GALLERY_COLUMNS;
+		f32 along  = (f32)row - (f32)g->first_row + 0.5f;
+		v3  centre = {{((f32)column - (GALLERY_COLUMNS - 1) / 2.0f) * pitch,
+		               bottom + along * row_step.x, -depth - along * row_step.y}};
+		if (!scene_sphere_visible(&camera, centre, radius))
+			continue;
+
+		GalleryCell *c = cells + cell_count++;
+		c->index  = i;
+		c->centre = centre;
+		c->pixels = radius * n / -centre.z * camera.pixels_per_unit;
+		far       = MAX(far, -centre.z + radius);
+		if (c->pixels < GALLERY_IMPOSTOR_PIXELS && -centre.z - radius > n) {
+			/* NOTE(rnp): while rotating impostors are only redrawn at a low rate */
+			GalleryItem *item = g->items + i;
+			f32 dt = ABS(cycle_t - item->impostor_cycle_t);
+			dt     = MIN(dt, 1 - dt);
+			b32 changed = item->impostor_hash != gallery_impostor_hash(ctx, gallery_item_volume(i));
+			c->refresh  = changed || dt >= GALLERY_IMPOSTOR_PERIOD || (!ctx->demo_mode && dt > 0);
+			outdated   += c->refresh;
+		} else {
+			c->pixels = MAX(c->pixels, GALLERY_IMPOSTOR_PIXELS);
+		}
+	}
+
+	/* NOTE(rnp): the far rows may lie beyond the scene's far plane */
+	if (far > camera.far_plane) {
+		camera.far_plane  = far;
+		camera.projection = frustum_projection(camera.frustum_min, camera.frustum_max, n, far);
+		glProgramUniformMatrix4fv(program, MODEL_RENDER_PROJ_MATRIX_LOC, 1, 0, camera.projection.E);
+	}
+
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Scene);
+
+	/* NOTE(rnp): impostors which were never drawn or whose parameters changed go first */
+	u32 budget = GALLERY_IMPOSTOR_UPDATES;
+	for (u32 pass = 0; pass < 2 && budget; pass++) {
+		for (u32 i = 0; i < cell_count && budget; i++) {
+			GalleryCell *c = cells + i;
+			if (!c->refresh) continue;
 
-	glfwSetKeyCallback(ctx->window, key_callback);
-	glfwSetScrollCallback(ctx->window, scroll_callback);
-	glfwSetFramebufferSizeCallback(ctx->window, fb_callback);
+			GalleryItem       *item = g->items + c->index;
+			VolumeDisplayItem *v    = gallery_item_volume(c->index);
+			u64 hash = gallery_impostor_hash(ctx, v);
+			if (pass == 0 && item->impostor_hash == hash) continue;
 
-	#define X(name, ret, params) name = (name##_fn *)glfwGetProcAddress(#name);
-	OGLProcedureList
-	#undef X
+			if (budget == GALLERY_IMPOSTOR_UPDATES) {
+				glBindFramebuffer(GL_FRAMEBUFFER, g->impostor_fb);
+				glViewport(0, 0, GALLERY_IMPOSTOR_SIZE, GALLERY_IMPOSTOR_SIZE);
+				glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+				glProgramUniform1f(program, MODEL_RENDER_MAX_SAMPLES_LOC,
+				                   gallery_ray_march_samples(GALLERY_IMPOSTOR_SIZE / 2));
+			}
+			budget--;
+			outdated--;
 
-	/* NOTE: set up OpenGL debug logging */
-	struct gl_debug_ctx *gl_debug_ctx = push_struct(&ctx->arena, typeof(*gl_debug_ctx));
-	gl_debug_ctx->stream = stream_alloc(&ctx->arena, KB(4));
-	gl_debug_ctx->os     = &ctx->os;
-	glDebugMessageCallback(gl_debug_logger, gl_debug_ctx);
-#ifdef _DEBUG
-	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-#endif
+			v4 rect = gallery_impostor_rect(n, c->centre, radius);
+			m4 projection = frustum_projection(rect.xy, rect.zw, n, camera.far_plane);
+			m4 view       = gallery_item_view(&camera, v, c->centre, radius);
+			glProgramUniformMatrix4fv(program, MODEL_RENDER_PROJ_MATRIX_LOC, 1, 0, projection.E);
+			glProgramUniformMatrix4fv(program, MODEL_RENDER_VIEW_MATRIX_LOC, 1, 0, view.E);
 
-	glEnable(GL_MULTISAMPLE);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
+			glNamedFramebufferTextureLayer(g->impostor_fb, GL_COLOR_ATTACHMENT0, g->impostor_texture,
+			                               0, c->index);
+			glClearNamedFramebufferfv(g->impostor_fb, GL_COLOR, 0, (f32 []){0, 0, 0, 0});
+			glClearNamedFramebufferfi(g->impostor_fb, GL_DEPTH_STENCIL, 0, 1, 0);
+			draw_volumes(ctx, v);
+
+			item->impostor_hash    = hash;
+			item->impostor_cycle_t = cycle_t;
+			c->refresh             = 0;
+		}
+	}
+	g->stale_impostors = outdated;
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glProgramUniformMatrix4fv(program, MODEL_RENDER_PROJ_MATRIX_LOC, 1, 0, camera.projection.E);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, rt->fb);
+	glClearNamedFramebufferfv(rt->fb, GL_COLOR, 0, OUTPUT_BG_CLEAR_COLOUR.E);
+	glClearNamedFramebufferfi(rt->fb, GL_DEPTH_STENCIL, 0, 1, 0);
+	glViewport(0, 0, rt->size.w, rt->size.h);
+
+	GallerySprite *sprites = push_array(&scratch, GallerySprite, cell_count);
+	u32 sprite_count = 0;
+	for (u32 i = 0; i < cell_count; i++) {
+		GalleryCell       *c = cells + i;
+		VolumeDisplayItem *v = gallery_item_volume(c->index);
+		if (c->pixels < GALLERY_IMPOSTOR_PIXELS) {
+			if (g->items[c->index].impostor_hash) {
+				v4  rect  = gallery_impostor_rect(n, c->centre, radius);
+				f32 scale = -c->centre.z / n;
+				GallerySprite *sprite = sprites + sprite_count++;
+				sprite->rect  = (v4){{rect.x * scale, rect.y * scale, rect.z * scale, rect.w * scale}};
+				sprite->depth = c->centre.z;
+				sprite->layer = c->index;
+			}
+		} else {
+			m4 view = gallery_item_view(&camera, v, c->centre, radius);
+			glProgramUniformMatrix4fv(program, MODEL_RENDER_VIEW_MATRIX_LOC, 1, 0, view.E);
+			glProgramUniform1f(program, MODEL_RENDER_MAX_SAMPLES_LOC, gallery_ray_march_samples(c->pixels));
+			draw_volumes(ctx, v);
+		}
+	}
+	glDisable(GL_CULL_FACE);
+
+	if (sprite_count) {
+		RenderContext *rc = &g->sprite_render_context;
+		glNamedBufferSubData(g->sprites, 0, sprite_count * sizeof(*sprites), sprites);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, g->sprites);
+		glUseProgram(rc->shader);
+		glProgramUniformMatrix4fv(rc->shader, GALLERY_SPRITE_PROJECTION_LOC, 1, 0, camera.projection.E);
+		glBindTextureUnit(0, g->impostor_texture);
+		glBindVertexArray(rc->vao);
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, sprite_count);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	gpu_timer_end(&ctx->gpu_timers, zone);
+}
 
-	RenderContext *rc = &ctx->model_render_context;
+/* NOTE(rnp): radical inverse of index in base */
+function f32
+halton(u32 index, u32 base)
+{
+	f32 result = 0, f = 1;
+	for (; index; index /= base) {
+		f      /= base;
+		result += f * (index % base);
+	}
+	return result;
+}
+
+/* NOTE(rnp): draws one more sub-pixel jittered sample of the region and folds it into
+ * the running mean held in the accumulation target */
+function void
+accumulate_scene_sample(ViewerContext *ctx, f32 cycle_t, sv2 image_size, sv2 region_offset)
+{
+	u32 index  = ++ctx->accumulated_samples;
+	v2  offset = {{region_offset.x + halton(index, 2) - 0.5f,
+	               region_offset.y + halton(index, 3) - 0.5f}};
+	draw_scene_region(ctx, &ctx->multisample_target, cycle_t, image_size, offset);
+
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Resolve);
+	RenderTarget *rt = &ctx->accumulation_target;
+	u32 program      = ctx->accumulate_render_context.shader;
+	glBindFramebuffer(GL_FRAMEBUFFER, rt->fb);
+	glViewport(0, 0, rt->size.w, rt->size.h);
+	glColorMask(1, 1, 1, 0);
+	glUseProgram(program);
+	glProgramUniform1f(program, ACCUMULATE_WEIGHT_LOC, 1.0f / index);
+	glBindTextureUnit(0, ctx->multisample_target.textures[0]);
+	glBindVertexArray(ctx->accumulate_render_context.vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glColorMask(1, 1, 1, 1);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+}
+
+function void
+resolve_accumulation(ViewerContext *ctx, RenderTarget *output)
+{
+	RenderTarget *rt = &ctx->accumulation_target;
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Resolve);
+	glBlitNamedFramebuffer(rt->fb, output->fb, 0, 0, rt->size.w, rt->size.h,
+	                       0, 0, rt->size.w, rt->size.h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+}
 
+function void
+render_scene_region(ViewerContext *ctx, RenderTarget *output, f32 cycle_t, sv2 image_size,
+                    sv2 region_offset)
+{
 	RenderTarget *rt = &ctx->multisample_target;
-	rt->size = (sv2){{RENDER_TARGET_SIZE}};
-	glCreateRenderbuffers(countof(rt->textures), rt->textures);
-	glNamedRenderbufferStorageMultisample(rt->textures[0], RENDER_MSAA_SAMPLES,
-	                                      GL_RGBA8, RENDER_TARGET_SIZE);
-	glNamedRenderbufferStorageMultisample(rt->textures[1], RENDER_MSAA_SAMPLES,
-	                                      GL_DEPTH_COMPONENT24, RENDER_TARGET_SIZE);
-	glCreateFramebuffers(1, &rt->fb);
-	glNamedFramebufferRenderbuffer(rt->fb, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rt->textures[0]);
-	glNamedFramebufferRenderbuffer(rt->fb, GL_DEPTH_ATTACHMENT,  GL_RENDERBUFFER, rt->textures[1]);
+	if (RENDER_ACCUMULATION_SAMPLES) {
+		ctx->accumulated_samples = 0;
+		for (u32 i = 0; i < RENDER_ACCUMULATION_SAMPLES; i++)
+			accumulate_scene_sample(ctx, cycle_t, image_size, region_offset);
+		resolve_accumulation(ctx, output);
+	} else {
+		draw_scene_region(ctx, rt, cycle_t, image_size, (v2){{region_offset.x, region_offset.y}});
+		/* NOTE(rnp): resolve multisampled scene */
+		u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Resolve);
+		glBlitNamedFramebuffer(rt->fb, output->fb, 0, 0, rt->size.w, rt->size.h,
+		                       0, 0, rt->size.w, rt->size.h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		gpu_timer_end(&ctx->gpu_timers, zone);
+	}
+}
 
-	rt = &ctx->output_target;
-	glCreateTextures(GL_TEXTURE_2D, countof(rt->textures), rt->textures);
-	rt->size = (sv2){{RENDER_TARGET_SIZE}};
-	glTextureStorage2D(rt->textures[0], 8, GL_RGBA8,             RENDER_TARGET_SIZE);
-	glTextureStorage2D(rt->textures[1], 1, GL_DEPTH_COMPONENT24, RENDER_TARGET_SIZE);
+function void
+render_scene(ViewerContext *ctx, RenderTarget *output, f32 cycle_t)
+{
+	render_scene_region(ctx, output, cycle_t, ctx->multisample_target.size, (sv2){0});
+}
 
-	glCreateFramebuffers(1, &rt->fb);
-	glNamedFramebufferTexture(rt->fb, GL_COLOR_ATTACHMENT0, rt->textures[0], 0);
-	glNamedFramebufferTexture(rt->fb, GL_DEPTH_ATTACHMENT,  rt->textures[1], 0);
+/* NOTE(rnp): render_scene() through the volume layers when they exist. only the interactive
+ * view uses them; frames rendered in the background for the frame cache would replace the
+ * layers of the view with layers that are never shown */
+function void
+render_view(ViewerContext *ctx, RenderTarget *output, f32 cycle_t)
+{
+	RenderTarget *rt = &ctx->multisample_target;
+	if (ctx->composite_render_context.shader) {
+		draw_scene_layers(ctx, rt, cycle_t, rt->size, (v2){0});
+		u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Resolve);
+		glBlitNamedFramebuffer(rt->fb, output->fb, 0, 0, rt->size.w, rt->size.h,
+		                       0, 0, rt->size.w, rt->size.h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		gpu_timer_end(&ctx->gpu_timers, zone);
+	} else {
+		render_scene(ctx, output, cycle_t);
+	}
+}
 
-	glTextureParameteri(rt->textures[0], GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTextureParameteri(rt->textures[0], GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+/* NOTE(rnp): the gallery is always drawn at full quality. it is not accumulated, scaled or
+ * kept in the frame cache since each frame depends on the impostors left by earlier ones */
+function void
+render_gallery(ViewerContext *ctx, RenderTarget *output, f32 cycle_t)
+{
+	RenderTarget *rt = &ctx->multisample_target;
+	draw_gallery(ctx, rt, cycle_t);
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Resolve);
+	glBlitNamedFramebuffer(rt->fb, output->fb, 0, 0, rt->size.w, rt->size.h,
+	                       0, 0, rt->size.w, rt->size.h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+}
 
-	ShaderReloadContext *model_rc = push_struct(&ctx->arena, ShaderReloadContext);
-	model_rc->render_context = rc;
-	model_rc->vertex_text = str8(""
-	"#version 460 core\n"
-	"\n"
-	"layout(location = 0) in vec3 v_position;\n"
-	"layout(location = 1) in vec3 v_normal;\n"
-	"\n"
-	"layout(location = 0) out vec3 f_normal;\n"
-	"layout(location = 1) out vec3 f_texture_coordinate;\n"
-	"layout(location = 2) out vec3 f_orig_texture_coordinate;\n"
-	"\n"
-	"layout(location = " str(MODEL_RENDER_MODEL_MATRIX_LOC)  ") uniform mat4  u_model;\n"
-	"layout(location = " str(MODEL_RENDER_VIEW_MATRIX_LOC)   ") uniform mat4  u_view;\n"
-	"layout(location = " str(MODEL_RENDER_PROJ_MATRIX_LOC)   ") uniform mat4  u_projection;\n"
-	"layout(location = " str(MODEL_RENDER_CLIP_FRACTION_LOC) ") uniform float u_clip_fraction = 1;\n"
-	"layout(location = " str(MODEL_RENDER_SWIZZLE_LOC)       ") uniform bool  u_swizzle;\n"
-	"\n"
-	"\n"
-	"void main()\n"
-	"{\n"
-	"\tvec3 pos = v_position;\n"
-	"\tf_orig_texture_coordinate = (v_position + 1) / 2;\n"
-	"\tif (v_position.y == -1) pos.x = clamp(v_position.x, -u_clip_fraction, u_clip_fraction);\n"
-	"\tvec3 tex_coord = (pos + 1) / 2;\n"
-	"\tf_texture_coordinate = u_swizzle? tex_coord.xzy : tex_coord;\n"
-	//"\tf_normal    = normalize(mat3(u_model) * v_normal);\n"
-	"\tf_normal    = v_normal;\n"
-	"\tgl_Position = u_projection * u_view * u_model * vec4(pos, 1);\n"
-	"}\n");
+/* NOTE(rnp): draws the whole view at scale times the output size with the interactive
+ * sample count and stretches it over output. the cache target holds the resolve since a
+ * multisample resolve can not also scale */
+function void
+render_scene_scaled(ViewerContext *ctx, RenderTarget *output, f32 cycle_t, f32 scale)
+{
+	RenderTarget *rt      = &ctx->interactive_target;
+	RenderTarget *resolve = &ctx->cache_target;
+	rt->size.w = MAX(1, (s32)(output->size.w * scale + 0.5f));
+	rt->size.h = MAX(1, (s32)(output->size.h * scale + 0.5f));
 
-	model_rc->fragment_header = str8(""
-	"#version 460 core\n\n"
-	"layout(location = 0) in  vec3 normal;\n"
-	"layout(location = 1) in  vec3 texture_coordinate;\n\n"
-	"layout(location = 2) in  vec3 test_texture_coordinate;\n\n"
-	"layout(location = 0) out vec4 out_colour;\n\n"
-	"layout(location = " str(MODEL_RENDER_DYNAMIC_RANGE_LOC) ") uniform float u_db_cutoff = 60;\n"
-	"layout(location = " str(MODEL_RENDER_THRESHOLD_LOC)     ") uniform float u_threshold = 40;\n"
-	"layout(location = " str(MODEL_RENDER_GAMMA_LOC)         ") uniform float u_gamma     = 1;\n"
-	"layout(location = " str(MODEL_RENDER_LOG_SCALE_LOC)     ") uniform bool  u_log_scale;\n"
-	"layout(location = " str(MODEL_RENDER_BB_COLOUR_LOC)     ") uniform vec4  u_bb_colour   = vec4(" str(BOUNDING_BOX_COLOUR) ");\n"
-	"layout(location = " str(MODEL_RENDER_BB_FRACTION_LOC)   ") uniform float u_bb_fraction = " str(BOUNDING_BOX_FRACTION) ";\n"
-	"layout(location = " str(MODEL_RENDER_GAIN_LOC)          ") uniform float u_gain        = 1.0f;\n"
-	"\n"
-	"layout(binding = 0) uniform sampler3D u_texture;\n"
-	"\n#line 1\n");
+	/* NOTE(rnp): keep the clears to the region being drawn */
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, rt->size.w, rt->size.h);
+	draw_scene_region(ctx, rt, cycle_t, rt->size, (v2){0});
+	glDisable(GL_SCISSOR_TEST);
+
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Resolve);
+	glBlitNamedFramebuffer(rt->fb, resolve->fb, 0, 0, rt->size.w, rt->size.h,
+	                       0, 0, rt->size.w, rt->size.h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBlitNamedFramebuffer(resolve->fb, output->fb, 0, 0, rt->size.w, rt->size.h,
+	                       0, 0, output->size.w, output->size.h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+}
+
+function FrameCacheKey
+frame_cache_key(ViewerContext *ctx, u32 grid_index)
+{
+	FrameCacheKey result = {
+		.parameters_hash = display_parameters_hash(ctx),
+		.camera_angle    = ctx->camera_angle,
+		.camera_fov      = ctx->camera_fov,
+		.camera_radius   = ctx->camera_radius,
+		.grid_index      = grid_index,
+		.size            = ctx->output_target.size,
+	};
+	return result;
+}
+
+function b32
+frame_cache_key_equal(FrameCacheKey a, FrameCacheKey b)
+{
+	b32 result = a.parameters_hash == b.parameters_hash &&
+	             a.camera_angle    == b.camera_angle    &&
+	             a.camera_fov      == b.camera_fov      &&
+	             a.camera_radius   == b.camera_radius   &&
+	             a.grid_index      == b.grid_index      &&
+	             a.size.w          == b.size.w          &&
+	             a.size.h          == b.size.h;
+	return result;
+}
+
+/* NOTE(rnp): packet header: high bit set -> the following pixel is repeated (header & 0x7FFFFFFF)
+ * times, otherwise (header) literal pixels follow. output must have space for 2 * count */
+function sz
+frame_rle_encode(u32 *out, u32 *pixels, sz count)
+{
+	u32 *start = out;
+	sz i = 0;
+	while (i < count) {
+		sz run = 1;
+		while (i + run < count && run < I32_MAX && pixels[i + run] == pixels[i]) run++;
+		if (run >= 3) {
+			*out++ = 0x80000000UL | (u32)run;
+			*out++ = pixels[i];
+			i += run;
+		} else {
+			u32 *header = out++;
+			sz literal  = 0;
+			while (i + literal < count && literal < I32_MAX) {
+				u32 p = pixels[i + literal];
+				if (i + literal + 2 < count && pixels[i + literal + 1] == p &&
+				    pixels[i + literal + 2] == p)
+				{
+					break;
+				}
+				*out++ = p;
+				literal++;
+			}
+			*header = (u32)literal;
+			i += literal;
+		}
+	}
+	return out - start;
+}
+
+function void
+frame_rle_decode(u32 *out, u32 *packets, sz pixel_count)
+{
+	u32 *end = out + pixel_count;
+	while (out < end) {
+		u32 header = *packets++;
+		u32 count  = header & 0x7FFFFFFFUL;
+		if (header & 0x80000000UL) {
+			u32 p = *packets++;
+			for (u32 i = 0; i < count; i++) *out++ = p;
+		} else {
+			mem_copy(out, packets, count * sizeof(u32));
+			out     += count;
+			packets += count;
+		}
+	}
+}
+
+function FrameCacheEntry *
+frame_cache_lookup(FrameCache *fc, FrameCacheKey key)
+{
+	FrameCacheEntry *result = 0;
+	for (u32 i = 0; key.grid_index != U32_MAX && i < fc->count; i++) {
+		FrameCacheEntry *e = fc->entries + (fc->first + i) % countof(fc->entries);
+		if (frame_cache_key_equal(e->key, key)) {
+			result = e;
+			break;
+		}
+	}
+	return result;
+}
+
+function b32
+frame_cache_read(FrameCache *fc, FrameCacheKey key, u8 *out)
+{
+	FrameCacheEntry *e = frame_cache_lookup(fc, key);
+	if (e) {
+		u8 *data = fc->memory.beg + e->offset;
+		sz bytes = output_mip_bytes(key.size, 0);
+		if (e->compressed) frame_rle_decode((u32 *)out, (u32 *)data, bytes / sizeof(u32));
+		else               mem_copy(out, data, bytes);
+	}
+	return e != 0;
+}
+
+function b32
+frame_cache_overlaps(FrameCache *fc, sz offset, sz size)
+{
+	b32 result = 0;
+	for (u32 i = 0; !result && i < fc->count; i++) {
+		FrameCacheEntry *e = fc->entries + (fc->first + i) % countof(fc->entries);
+		result = e->offset < offset + size && offset < e->offset + e->size;
+	}
+	return result;
+}
+
+/* NOTE(rnp): entries live in a ring buffer and are evicted oldest first */
+function void
+frame_cache_insert(FrameCache *fc, FrameCacheKey key, u8 *frame)
+{
+	if (key.grid_index == U32_MAX || frame_cache_lookup(fc, key))
+		return;
+
+	if (!fc->memory.beg) {
+		fc->memory  = os_alloc_arena(FRAME_CACHE_MEMORY);
+		fc->scratch = os_alloc_arena(2 * OUTPUT_FRAME_SIZE);
+		if (!fc->memory.beg || !fc->scratch.beg) return;
+	}
+
+	str8 data = {.len = output_mip_bytes(key.size, 0), .data = frame};
+	b32 compressed = 0;
+	if (FRAME_CACHE_COMPRESS) {
+		u32 *packed = (u32 *)fc->scratch.beg;
+		sz words    = frame_rle_encode(packed, (u32 *)frame, data.len / sizeof(u32));
+		if (words * sizeof(u32) < data.len) {
+			data       = (str8){.len = words * sizeof(u32), .data = (u8 *)packed};
+			compressed = 1;
+		}
+	}
+
+	sz capacity = fc->memory.end - fc->memory.beg;
+	if (data.len > capacity) return;
+	if (fc->head + data.len > capacity) fc->head = 0;
+
+	while (fc->count && (fc->count == countof(fc->entries) ||
+	                     frame_cache_overlaps(fc, fc->head, data.len)))
+	{
+		fc->first = (fc->first + 1) % countof(fc->entries);
+		fc->count--;
+	}
+
+	FrameCacheEntry *e = fc->entries + (fc->first + fc->count++) % countof(fc->entries);
+	e->key        = key;
+	e->offset     = fc->head;
+	e->size       = data.len;
+	e->compressed = compressed;
+	mem_copy(fc->memory.beg + e->offset, data.data, data.len);
+	fc->head += data.len;
+}
+
+function void
+frame_cache_store(ViewerContext *ctx, FrameCacheKey key, RenderTarget *rt)
+{
+	FrameCache *fc = &ctx->frame_cache;
+	if (key.grid_index == U32_MAX || ctx->headless)
+		return;
+	if (!fc->frame.beg) fc->frame = os_alloc_arena(OUTPUT_FRAME_SIZE);
+	if (fc->frame.beg) {
+		/* NOTE(rnp): synchronous; only the copy itself is timed, not the wait for it */
+		u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Readback);
+		glGetTextureImage(rt->textures[0], 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
+		                  OUTPUT_FRAME_SIZE, fc->frame.beg);
+		gpu_timer_end(&ctx->gpu_timers, zone);
+		frame_cache_insert(fc, key, fc->frame.beg);
+	}
+}
+
+function b32
+frame_cache_upload(ViewerContext *ctx, FrameCacheKey key, RenderTarget *rt)
+{
+	FrameCache *fc = &ctx->frame_cache;
+	b32 result = fc->frame.beg && frame_cache_read(fc, key, fc->frame.beg);
+	if (result) {
+		glTextureSubImage2D(rt->textures[0], 0, 0, 0, rt->size.w, rt->size.h, GL_RGBA,
+		                    GL_UNSIGNED_INT_8_8_8_8, fc->frame.beg);
+	}
+	return result;
+}
+
+/* NOTE(rnp): returns 1 while a prefetch read back is still in flight */
+function b32
+frame_cache_collect_readback(ViewerContext *ctx)
+{
+	FrameCache *fc = &ctx->frame_cache;
+	b32 result = fc->readback_fence != 0;
+	if (result && glClientWaitSync(fc->readback_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) != GL_TIMEOUT_EXPIRED) {
+		glGetNamedBufferSubData(fc->readback_buffer, 0, OUTPUT_FRAME_SIZE, fc->frame.beg);
+		frame_cache_insert(fc, fc->readback_key, fc->frame.beg);
+		glDeleteSync(fc->readback_fence);
+		fc->readback_fence = 0;
+		result = 0;
+	}
+	return result;
+}
+
+/* NOTE(rnp): queues a read back of a prefetched frame into a pixel buffer. the frame is
+ * only copied out by frame_cache_collect_readback() once its fence has signalled so the
+ * main loop never waits on the GPU for a frame nobody is looking at yet */
+function void
+frame_cache_start_readback(ViewerContext *ctx, FrameCacheKey key, RenderTarget *rt)
+{
+	FrameCache *fc = &ctx->frame_cache;
+	if (!fc->frame.beg) fc->frame = os_alloc_arena(OUTPUT_FRAME_SIZE);
+	if (!fc->frame.beg) return;
+
+	/* NOTE(rnp): the pending frame is either collected or dropped; its key must not be
+	 * attached to the frame being read back now */
+	if (frame_cache_collect_readback(ctx)) {
+		glDeleteSync(fc->readback_fence);
+		fc->readback_fence = 0;
+	}
+
+	if (!fc->readback_buffer) {
+		glCreateBuffers(1, &fc->readback_buffer);
+		glNamedBufferStorage(fc->readback_buffer, OUTPUT_FRAME_SIZE, 0, 0);
+	}
+
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Readback);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, fc->readback_buffer);
+	glGetTextureImage(rt->textures[0], 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8, OUTPUT_FRAME_SIZE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+
+	fc->readback_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	fc->readback_key   = key;
+}
+
+/* NOTE(rnp): render one uncached frame near the current scrub position while idle;
+ * returns 0 once every frame within the prefetch radius is cached */
+function b32
+frame_cache_prefetch(ViewerContext *ctx)
+{
+	u32 grid_index = cycle_t_grid_index(ctx->cycle_t);
+	if (grid_index == U32_MAX || ctx->headless)
+		return 0;
+	if (frame_cache_collect_readback(ctx))
+		return 1;
+
+	u32 grid_count = OUTPUT_FRAME_RATE * OUTPUT_TIME_SECONDS;
+	for (u32 i = 1; i <= FRAME_CACHE_PREFETCH_RADIUS; i++) {
+		u32 forward  = (grid_index + i * SCRUB_FRAME_STEP) % grid_count;
+		u32 backward = (grid_index + grid_count - (i * SCRUB_FRAME_STEP) % grid_count) % grid_count;
+		u32 candidates[2] = {forward, backward};
+		for (u32 j = 0; j < countof(candidates); j++) {
+			FrameCacheKey key = frame_cache_key(ctx, candidates[j]);
+			if (!frame_cache_lookup(&ctx->frame_cache, key)) {
+				render_scene(ctx, &ctx->cache_target, cycle_t_from_grid(candidates[j]));
+				frame_cache_start_readback(ctx, key, &ctx->cache_target);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* NOTE(rnp): CPU rasterisers split the frame into tiles shared out between their threads.
+ * below one tile per thread a smaller frame leaves threads idle instead of finishing sooner */
+function f32
+interactive_min_scale(ViewerContext *ctx)
+{
+	f32 result = INTERACTIVE_MIN_SCALE;
+	if (ctx->profile.rasteriser_threads) {
+		sv2 size   = ctx->output_target.size;
+		f32 pixels = (f32)ctx->profile.rasteriser_threads * SOFTWARE_RASTER_TILE * SOFTWARE_RASTER_TILE;
+		result     = CLAMP(sqrt_f32(pixels / ((f32)size.w * size.h)), result, 1);
+	}
+	return result;
+}
+
+/* NOTE(rnp): returns 0 if every query is still in flight and the frame is not timed */
+function b32
+interactive_timer_begin(InteractiveFrameTimer *t)
+{
+	b32 result = t->write_index - t->read_index < INTERACTIVE_TIMER_FRAMES;
+	if (result) glBeginQuery(GL_TIME_ELAPSED, t->queries[t->write_index % INTERACTIVE_TIMER_FRAMES]);
+	return result;
+}
+
+function void
+interactive_timer_end(InteractiveFrameTimer *t, b32 timed, f32 scale)
+{
+	if (timed) {
+		glEndQuery(GL_TIME_ELAPSED);
+		t->scales[t->write_index++ % INTERACTIVE_TIMER_FRAMES] = scale;
+	}
+}
+
+/* NOTE(rnp): picks the scale of the next interactive frame from the GPU time taken by the
+ * timed frames which have finished, assuming the frame time is proportional to the number
+ * of pixels drawn. averaging with the previous scale keeps one slow frame from dropping
+ * the resolution all the way down */
+function void
+update_interactive_scale(ViewerContext *ctx)
+{
+	InteractiveFrameTimer *t = &ctx->interactive_timer;
+	while (t->read_index != t->write_index) {
+		u32 query     = t->queries[t->read_index % INTERACTIVE_TIMER_FRAMES];
+		s32 available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+		f32 scale      = t->scales[t->read_index++ % INTERACTIVE_TIMER_FRAMES];
+		f32 frame_time = (f32)elapsed / 1e9f;
+		f32 next       = scale * sqrt_f32(INTERACTIVE_FRAME_TIME / MAX(frame_time, 1e-4f));
+		ctx->interactive_scale = CLAMP((ctx->interactive_scale + next) / 2, interactive_min_scale(ctx), 1);
+	}
+}
+
+/* NOTE(rnp): renders the interactive view at full quality (or starts accumulating it) */
+function void
+render_full_view(ViewerContext *ctx)
+{
+	b32 timed = interactive_timer_begin(&ctx->interactive_timer);
+	if (RENDER_ACCUMULATION_SAMPLES) {
+		/* NOTE(rnp): start from a single sample; refine_scene() adds the rest while
+		 * the view is unchanged and caches the frame once it is complete */
+		ctx->accumulated_samples = 0;
+		accumulate_scene_sample(ctx, ctx->cycle_t, ctx->output_target.size, (sv2){0});
+		resolve_accumulation(ctx, &ctx->output_target);
+		interactive_timer_end(&ctx->interactive_timer, timed, 1);
+	} else {
+		render_view(ctx, &ctx->output_target, ctx->cycle_t);
+		interactive_timer_end(&ctx->interactive_timer, timed, 1);
+		frame_cache_store(ctx, frame_cache_key(ctx, cycle_t_grid_index(ctx->cycle_t)),
+		                  &ctx->output_target);
+	}
+	ctx->displayed_scale = 1;
+}
+
+function void
+update_scene(ViewerContext *ctx, f32 dt)
+{
+	TRACE_BEGIN(update_scene);
+	ctx->cycle_t += CYCLE_T_UPDATE_SPEED * dt;
+	if (ctx->cycle_t > 1) ctx->cycle_t -= 1;
+	update_interactive_scale(ctx);
+
+	FrameCacheKey key = frame_cache_key(ctx, cycle_t_grid_index(ctx->cycle_t));
+	if (ctx->gallery.shown) {
+		render_gallery(ctx, &ctx->output_target, ctx->cycle_t);
+		ctx->accumulated_samples = RENDER_ACCUMULATION_SAMPLES;
+		ctx->displayed_scale     = 1;
+	} else if (frame_cache_upload(ctx, key, &ctx->output_target)) {
+		ctx->accumulated_samples = RENDER_ACCUMULATION_SAMPLES;
+		ctx->displayed_scale     = 1;
+	} else if (!ctx->headless && ctx->interactive_scale < 1) {
+		f32 scale = ctx->interactive_scale;
+		b32 timed = interactive_timer_begin(&ctx->interactive_timer);
+		render_scene_scaled(ctx, &ctx->output_target, ctx->cycle_t, scale);
+		interactive_timer_end(&ctx->interactive_timer, timed, scale);
+		ctx->displayed_scale = scale;
+	} else {
+		render_full_view(ctx);
+	}
+
+	if (overlay_needs_mips(ctx))
+		generate_output_mips(ctx);
+	TRACE_END(update_scene);
+}
+
+/* NOTE(rnp): progressive refinement of the interactive view; returns 1 if it changed */
+function b32
+refine_scene(ViewerContext *ctx)
+{
+	b32 result = 0;
+	RenderTarget *rt = &ctx->output_target;
+	if (ctx->gallery.shown) {
+		/* NOTE(rnp): keep drawing until every impostor in view is up to date */
+		if (ctx->gallery.stale_impostors) {
+			render_gallery(ctx, rt, ctx->cycle_t);
+			result = 1;
+		}
+	} else if (ctx->displayed_scale < 1) {
+		/* NOTE(rnp): double the resolution each frame and finish at full quality */
+		f32 scale = ctx->displayed_scale * 2;
+		if (scale < 1) {
+			render_scene_scaled(ctx, rt, ctx->cycle_t, scale);
+			ctx->displayed_scale = scale;
+		} else {
+			render_full_view(ctx);
+		}
+		result = 1;
+	} else if (ctx->accumulated_samples < RENDER_ACCUMULATION_SAMPLES) {
+		accumulate_scene_sample(ctx, ctx->cycle_t, rt->size, (sv2){0});
+		resolve_accumulation(ctx, rt);
+		if (ctx->accumulated_samples == RENDER_ACCUMULATION_SAMPLES)
+			frame_cache_store(ctx, frame_cache_key(ctx, cycle_t_grid_index(ctx->cycle_t)), rt);
+		result = 1;
+	}
+	if (result && overlay_needs_mips(ctx))
+		generate_output_mips(ctx);
+	return result;
+}
+
+/* NOTE(rnp): cycle_t is computed directly from the frame index instead of being accumulated
+ * so that a frame is identical no matter which process (or in what order) it was rendered */
+function f32
+export_frame_cycle_t(u32 frame_index)
+{
+	f32 result = cycle_t_from_grid(frame_index + 1);
+	return result;
+}
+
+/* NOTE(rnp): the output's mip chain is only built when levels other than 0 are exported */
+function void
+render_export_frame(ViewerContext *ctx, u32 frame_index, u32 mip_levels, u8 *out)
+{
+	RenderTarget *rt = &ctx->output_target;
+	ctx->cycle_t = export_frame_cycle_t(frame_index);
+	gpu_timers_next_frame(&ctx->gpu_timers);
+
+	FrameCacheKey key = frame_cache_key(ctx, frame_index + 1);
+	if (frame_cache_read(&ctx->frame_cache, key, out)) {
+		/* NOTE(rnp): uploaded for display and for reading back the other export levels */
+		glTextureSubImage2D(rt->textures[0], 0, 0, 0, rt->size.w, rt->size.h, GL_RGBA,
+		                    GL_UNSIGNED_INT_8_8_8_8, out);
+		if (mip_levels & ~1u) generate_output_mips(ctx);
+	} else {
+		render_scene(ctx, rt, ctx->cycle_t);
+		if (mip_levels & ~1u) generate_output_mips(ctx);
+		/* NOTE(rnp): synchronous; the GPU zone only covers the copy, the stall waiting for
+		 * the frame to finish is in the export_readback trace zone */
+		TRACE_BEGIN(export_readback);
+		u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Readback);
+		glGetTextureImage(rt->textures[0], 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
+		                  OUTPUT_FRAME_SIZE, out);
+		gpu_timer_end(&ctx->gpu_timers, zone);
+		TRACE_END(export_readback);
+	}
+}
+
+/* NOTE(rnp): only valid directly after render_export_frame */
+function void
+read_export_mip_level(ViewerContext *ctx, u32 level, u8 *out)
+{
+	RenderTarget *rt = &ctx->output_target;
+	TRACE_BEGIN(export_readback);
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Readback);
+	glGetTextureImage(rt->textures[0], level, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
+	                  output_mip_bytes(rt->size, level), out);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+	TRACE_END(export_readback);
+}
 
-	str8 render_model = str8("render_model.frag.glsl");
-	reload_shader(&ctx->os, render_model, (sptr)model_rc, ctx->arena);
-	os_add_file_watch(&ctx->os, &ctx->arena, render_model, reload_shader, (sptr)model_rc);
+/* NOTE(rnp): renders frame_index into out followed by each other level in mip_levels
+ * (in increasing order); out must hold export_frame_bytes(mip_levels) */
+function void
+render_export_frame_levels(ViewerContext *ctx, u32 frame_index, u32 mip_levels, u8 *out)
+{
+	render_export_frame(ctx, frame_index, mip_levels, out);
+	out += OUTPUT_FRAME_SIZE;
+	for (u32 level = 1; level < EXPORT_MAX_MIP_LEVELS; level++) {
+		if (mip_levels & (1u << level)) {
+			read_export_mip_level(ctx, level, out);
+			out += output_mip_bytes(ctx->output_target.size, level);
+		}
+	}
+}
 
-	rc = &ctx->overlay_render_context;
-	ShaderReloadContext *overlay_rc = push_struct(&ctx->arena, ShaderReloadContext);
-	overlay_rc->render_context = rc;
-	overlay_rc->vertex_text = str8(""
-	"#version 460 core\n"
-	"\n"
-	"layout(location = 0) in vec2 v_position;\n"
-	"layout(location = 1) in vec2 v_texture_coordinate;\n"
-	"layout(location = 2) in vec3 v_colour;\n"
-	"layout(location = 3) in uint v_flags;\n"
-	"\n"
-	"layout(location = 0) out vec2 f_texture_coordinate;\n"
-	"layout(location = 1) out vec3 f_colour;\n"
-	"layout(location = 2) out uint f_flags;\n"
-	"\n"
-	"layout(location = 0) uniform ivec2 u_screen_size;\n"
-	"\n"
-	"void main()\n"
-	"{\n"
-	"\tf_texture_coordinate = v_texture_coordinate;\n"
-	"\tf_colour             = v_colour;\n"
-	"\tf_flags              = v_flags;\n"
-	"\tgl_Position = vec4(v_position, 0, 1);\n"
-	//"\tgl_Position = vec4(2 * (v_position / vec2(u_screen_size)) - 1, 0, 1);\n"
-	"}\n");
+function void
+export_sinks_render_frame(ViewerContext *ctx, ExportSinks *e, u32 frame_index)
+{
+	render_export_frame(ctx, frame_index, e->mip_levels, frame_sink_acquire(e->sinks));
+	frame_sink_submit(e->sinks);
+	for (u32 level = 1; level < EXPORT_MAX_MIP_LEVELS; level++) {
+		if (e->mip_levels & (1u << level)) {
+			read_export_mip_level(ctx, level, frame_sink_acquire(e->sinks + level));
+			frame_sink_submit(e->sinks + level);
+		}
+	}
+}
 
-	overlay_rc->fragment_header = str8(""
-	"#version 460 core\n\n"
-	"layout(location = 0) in  vec2 texture_coordinate;\n"
-	"layout(location = 1) in  vec3 colour;\n"
-	"layout(location = 0) out vec4 out_colour;\n"
-	"\n#line 1\n");
+/* NOTE(rnp): renders a still of arbitrary size as a grid of render target sized tiles.
+ * Tiles are resolved into the cache target and read back directly into their place in
+ * a band holding one row of tiles; each completed band is streamed to a QOI file. GPU
+ * memory is bounded by the tile size and CPU memory by a single row of tiles. */
+function b32
+export_tiled_still(ViewerContext *ctx, Arena *arena, c8 *path, sv2 size, f32 cycle_t)
+{
+	RenderTarget *tile     = &ctx->multisample_target;
+	RenderTarget *resolve  = &ctx->cache_target;
+	sv2 tiles = {.w = (size.w + tile->size.w - 1) / tile->size.w,
+	             .h = (size.h + tile->size.h - 1) / tile->size.h};
 
-	f32 overlay_vertices[] = {
-		-1,  1, 0, 0,
-		-1, -1, 0, 1,
-		 1, -1, 1, 1,
-		-1,  1, 0, 0,
-		 1, -1, 1, 1,
-		 1,  1, 1, 0,
-	};
-	glCreateVertexArrays(1, &rc->vao);
-	glCreateBuffers(1, &rc->vbo);
+	u32   *band   = push_array(arena, u32, (sz)size.w * tile->size.h);
+	Stream stream = stream_alloc(arena, ENCODED_FRAME_SIZE_BOUND(size.w, tile->size.h));
 
-	glNamedBufferData(rc->vbo, sizeof(overlay_vertices), overlay_vertices, GL_STATIC_DRAW);
+	sptr file = os_create_file(path);
+	if (file == INVALID_FILE) return 0;
 
-	glEnableVertexArrayAttrib(rc->vao, 0);
-	glEnableVertexArrayAttrib(rc->vao, 1);
-	glVertexArrayVertexBuffer(rc->vao, 0, rc->vbo, 0,               4 * sizeof(f32));
-	glVertexArrayVertexBuffer(rc->vao, 1, rc->vbo, 2 * sizeof(f32), 4 * sizeof(f32));
-	glVertexArrayAttribFormat(rc->vao, 0, 2, GL_FLOAT, 0, 0);
-	glVertexArrayAttribFormat(rc->vao, 1, 2, GL_FLOAT, 0, 2 * sizeof(f32));
-	glVertexArrayAttribBinding(rc->vao, 0, 0);
-	glVertexArrayAttribBinding(rc->vao, 1, 0);
+	QOIEncoder e;
+	qoi_encode_begin(&stream, &e, size.w, size.h);
 
-	str8 render_overlay = str8("render_overlay.frag.glsl");
-	reload_shader(&ctx->os, render_overlay, (sptr)overlay_rc, ctx->arena);
-	os_add_file_watch(&ctx->os, &ctx->arena, render_overlay, reload_shader, (sptr)overlay_rc);
+	b32 result = 1;
+	glPixelStorei(GL_PACK_ROW_LENGTH, size.w);
+	/* NOTE(rnp): QOI is stored top row first so bands are rendered from the top down */
+	for (s32 ty = 0; ty < tiles.h; ty++) {
+		s32 y0      = size.h - (ty + 1) * tile->size.h;
+		s32 skip_y  = MAX(0, -y0);
+		s32 band_h  = tile->size.h - skip_y;
+		for (s32 tx = 0; tx < tiles.w; tx++) {
+			s32 x0 = tx * tile->size.w;
+			s32 w  = MIN(tile->size.w, size.w - x0);
+			printf("Rendering Tile: [%d/%d]\n", ty * tiles.w + tx, tiles.w * tiles.h - 1);
+			render_scene_region(ctx, resolve, cycle_t, size, (sv2){.x = x0, .y = y0});
+			glGetTextureSubImage(resolve->textures[0], 0, 0, skip_y, 0, w, band_h, 1, GL_RGBA,
+			                     GL_UNSIGNED_INT_8_8_8_8, ((sz)band_h * size.w - x0) * sizeof(u32),
+			                     band + x0);
+		}
 
-	f32 unit_cube_vertices[] = {
-		 1.0f,  1.0f, -1.0f,
-		 1.0f,  1.0f, -1.0f,
-		 1.0f,  1.0f, -1.0f,
-		 1.0f, -1.0f, -1.0f,
-		 1.0f, -1.0f, -1.0f,
-		 1.0f, -1.0f, -1.0f,
-		 1.0f,  1.0f,  1.0f,
-		 1.0f,  1.0f,  1.0f,
-		 1.0f,  1.0f,  1.0f,
-		 1.0f, -1.0f,  1.0f,
-		 1.0f, -1.0f,  1.0f,
-		 1.0f, -1.0f,  1.0f,
-		-1.0f,  1.0f, -1.0f,
-		-1.0f,  1.0f, -1.0f,
-		-1.0f,  1.0f, -1.0f,
-		-1.0f, -1.0f, -1.0f,
-		-1.0f, -1.0f, -1.0f,
-		-1.0f, -1.0f, -1.0f,
-		-1.0f,  1.0f,  1.0f,
-		-1.0f,  1.0f,  1.0f,
-		-1.0f,  1.0f,  1.0f,
-		-1.0f, -1.0f,  1.0f,
-		-1.0f, -1.0f,  1.0f,
-		-1.0f, -1.0f,  1.0f
-	};
-	f32 unit_cube_normals[] = {
-		 0.0f,  0.0f, -1.0f,
-		 0.0f,  1.0f,  0.0f,
-		 1.0f,  0.0f,  0.0f,
-		 0.0f,  0.0f, -1.0f,
-		 0.0f, -1.0f,  0.0f,
-		 1.0f,  0.0f,  0.0f,
-		 0.0f,  0.0f,  1.0f,
-		 0.0f,  1.0f,  0.0f,
-		 1.0f,  0.0f,  0.0f,
-		 0.0f,  0.0f,  1.0f,
-		 0.0f, -1.0f,  0.0f,
-		 1.0f,  0.0f,  0.0f,
-		 0.0f,  0.0f, -1.0f,
-		 0.0f,  1.0f,  0.0f,
-		-1.0f,  0.0f,  0.0f,
-		 0.0f,  0.0f, -1.0f,
-		 0.0f, -1.0f,  0.0f,
-		-1.0f,  0.0f,  0.0f,
-		 0.0f,  0.0f,  1.0f,
-		 0.0f,  1.0f,  0.0f,
-		-1.0f,  0.0f,  0.0f,
-		 0.0f,  0.0f,  1.0f,
-		 0.0f, -1.0f,  0.0f,
-		-1.0f,  0.0f,  0.0f
-	};
-	u16 unit_cube_indices[] = {
-		1,  13, 19,
-		1,  19, 7,
-		9,  6,  18,
-		9,  18, 21,
-		23, 20, 14,
-		23, 14, 17,
-		16, 4,  10,
-		16, 10, 22,
-		5,  2,  8,
-		5,  8,  11,
-		15, 12, 0,
-		15, 0,  3
-	};
+		for (s32 y = band_h; y > 0; y--)
+			qoi_encode_pixels(&stream, &e, band + (y - 1) * size.w, size.w);
+		if (ty == tiles.h - 1)
+			qoi_encode_end(&stream, &e);
 
-	ctx->unit_cube = render_model_from_arrays(unit_cube_vertices, unit_cube_normals,
-	                                          unit_cube_indices, countof(unit_cube_indices));
+		result &= !stream.errors && os_write_file(file, stream_to_str8(&stream));
+		stream_reset(&stream, 0);
+	}
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+
+	os_close_file(file);
+	return result;
 }
 
-function void
-set_camera(u32 program, u32 location, v3 position, v3 normal, v3 orthogonal)
+/* NOTE(rnp): spec format: "name=v0,v1,...;name=..." with names from sweep_parameter_names.
+ * Parameters which are not mentioned keep their default value. */
+function b32
+parse_sweep_spec(str8 spec, SweepSpec *sweep)
 {
-	v3 right = cross(orthogonal, normal);
-	v3 up    = cross(normal,     right);
+	f32 defaults[SweepParameter_Count] = {
+		[SweepParameter_Threshold]    = 0,
+		[SweepParameter_Gain]         = 1,
+		[SweepParameter_DynamicRange] = DYNAMIC_RANGE,
+		[SweepParameter_Elevation]    = CAMERA_ELEVATION_ANGLE,
+	};
 
-	v3 translate;
-	position    = v3_sub((v3){0}, position);
-	translate.x = v3_dot(position, right);
-	translate.y = v3_dot(position, up);
-	translate.z = v3_dot(position, normal);
+	zero_struct(sweep);
+	b32 result = 1;
+	while (result && spec.len) {
+		sz end = 0;
+		while (end < spec.len && spec.data[end] != ';') end++;
+		str8 axis = {.len = end, .data = spec.data};
+		spec      = str8_cut_head(spec, end + 1);
+		if (spec.len < 0) spec.len = 0;
 
-	m4 transform;
-	transform.c[0] = (v4){{right.x,     up.x,        normal.x,    0}};
-	transform.c[1] = (v4){{right.y,     up.y,        normal.y,    0}};
-	transform.c[2] = (v4){{right.z,     up.z,        normal.z,    0}};
-	transform.c[3] = (v4){{translate.x, translate.y, translate.z, 1}};
-	glProgramUniformMatrix4fv(program, location, 1, 0, transform.E);
+		sz equals = 0;
+		while (equals < axis.len && axis.data[equals] != '=') equals++;
+		str8 name = {.len = equals, .data = axis.data};
+
+		SweepParameter p = 0;
+		for (; p < SweepParameter_Count; p++)
+			if (str8_equal(name, sweep_parameter_names[p]))
+				break;
+
+		result = p != SweepParameter_Count && equals < axis.len && sweep->counts[p] == 0;
+		axis   = str8_cut_head(axis, equals + 1);
+		while (result && axis.len) {
+			sz comma = 0;
+			while (comma < axis.len && axis.data[comma] != ',') comma++;
+			str8 value = {.len = comma, .data = axis.data};
+			axis       = str8_cut_head(axis, comma + 1);
+			if (axis.len < 0) axis.len = 0;
+
+			/* NOTE(rnp): [-]digits[.digits]; anything else is rejected rather than
+			 * parsed up to the first bad character */
+			u32 points = 0, digits = 0;
+			result &= value.len > 0 && sweep->counts[p] < SWEEP_MAX_VALUES;
+			for (sz i = 0; result && i < value.len; i++) {
+				u8 c    = value.data[i];
+				points += c == '.';
+				digits += BETWEEN(c, '0', '9');
+				result &= BETWEEN(c, '0', '9') || (c == '.' && points == 1) ||
+				          (i == 0 && c == '-');
+			}
+			result &= digits > 0;
+			if (result) sweep->values[p][sweep->counts[p]++] = parse_f64(value);
+		}
+		result &= sweep->counts[p] > 0;
+	}
+
+	for (u32 p = 0; p < SweepParameter_Count; p++) {
+		if (!sweep->counts[p]) {
+			sweep->values[p][0] = defaults[p];
+			sweep->counts[p]    = 1;
+		}
+	}
+
+	return result;
 }
 
-function void
-draw_volume_item(ViewerContext *ctx, VolumeDisplayItem *v, f32 rotation, f32 translate_x)
+/* NOTE(rnp): renders every combination of the sweep's values into its own output file
+ * using a single context, so volumes, shaders and GL objects are only set up once. The
+ * elevation varies slowest so that variants sharing camera geometry are rendered back
+ * to back and only differ in their shading uniforms. */
+function b32
+export_sweep(ViewerContext *ctx, SweepSpec *sweep, FrameSinkKind kind, u32 mip_levels)
 {
-	if (!v->texture) {
-		v->texture = load_complex_texture(ctx->arena, v->file_path,
-		                                  v->width, v->height, v->depth);
+	f32 base_threshold[countof(volumes)], base_gain[countof(volumes)];
+	for (u32 i = 0; i < countof(volumes); i++) {
+		base_threshold[i] = volumes[i].threshold;
+		base_gain[i]      = volumes[i].gain;
 	}
 
-	u32 program = ctx->model_render_context.shader;
-	v3 scale = v3_sub(v->max_coord_mm, v->min_coord_mm);
-	m4 S;
-	S.c[0] = (v4){{scale.x, 0,       0,       0}};
-	S.c[1] = (v4){{0,       scale.z, 0,       0}};
-	S.c[2] = (v4){{0,       0,       scale.y, 0}};
-	S.c[3] = (v4){{0,       0,       0,       1}};
+	u32 variant_count = 1;
+	for (u32 p = 0; p < SweepParameter_Count; p++)
+		variant_count *= sweep->counts[p];
 
-	m4 T;
-	T.c[0] = (v4){{1, 0, 0, translate_x}};
-	T.c[1] = (v4){{0, 1, 0, 0}};
-	T.c[2] = (v4){{0, 0, 1, 0}};
-	T.c[3] = (v4){{0, 0, 0, 1}};
+	/* NOTE(rnp): volumes are loaded lazily through scratch space at the start of
+	 * ctx->arena so anything that lives across a render must be pushed */
+	Stream manifest = stream_alloc(&ctx->arena, KB(64));
+	Stream path     = stream_alloc(&ctx->arena, KB(1));
+	b32    result   = 1;
+	for (u32 variant = 0; variant < variant_count; variant++) {
+		f32 value[SweepParameter_Count];
+		u32 index = variant;
+		for (u32 p = 0; p < SweepParameter_Count; p++) {
+			value[p] = sweep->values[p][index % sweep->counts[p]];
+			index   /= sweep->counts[p];
+		}
 
-	f32 sa = sin_f32(rotation);
-	f32 ca = cos_f32(rotation);
-	m4 R;
-	R.c[0] = (v4){{ ca, 0, sa, 0}};
-	R.c[1] = (v4){{ 0,  1, 0,  0}};
-	R.c[2] = (v4){{-sa, 0, ca, 0}};
-	R.c[3] = (v4){{ 0,  0, 0,  1}};
+		ctx->camera_angle  = -value[SweepParameter_Elevation] * PI / 180.0f;
+		ctx->dynamic_range =  value[SweepParameter_DynamicRange];
+		for (u32 i = 0; i < countof(volumes); i++) {
+			volumes[i].threshold = base_threshold[i] + value[SweepParameter_Threshold];
+			volumes[i].gain      = base_gain[i]      * value[SweepParameter_Gain];
+		}
+
+		stream_reset(&path, 0);
+		stream_append_str8(&path, str8(SWEEP_OUTPUT_PREFIX));
+		stream_append_u64_width(&path, variant, 3);
+		stream_append_str8(&path, frame_sink_extensions[kind]);
+		stream_append_str8(&manifest, stream_to_str8(&path));
 
-	m4 model_transform = m4_mul(m4_mul(R, S), T);
-	glProgramUniformMatrix4fv(program, MODEL_RENDER_MODEL_MATRIX_LOC, 1, 0, model_transform.E);
+		for (u32 p = 0; p < SweepParameter_Count; p++) {
+			stream_append_str8s(&manifest, str8(" "), sweep_parameter_names[p], str8("="));
+			stream_append_f64(&manifest, value[p], 100);
+		}
+		stream_append_byte(&manifest, '\n');
+		printf("Sweep Variant: [%u/%u]\n", variant, variant_count - 1);
+
+		if (!export_sinks_open(&ctx->export_sinks, ctx->work_queue, kind, stream_to_str8(&path),
+		                       mip_levels, ctx->output_target.size))
+		{
+			result = 0;
+			break;
+		}
+		for (u32 i = 0; i < TOTAL_OUTPUT_FRAMES; i++)
+			export_sinks_render_frame(ctx, &ctx->export_sinks, i);
+		result &= export_sinks_close(&ctx->export_sinks);
+	}
 
-	glProgramUniform1f(program,  MODEL_RENDER_CLIP_FRACTION_LOC, 1 - v->clip_fraction);
-	glProgramUniform1f(program,  MODEL_RENDER_THRESHOLD_LOC,     v->threshold);
-	glProgramUniform1f(program,  MODEL_RENDER_GAIN_LOC,          v->gain);
-	glProgramUniform1ui(program, MODEL_RENDER_SWIZZLE_LOC,       v->swizzle);
+	for (u32 i = 0; i < countof(volumes); i++) {
+		volumes[i].threshold = base_threshold[i];
+		volumes[i].gain      = base_gain[i];
+	}
+
+	result &= !manifest.errors && os_write_new_file(SWEEP_OUTPUT_PREFIX "index.txt",
+	                                                stream_to_str8(&manifest));
+	gpu_timers_write_csv(&ctx->gpu_timers, ctx->arena);
+	return result;
+}
 
-	glBindTextureUnit(0, v->texture);
-	glBindVertexArray(ctx->unit_cube.vao);
-	glDrawElements(GL_TRIANGLES, ctx->unit_cube.elements, GL_UNSIGNED_SHORT,
-	               (void *)ctx->unit_cube.elements_offset);
+/* NOTE(rnp): maps a vector in mm axes to the volume's object space */
+function v3
+slice_object_vector(v3 mm, v3 half_extent)
+{
+	v3 result = {{mm.x / half_extent.x, mm.z / half_extent.z, mm.y / half_extent.y}};
+	return result;
 }
 
+/* NOTE(rnp): slices are squares in mm about the volume's centre which cover the projection
+ * of the volume onto the plane. their vertical axis follows depth wherever the plane
+ * allows so that slices through depth read like a B-mode image */
 function void
-update_scene(ViewerContext *ctx, f32 dt)
+extract_slice(ViewerContext *ctx, MPRSliceItem *s)
 {
-	ctx->cycle_t += CYCLE_T_UPDATE_SPEED * dt;
-	if (ctx->cycle_t > 1) ctx->cycle_t -= 1;
+	VolumeDisplayItem *v     = volumes + s->volume;
+	VolumeAtlas       *atlas = ctx->volume_atlases + v->atlas;
 
-	f32 angle = ctx->cycle_t * 2 * PI;
-	ctx->camera_position.x =  0;
-	ctx->camera_position.z = -ctx->camera_radius;
-	ctx->camera_position.y =  ctx->camera_radius * tan_f32(ctx->camera_angle);
+	v3 half = v3_scale(v3_sub(v->max_coord_mm, v->min_coord_mm), 0.5f);
+	v3 n    = v3_normalize(s->normal);
+	v3 down = {{0, 0, 1}};
+	if (n.z * n.z > 0.999f) down = (v3){{0, -1, 0}};
+	v3 b = v3_normalize(v3_sub(down, v3_scale(n, v3_dot(n, down))));
+	v3 a = cross(n, b);
 
-	RenderTarget *rt = &ctx->multisample_target;
-	f32 one = 1;
-	glBindFramebuffer(GL_FRAMEBUFFER, rt->fb);
-	glClearNamedFramebufferfv(rt->fb, GL_COLOR, 0, OUTPUT_BG_CLEAR_COLOUR.E);
-	glClearNamedFramebufferfv(rt->fb, GL_DEPTH, 0, &one);
-	glViewport(0, 0, rt->size.w, rt->size.h);
+	f32 extent = 0;
+	for (u32 i = 0; i < 8; i++) {
+		v3 corner = {{(i & 1)? half.x : -half.x, (i & 2)? half.y : -half.y, (i & 4)? half.z : -half.z}};
+		f32 ca = v3_dot(corner, a), cb = v3_dot(corner, b);
+		extent = MAX(extent, MAX(ca * ca, cb * cb));
+	}
+	extent = sqrt_f32(extent);
+
+	v3 origin = v3_scale(n, s->offset_mm);
+	origin    = v3_sub(origin, v3_scale(v3_add(a, b), extent));
+	origin    = slice_object_vector(origin, half);
+	v3 u_axis = slice_object_vector(v3_scale(a, 2 * extent), half);
+	v3 v_axis = slice_object_vector(v3_scale(b, 2 * extent), half);
+
+	s32 volume_size[3]   = {atlas->size.x, atlas->size.y, atlas->size.z};
+	s32 volume_offset[3] = {0};
+	volume_offset[atlas->axis] = v->atlas_slot * volume_size[atlas->axis];
+
+	u32 program = ctx->slice_shader;
+	glProgramUniform3fv(program, SLICE_ORIGIN_LOC,          1, origin.E);
+	glProgramUniform3fv(program, SLICE_U_AXIS_LOC,          1, u_axis.E);
+	glProgramUniform3fv(program, SLICE_V_AXIS_LOC,          1, v_axis.E);
+	glProgramUniform3iv(program, SLICE_VOLUME_OFFSET_LOC,   1, volume_offset);
+	glProgramUniform3iv(program, SLICE_VOLUME_SIZE_LOC,     1, volume_size);
+	glProgramUniform1f(program,  SLICE_THRESHOLD_SCALE_LOC, pow_f32(10.0f, -v->threshold / 20.0f));
+	glProgramUniform1i(program,  SLICE_SWIZZLE_LOC,         v->swizzle);
+	glProgramUniform1ui(program, SLICE_TRANSFER_LAYER_LOC,  v->instance);
+	glProgramUniform4fv(program, SLICE_BACKGROUND_LOC,      1, OUTPUT_BG_CLEAR_COLOUR.E);
 
-	u32 program = ctx->model_render_context.shader;
 	glUseProgram(program);
+	glBindTextureUnit(0, atlas->texture);
+	glBindTextureUnit(2, ctx->transfer_function);
+	glBindImageTexture(0, s->texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glDispatchCompute((MPR_SLICE_SIZE + SLICE_GROUP_SIZE - 1) / SLICE_GROUP_SIZE,
+	                  (MPR_SLICE_SIZE + SLICE_GROUP_SIZE - 1) / SLICE_GROUP_SIZE, 1);
+}
 
-	/* TODO(rnp): set this on hot reload instead of every frame */
-	v2 points = {{RENDER_TARGET_SIZE}};
-	f32 n = 0.1f;
-	f32 f = 400.0f;
-	f32 r = n * tan_f32(ctx->camera_fov / 2 * PI / 180.0f);
-	f32 t = r * points.h / points.w;
-	f32 a = -(f + n) / (f - n);
-	f32 b = -2 * f * n / (f - n);
+/* NOTE(rnp): slices are only extracted again when their plane or the display of their
+ * volume changes */
+function void
+update_slices(ViewerContext *ctx)
+{
+	update_transfer_function(ctx, ctx->arena);
 
-	m4 projection;
-	projection.c[0] = (v4){{n / r, 0,     0,  0}};
-	projection.c[1] = (v4){{0,     n / t, 0,  0}};
-	projection.c[2] = (v4){{0,     0,     a, -1}};
-	projection.c[3] = (v4){{0,     0,     b,  0}};
-	glProgramUniformMatrix4fv(program, MODEL_RENDER_PROJ_MATRIX_LOC, 1, 0, projection.E);
+	b32 extracted = 0;
+	for (u32 i = 0; i < countof(mpr_slices); i++) {
+		MPRSliceItem      *s = mpr_slices + i;
+		VolumeDisplayItem *v = volumes + s->volume;
+		if (!v->loaded) volume_load(ctx, v);
 
-	v3 camera = ctx->camera_position;
-	set_camera(program, MODEL_RENDER_VIEW_MATRIX_LOC, camera,
-	           v3_normalize(v3_sub(camera, (v3){0})), (v3){{0, 1, 0}});
+		/* NOTE(rnp): keep the plane within reach of the volume */
+		v3  half   = v3_scale(v3_sub(v->max_coord_mm, v->min_coord_mm), 0.5f);
+		v3  n      = v3_normalize(s->normal);
+		f32 reach  = ABS(n.x) * half.x + ABS(n.y) * half.y + ABS(n.z) * half.z;
+		s->offset_mm = CLAMP(s->offset_mm, -reach, reach);
 
-	glProgramUniform1ui(program, MODEL_RENDER_LOG_SCALE_LOC,     LOG_SCALE);
-	glProgramUniform1f(program,  MODEL_RENDER_DYNAMIC_RANGE_LOC, DYNAMIC_RANGE);
+		struct {v3 normal; f32 offset_mm, threshold; u32 volume; u64 transfer_hash;} parameters = {
+			.normal        = s->normal,
+			.offset_mm     = s->offset_mm,
+			.threshold     = v->threshold,
+			.volume        = s->volume,
+			.transfer_hash = v->transfer_hash,
+		};
+		u64 hash = str8_hash((str8){.len = sizeof(parameters), .data = (u8 *)&parameters});
+		if (hash != s->hash) {
+			extract_slice(ctx, s);
+			s->hash   = hash;
+			extracted = 1;
+		}
+	}
+	if (extracted) glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
 
-	#if DRAW_ALL_VOLUMES
-	for (u32 i = 0; i < countof(volumes); i++)
-		draw_volume_item(ctx, volumes + i, angle, volumes[i].translate_x);
-	#else
-	draw_volume_item(ctx, volumes + single_volume_index, angle, 0);
-	#endif
+/* NOTE(rnp): y is the bottom of the first panel; returns the bottom of the next one */
+function s32
+draw_slices(ViewerContext *ctx, s32 size, s32 y)
+{
+	update_slices(ctx);
 
-	/* NOTE(rnp): resolve multisampled scene */
-	glBlitNamedFramebuffer(rt->fb, ctx->output_target.fb, 0, 0, rt->size.w, rt->size.h,
-	                       0, 0, rt->size.w, rt->size.h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	s32 x = ctx->window_size.w - size;
 
-	glGenerateTextureMipmap(ctx->output_target.textures[0]);
+	glUseProgram(ctx->overlay_render_context.shader);
+	glBindVertexArray(ctx->overlay_render_context.vao);
+	glEnable(GL_SCISSOR_TEST);
+	for (u32 i = 0; i < countof(mpr_slices); i++, y -= size) {
+		/* NOTE(rnp): the selected slice is framed */
+		s32 border = 0;
+		if (i == ctx->selected_slice) {
+			border = 2;
+			glScissor(x, y, size, size);
+			glClearNamedFramebufferfv(0, GL_COLOR, 0, (v4){{BOUNDING_BOX_COLOUR}}.E);
+		}
+
+		glViewport(x + border, y + border, size - 2 * border, size - 2 * border);
+		glBindTextureUnit(0, mpr_slices[i].texture);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+	glDisable(GL_SCISSOR_TEST);
+	return y;
 }
 
+/* NOTE(rnp): projections keep their aspect in mm within their panels */
 function void
+draw_projections(ViewerContext *ctx, s32 size, s32 y)
+{
+	VolumeDisplayItem *v = volumes + ctx->projection_volume - 1;
+	update_projections(ctx, v);
+
+	s32 x = ctx->window_size.w - size;
+
+	glUseProgram(ctx->overlay_render_context.shader);
+	glBindVertexArray(ctx->overlay_render_context.vao);
+	for (u32 p = 0; p < 3; p++, y -= size) {
+		v2  mm    = projection_size_mm(v, p);
+		f32 scale = size / MAX(mm.x, mm.y);
+		s32 w     = mm.x * scale, h = mm.y * scale;
+		glViewport(x + (size - w) / 2, y + (size - h) / 2, w, h);
+		glBindTextureUnit(0, v->projections[p]);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+	}
+}
+
+function ViewerFrameResult
 viewer_frame_step(ViewerContext *ctx, f32 dt)
 {
+	ViewerFrameResult result = ViewerFrameResult_Idle;
+
+	gpu_timers_next_frame(&ctx->gpu_timers);
+	viewer_handle_events(ctx);
+
+	/* NOTE(rnp): exports always use the full size targets */
+	sv2 render_size = ctx->output_frames_count ? (sv2){{RENDER_TARGET_SIZE}} : view_render_size(ctx);
+	if (render_size.w != ctx->output_target.size.w || render_size.h != ctx->output_target.size.h) {
+		init_render_targets(ctx, render_size);
+		ctx->do_update = 1;
+	}
+
 	if (ctx->do_update) {
-		update_scene(ctx, dt);
 		if (ctx->output_frames_count) {
 			u32 frame_index  = TOTAL_OUTPUT_FRAMES - ctx->output_frames_count--;
 			printf("Reading Frame: [%u/%u]\n", frame_index, (u32)TOTAL_OUTPUT_FRAMES - 1);
-			sz needed = ctx->output_target.size.w * ctx->output_target.size.h * sizeof(u32);
-			glGetTextureImage(ctx->output_target.textures[0], 0, GL_RGBA,
-			                  GL_UNSIGNED_INT_8_8_8_8, needed,
-			                  ctx->video_arena.beg + ctx->video_arena_offset);
-			ctx->video_arena_offset += needed;
+			export_sinks_render_frame(ctx, &ctx->export_sinks, frame_index);
+			/* NOTE(rnp): the export only builds a mip chain when it writes one out */
+			if (overlay_needs_mips(ctx) && !(ctx->export_sinks.mip_levels & ~1u))
+				generate_output_mips(ctx);
 			if (!ctx->output_frames_count) {
-				str8 raw = {.len  = TOTAL_OUTPUT_FRAMES * needed,
-				            .data = ctx->video_arena.beg};
-				ctx->video_arena_offset = 0;
-				os_write_new_file(RAW_OUTPUT_PATH, raw);
+				if (!export_sinks_close(&ctx->export_sinks))
+					fputs("failed to write output video\n", stderr);
+				gpu_timers_write_csv(&ctx->gpu_timers, ctx->arena);
 			}
+		} else {
+			update_scene(ctx, dt);
 		}
 		ctx->do_update = 0;
+		result |= ViewerFrameResult_Presented;
+	} else if (refine_scene(ctx)) {
+		result |= ViewerFrameResult_Presented;
+	} else if (!ctx->demo_mode && !ctx->output_frames_count && !ctx->gallery.shown &&
+	           frame_cache_prefetch(ctx))
+	{
+		result |= ViewerFrameResult_Busy;
+	}
+
+	/* NOTE(rnp): the view keeps changing while any of these are in progress */
+	if (ctx->demo_mode || ctx->output_frames_count || ctx->displayed_scale < 1 ||
+	    ctx->accumulated_samples < RENDER_ACCUMULATION_SAMPLES ||
+	    (ctx->gallery.shown && ctx->gallery.stale_impostors))
+	{
+		result |= ViewerFrameResult_Busy;
 	}
 
+	ctx->should_exit |= glfwWindowShouldClose(ctx->window);
+	/* NOTE(rnp): the window still holds the last frame; nothing to draw */
+	if (!(result & ViewerFrameResult_Presented))
+		return result;
+
 	////////////////
 	// UI Overlay
+	u32 zone = gpu_timer_begin(&ctx->gpu_timers, GPUPass_Overlay);
 	f32 one = 1;
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glClearNamedFramebufferfv(0, GL_COLOR, 0, BG_CLEAR_COLOUR.E);
 	glClearNamedFramebufferfv(0, GL_DEPTH, 0, &one);
 
-	f32 aspect_ratio = (f32)ctx->output_target.size.w / (f32)ctx->output_target.size.h;
-	sv2 target_size  = ctx->window_size;
-	if (aspect_ratio > 1) target_size.h = target_size.w / aspect_ratio;
-	else                  target_size.w = target_size.h * aspect_ratio;
-
-	if (target_size.w > ctx->window_size.w) {
-		target_size.w = ctx->window_size.w;
-		target_size.h = ctx->window_size.w / aspect_ratio;
-	} else if (target_size.h > ctx->window_size.h) {
-		target_size.h = ctx->window_size.h;
-		target_size.w = target_size.h * aspect_ratio;
-	}
-
-	sv2 size_delta = sv2_sub(ctx->window_size, target_size);
+	sv2 target_size = overlay_target_size(ctx);
+	sv2 size_delta = sv2_sub(view_area_size(ctx), target_size);
 
 	glViewport(size_delta.x / 2 + 0.5, size_delta.y / 2 + 0.5, target_size.w, target_size.h);
 
@@ -693,5 +5299,11 @@ viewer_frame_step(ViewerContext *ctx, f32 dt)
 	glBindVertexArray(ctx->overlay_render_context.vao);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 
-	ctx->should_exit |= glfwWindowShouldClose(ctx->window);
+	s32 panel = panel_size(ctx);
+	s32 y     = ctx->window_size.h - panel;
+	if (ctx->show_slices)       y = draw_slices(ctx, panel, y);
+	if (ctx->projection_volume) draw_projections(ctx, panel, y);
+	gpu_timer_end(&ctx->gpu_timers, zone);
+
+	return result;
 }
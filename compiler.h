@@ -4,6 +4,11 @@
 
 #if defined(__linux__)
   #define OS_LINUX   1
+  /* NOTE(rnp): MAP_ANONYMOUS, syscall(), etc. are hidden under plain -std=c11. this
+   * header comes before any system header so the define is seen by all of them */
+  #ifndef _DEFAULT_SOURCE
+    #define _DEFAULT_SOURCE 1
+  #endif
 #elif defined(_WIN32)
   #define OS_WINDOWS 1
 #else
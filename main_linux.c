@@ -8,13 +8,15 @@
 #include "os_linux.c"
 #include "common.c"
 
+/* NOTE(rnp): the callbacks are not run here; the changes are handed to the render thread */
 function void
-dispatch_file_watch_events(OS *os, Arena arena)
+dispatch_file_watch_events(OS *os, ViewerEventQueue *q, Arena arena)
 {
+	TRACE_BEGIN(dispatch_file_watch_events);
 	FileWatchContext *fwctx = &os->file_watch_context;
-	u8 *mem     = arena_alloc(&arena, 4096, 16, 1);
-	Stream path = stream_alloc(&arena, 256);
+	u8 *mem = arena_alloc(&arena, 4096, 16, 1);
 	struct inotify_event *event;
+	b32 changed = 0;
 
 	sz rlen;
 	while ((rlen = read(fwctx->handle, mem, 4096)) > 0) {
@@ -30,42 +32,458 @@ dispatch_file_watch_events(OS *os, Arena arena)
 				for (u32 i = 0; i < dir->count; i++) {
 					FileWatch *fw = dir->data + i;
 					if (fw->hash == hash) {
-						stream_append_str8s(&path, dir->name, str8("/"), file);
-						stream_append_byte(&path, 0);
-						stream_commit(&path, -1);
-						fw->callback(os, stream_to_str8(&path),
-						             fw->user_data, arena);
-						stream_reset(&path, 0);
+						atomic_store_u32(&fw->pending, 1);
+						changed = 1;
 						break;
 					}
 				}
 			}
 		}
 	}
+
+	/* NOTE(rnp): the wake up may be dropped if the queue is full but then the render
+	 * thread has events to handle and will see files_changed anyway */
+	if (changed) {
+		atomic_store_u32(&q->files_changed, 1);
+		viewer_event_push(q, (ViewerEvent){.kind = ViewerEventKind_Wake});
+	}
+	TRACE_END(dispatch_file_watch_events);
 }
 
-extern s32
-main(void)
+/* NOTE(rnp): glfw can only block on its own events so the file watch is waited on here
+ * and the main thread is woken with an empty event. the descriptor stays readable until
+ * the main thread has read it so this waits for that before polling again */
+typedef struct {
+	s32 handle;
+	u32 pending;
+} FileWatchWaker;
+
+function OS_THREAD_ENTRY_POINT_FN(file_watch_waker_thread)
+{
+	FileWatchWaker *waker = (FileWatchWaker *)user_context;
+	struct pollfd fds[1] = {{.fd = waker->handle, .events = POLLIN}};
+	for (;;) {
+		if (poll(fds, countof(fds), -1) > 0 && (fds[0].revents & POLLIN)) {
+			atomic_store_u32(&waker->pending, 1);
+			glfwPostEmptyEvent();
+			while (atomic_load_u32(&waker->pending))
+				os_wait_on_value(&waker->pending, 1, U32_MAX);
+		}
+	}
+	return 0;
+}
+
+/* NOTE(rnp): owns the GL context of the interactive viewer. events are picked up at the
+ * start of each frame; while idle it sleeps until one arrives */
+typedef struct {
+	ViewerContext *ctx;
+	u32            exited;
+} RenderThread;
+
+function OS_THREAD_ENTRY_POINT_FN(render_thread)
+{
+	RenderThread  *render = (RenderThread *)user_context;
+	ViewerContext *ctx    = render->ctx;
+	TRACE_THREAD("render");
+	glfwMakeContextCurrent(ctx->window);
+	while (!ctx->should_exit) {
+		u32 seen = atomic_load_u32(&ctx->events.write_index);
+		ViewerFrameResult frame = viewer_frame_step(ctx, get_frame_time_step(ctx));
+		if (frame & ViewerFrameResult_Presented)
+			glfwSwapBuffers(ctx->window);
+		if (!(frame & ViewerFrameResult_Busy))
+			os_wait_on_value(&ctx->events.write_index, seen, IDLE_WAIT_SECONDS * 1000);
+	}
+	atomic_store_u32(&render->exited, 1);
+	glfwPostEmptyEvent();
+	return 0;
+}
+
+/* NOTE(rnp): number of frames each export worker can have in flight in the reorder buffer */
+#define EXPORT_REORDER_DEPTH 2
+
+/* NOTE(rnp): number of export frames timed under each render profile by --profile-report */
+#define PROFILE_REPORT_FRAMES 16
+
+/* NOTE(rnp): profile every viewer context is created with (--profile) */
+global RenderProfileKind render_profile = RENDER_PROFILE;
+
+typedef struct {
+	s32 fd;
+	u32 next_frame;
+	sz  received;
+} ExportWorker;
+
+function ViewerContext *
+setup_viewer(Arena memory, b32 headless, u32 process_count)
 {
-	Arena memory       = os_alloc_arena(GB(1));
 	ViewerContext *ctx = push_struct(&memory, ViewerContext);
 	ctx->arena         = memory;
+	ctx->headless      = headless;
+	ctx->process_count = process_count;
+	ctx->profile.kind  = render_profile;
 
 	ctx->os.file_watch_context.handle = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
 	ctx->os.error_handle              = STDERR_FILENO;
 
 	init_viewer(ctx);
 
-	struct pollfd fds[1] = {{0}};
-	fds[0].fd     = ctx->os.file_watch_context.handle;
-	fds[0].events = POLLIN;
+	return ctx;
+}
 
-	while (!ctx->should_exit) {
-		poll(fds, countof(fds), 0);
-		if (fds[0].revents & POLLIN)
-			dispatch_file_watch_events(&ctx->os, ctx->arena);
-		viewer_frame_step(ctx, get_frame_time_step(ctx));
-		glfwSwapBuffers(ctx->window);
-		glfwPollEvents();
+/* NOTE(rnp): renders every worker_count'th frame starting at worker_index and writes
+ * them, followed by their extra mip levels, in order to fd */
+function void
+export_worker(ViewerContext *ctx, s32 fd, u32 worker_index, u32 worker_count, u32 mip_levels)
+{
+	str8 frame = str8_alloc(&ctx->arena, export_frame_bytes(ctx->output_target.size, mip_levels));
+	for (u32 i = worker_index; i < TOTAL_OUTPUT_FRAMES; i += worker_count) {
+		render_export_frame_levels(ctx, i, mip_levels, frame.data);
+		if (!os_write_file(fd, frame))
+			os_fatal(str8("export: failed to write frame\n"));
+	}
+	if (worker_index == 0) gpu_timers_write_csv(&ctx->gpu_timers, ctx->arena);
+}
+
+function void
+export_open_sinks(ExportSinks *e, WorkQueue *q, FrameSinkKind kind, u32 mip_levels)
+{
+	sv2  size = {{RENDER_TARGET_WIDTH, RENDER_TARGET_HEIGHT}};
+	str8 path = c_str_to_str8(frame_sink_output_paths[kind]);
+	if (!export_sinks_open(e, q, kind, path, mip_levels, size)) {
+		u8 buffer[256];
+		Stream err = {.data = buffer, .cap = sizeof(buffer)};
+		stream_append_str8s(&err, str8("export: failed to open: "), path, str8("\n"));
+		os_fatal(stream_to_str8(&err));
+	}
+}
+
+function void
+export_close_sinks(ExportSinks *e, FrameSinkKind kind)
+{
+	if (!export_sinks_close(e)) {
+		u8 buffer[256];
+		Stream err = {.data = buffer, .cap = sizeof(buffer)};
+		stream_append_str8s(&err, str8("export: failed to write: "),
+		                    c_str_to_str8(frame_sink_output_paths[kind]), str8("\n"));
+		os_fatal(stream_to_str8(&err));
+	}
+}
+
+function void
+export_frames(Arena memory, u32 worker_count, FrameSinkKind kind, u32 mip_levels)
+{
+	mip_levels |= 1;
+	if (worker_count <= 1) {
+		ViewerContext *ctx = setup_viewer(memory, 1, 1);
+		export_open_sinks(&ctx->export_sinks, ctx->work_queue, kind, mip_levels);
+		for (u32 i = 0; i < TOTAL_OUTPUT_FRAMES; i++)
+			export_sinks_render_frame(ctx, &ctx->export_sinks, i);
+		export_close_sinks(&ctx->export_sinks, kind);
+		gpu_timers_write_csv(&ctx->gpu_timers, ctx->arena);
+		return;
+	}
+
+	/* NOTE(rnp): each worker owns its own context and copy of the volumes; frames
+	 * are interleaved across workers so that the reorder buffer stays small */
+	ExportWorker *workers = push_array(&memory, ExportWorker, worker_count);
+	for (u32 i = 0; i < worker_count; i++) {
+		s32 pipe_fds[2];
+		if (pipe(pipe_fds) == -1) os_fatal(str8("export: failed to create pipe\n"));
+		#ifdef F_SETPIPE_SZ
+		fcntl(pipe_fds[1], F_SETPIPE_SZ, MB(1));
+		#endif
+
+		pid_t pid = fork();
+		if (pid == -1) os_fatal(str8("export: failed to spawn worker\n"));
+		if (pid == 0) {
+			close(pipe_fds[0]);
+			for (u32 j = 0; j < i; j++) close(workers[j].fd);
+			export_worker(setup_viewer(memory, 1, worker_count), pipe_fds[1], i, worker_count, mip_levels);
+			TRACE_WRITE_WORKER(i);
+			os_exit(0);
+		}
+		close(pipe_fds[1]);
+		workers[i].fd         = pipe_fds[0];
+		workers[i].next_frame = i;
+	}
+
+	/* NOTE(rnp): encoder threads are only started once all workers have been forked */
+	WorkQueue   *q     = push_struct(&memory, WorkQueue);
+	ExportSinks *sinks = push_struct(&memory, ExportSinks);
+	work_queue_init(q, 1);
+	export_open_sinks(sinks, q, kind, mip_levels);
+
+	sv2 size        = {{RENDER_TARGET_WIDTH, RENDER_TARGET_HEIGHT}};
+	sz  frame_bytes = export_frame_bytes(size, mip_levels);
+	u32 slot_count  = worker_count * EXPORT_REORDER_DEPTH;
+	u8 *slots       = push_array(&memory, u8, slot_count * frame_bytes);
+	b32 *ready     = push_array(&memory, b32, slot_count);
+	struct pollfd *fds = push_array(&memory, struct pollfd, worker_count);
+
+	u32 next_write = 0;
+	while (next_write < TOTAL_OUTPUT_FRAMES) {
+		/* NOTE(rnp): workers which are too far ahead are left blocked on their pipe */
+		for (u32 i = 0; i < worker_count; i++) {
+			u32 frame     = workers[i].next_frame;
+			b32 active    = frame < TOTAL_OUTPUT_FRAMES && frame < next_write + slot_count;
+			fds[i].fd     = active ? workers[i].fd : -1;
+			fds[i].events = POLLIN;
+		}
+		poll(fds, worker_count, -1);
+
+		for (u32 i = 0; i < worker_count; i++) {
+			if (fds[i].fd == -1 || !(fds[i].revents & (POLLIN|POLLHUP|POLLERR)))
+				continue;
+			ExportWorker *w = workers + i;
+			u32 slot = w->next_frame % slot_count;
+			u8 *data = slots + slot * frame_bytes + w->received;
+			sz  rlen = read(w->fd, data, frame_bytes - w->received);
+			if (rlen <= 0) os_fatal(str8("export: worker exited early\n"));
+			w->received += rlen;
+			if (w->received == frame_bytes) {
+				ready[slot]    = 1;
+				w->next_frame += worker_count;
+				w->received    = 0;
+			}
+		}
+
+		while (next_write < TOTAL_OUTPUT_FRAMES && ready[next_write % slot_count]) {
+			u32 slot = next_write % slot_count;
+			printf("Writing Frame: [%u/%u]\n", next_write, (u32)TOTAL_OUTPUT_FRAMES - 1);
+			u8 *data = slots + slot * frame_bytes;
+			for (u32 level = 0; level < EXPORT_MAX_MIP_LEVELS; level++) {
+				if (mip_levels & (1u << level)) {
+					sz level_bytes = output_mip_bytes(size, level);
+					mem_copy(frame_sink_acquire(sinks->sinks + level), data, level_bytes);
+					frame_sink_submit(sinks->sinks + level);
+					data += level_bytes;
+				}
+			}
+			ready[slot] = 0;
+			next_write++;
+		}
+	}
+
+	export_close_sinks(sinks, kind);
+
+	/* NOTE(rnp): a worker which crashed after handing over its last frame still fails
+	 * the export */
+	b32 workers_ok = 1;
+	for (u32 i = 0; i < worker_count; i++) {
+		s32 status;
+		workers_ok &= wait(&status) != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		close(workers[i].fd);
+	}
+	if (!workers_ok) os_fatal(str8("export: a worker failed\n"));
+}
+
+function void
+export_still(Arena memory, sv2 size)
+{
+	ViewerContext *ctx = setup_viewer(memory, 1, 1);
+	if (!export_tiled_still(ctx, &ctx->arena, STILL_OUTPUT_PATH, size, export_frame_cycle_t(0)))
+		os_fatal(str8("export: failed to write: " STILL_OUTPUT_PATH "\n"));
+}
+
+/* NOTE(rnp): times the first export frames under each render profile and prints the
+ * throughput. each profile runs in its own process so that nothing is shared between them */
+function b32
+profile_report(Arena memory)
+{
+	b32 result = 1;
+	printf("%-10s %8s %8s %10s %10s\n", "profile", "samples", "format", "frames/s", "Mpixels/s");
+	for (RenderProfileKind kind = RenderProfile_Hardware; kind < RenderProfile_Count; kind++) {
+		fflush(stdout);
+		pid_t pid = fork();
+		if (pid == -1) os_fatal(str8("profile report: failed to spawn worker\n"));
+		if (pid == 0) {
+			render_profile = kind;
+			ViewerContext *ctx   = setup_viewer(memory, 1, 1);
+			RenderProfile *p     = &ctx->profile;
+			str8           frame = str8_alloc(&ctx->arena, OUTPUT_FRAME_SIZE);
+
+			/* NOTE(rnp): the first frame also loads the volumes and is not timed */
+			render_export_frame(ctx, 0, 1, frame.data);
+			f64 start = glfwGetTime();
+			for (u32 i = 1; i <= PROFILE_REPORT_FRAMES; i++)
+				render_export_frame(ctx, i % (u32)TOTAL_OUTPUT_FRAMES, 1, frame.data);
+			f64 elapsed = glfwGetTime() - start;
+
+			f64 frame_rate = PROFILE_REPORT_FRAMES / elapsed;
+			sv2 size       = ctx->output_target.size;
+			printf("%-10.*s %8u %8s %10.2f %10.2f\n", (s32)render_profile_names[p->kind].len,
+			       (c8 *)render_profile_names[p->kind].data, p->msaa_samples,
+			       p->volume_format == GL_RG16F ? "rg16f" : "rg32f", frame_rate,
+			       frame_rate * size.w * size.h / 1e6);
+			fflush(stdout);
+			os_exit(0);
+		}
+		s32 status;
+		if (wait(&status) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			printf("%-10.*s failed\n", (s32)render_profile_names[kind].len,
+			       (c8 *)render_profile_names[kind].data);
+			result = 0;
+		}
+	}
+	return result;
+}
+
+function void __attribute__((noreturn))
+usage(char *argv0)
+{
+	printf("usage: %s [--export [worker_count]] [--format raw|qoi|mjpeg] [--still [WxH]]\n"
+	       "       [--sweep spec] [--mip-levels l0,l1,...] [--projections]\n"
+	       "       [--profile auto|hardware|software] [--profile-report]\n"
+	       "    --export: render all output frames and exit\n"
+	       "              worker_count: number of rendering processes (default 1)\n"
+	       "    --still:  render the first output frame at WxH (default "
+	       str(STILL_OUTPUT_WIDTH) "x" str(STILL_OUTPUT_HEIGHT) ") to '" STILL_OUTPUT_PATH "'\n"
+	       "              and exit; may exceed the render target size\n"
+	       "    --sweep:  render all output frames for every combination of parameter values\n"
+	       "              and exit. spec: 'name=v0,v1,...;name=...' where name is one of\n"
+	       "              threshold (dB offset), gain (scale), dynamic_range (dB) or\n"
+	       "              elevation (degrees). output: '" SWEEP_OUTPUT_PREFIX "*'\n"
+	       "    --projections: write the maximum intensity projections of each volume along\n"
+	       "              each axis to '" PROJECTION_OUTPUT_PREFIX "*' and exit\n"
+	       "    --profile: render profile (default %.*s); auto picks software for CPU\n"
+	       "              rasterisers such as llvmpipe\n"
+	       "    --profile-report: print the export throughput under each profile and exit\n"
+	       "    --mip-levels: output target mip levels exported along with each frame\n"
+	       "              (level 0 is always written). level N is written next to the\n"
+	       "              full size output with '_mipN' before the extension\n"
+	       "    --format: output encoding (default %.*s)\n"
+	       "              raw:   '" RAW_OUTPUT_PATH "'\n"
+	       "              qoi:   '" QOI_OUTPUT_PATH "' (concatenated images)\n"
+	       "              mjpeg: '" AVI_OUTPUT_PATH "'\n", argv0,
+	       (s32)render_profile_names[RENDER_PROFILE].len,
+	       (c8 *)render_profile_names[RENDER_PROFILE].data,
+	       (s32)frame_sink_kind_names[OUTPUT_FORMAT].len,
+	       (c8 *)frame_sink_kind_names[OUTPUT_FORMAT].data);
+	os_exit(1);
+}
+
+extern s32
+main(s32 argc, char *argv[])
+{
+	Arena memory = os_alloc_arena(GB(1));
+	TRACE_THREAD("main");
+
+	b32 export = 0, sweep = 0, projections = 0, report = 0;
+	u32 worker_count  = 1;
+	u32 mip_levels    = OUTPUT_MIP_LEVELS;
+	FrameSinkKind kind = OUTPUT_FORMAT;
+	SweepSpec sweep_spec;
+	for (s32 i = 1; i < argc; i++) {
+		str8 arg = c_str_to_str8(argv[i]);
+		if (str8_equal(arg, str8("--export"))) {
+			export = 1;
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				worker_count = parse_u64(c_str_to_str8(argv[++i]));
+				if (worker_count == 0) usage(argv[0]);
+			}
+		} else if (str8_equal(arg, str8("--still"))) {
+			sv2 size = {{STILL_OUTPUT_WIDTH, STILL_OUTPUT_HEIGHT}};
+			if (i + 1 < argc && argv[i + 1][0] != '-') {
+				str8 dims = c_str_to_str8(argv[++i]);
+				sz   x    = 0;
+				while (x < dims.len && dims.data[x] != 'x') x++;
+				size.w = parse_u64((str8){.len = x, .data = dims.data});
+				size.h = x < dims.len ? parse_u64((str8){.len = dims.len - x - 1,
+				                                         .data = dims.data + x + 1}) : 0;
+				if (size.w <= 0 || size.h <= 0) usage(argv[0]);
+			}
+			export_still(memory, size);
+			TRACE_WRITE();
+			return 0;
+		} else if (str8_equal(arg, str8("--sweep")) && i + 1 < argc) {
+			sweep = 1;
+			if (!parse_sweep_spec(c_str_to_str8(argv[++i]), &sweep_spec))
+				usage(argv[0]);
+		} else if (str8_equal(arg, str8("--projections"))) {
+			projections = 1;
+		} else if (str8_equal(arg, str8("--profile")) && i + 1 < argc) {
+			str8 name = c_str_to_str8(argv[++i]);
+			for (render_profile = 0; render_profile < RenderProfile_Count; render_profile++)
+				if (str8_equal(name, render_profile_names[render_profile]))
+					break;
+			if (render_profile == RenderProfile_Count) usage(argv[0]);
+		} else if (str8_equal(arg, str8("--profile-report"))) {
+			report = 1;
+		} else if (str8_equal(arg, str8("--mip-levels")) && i + 1 < argc) {
+			str8 levels = c_str_to_str8(argv[++i]);
+			mip_levels  = 0;
+			while (levels.len) {
+				if (!BETWEEN(*levels.data, '0', '9')) usage(argv[0]);
+				u64 level = parse_u64(levels);
+				if (level >= EXPORT_MAX_MIP_LEVELS) usage(argv[0]);
+				mip_levels |= 1u << level;
+				while (levels.len && *levels.data != ',') { levels.data++; levels.len--; }
+				if (levels.len) { levels.data++; levels.len--; }
+			}
+		} else if (str8_equal(arg, str8("--format")) && i + 1 < argc) {
+			str8 name = c_str_to_str8(argv[++i]);
+			for (kind = 0; kind < FrameSinkKind_Count; kind++)
+				if (str8_equal(name, frame_sink_kind_names[kind]))
+					break;
+			if (kind == FrameSinkKind_Count) usage(argv[0]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	if (report) {
+		if (!profile_report(memory))
+			os_fatal(str8("profile report: a profile failed\n"));
+		return 0;
+	}
+
+	if (sweep) {
+		ViewerContext *ctx = setup_viewer(memory, 1, 1);
+		if (!export_sweep(ctx, &sweep_spec, kind, mip_levels))
+			os_fatal(str8("sweep: failed to write output\n"));
+		TRACE_WRITE();
+		return 0;
+	}
+
+	if (projections) {
+		ViewerContext *ctx = setup_viewer(memory, 1, 1);
+		if (!export_projections(ctx))
+			os_fatal(str8("projections: failed to write output\n"));
+		TRACE_WRITE();
+		return 0;
+	}
+
+	if (export) {
+		export_frames(memory, worker_count, kind, mip_levels);
+		TRACE_WRITE();
+		return 0;
+	}
+
+	ViewerContext *ctx = setup_viewer(memory, 0, 1);
+
+	FileWatchWaker *waker = push_struct(&ctx->arena, FileWatchWaker);
+	waker->handle = ctx->os.file_watch_context.handle;
+	os_create_thread(file_watch_waker_thread, (sptr)waker);
+
+	RenderThread *render = push_struct(&ctx->arena, RenderThread);
+	render->ctx = ctx;
+	glfwMakeContextCurrent(0);
+	os_create_thread(render_thread, (sptr)render);
+
+	/* NOTE(rnp): the main thread only records events; it has its own memory since the
+	 * render thread uses the context's arena for scratch space */
+	Arena events_arena = os_alloc_arena(KB(16));
+	while (!atomic_load_u32(&render->exited)) {
+		glfwWaitEvents();
+		/* NOTE(rnp): closing the window is only noticed by the render thread once it wakes */
+		if (glfwWindowShouldClose(ctx->window))
+			viewer_event_push(&ctx->events, (ViewerEvent){.kind = ViewerEventKind_Wake});
+		if (atomic_load_u32(&waker->pending)) {
+			dispatch_file_watch_events(&ctx->os, &ctx->events, events_arena);
+			atomic_store_u32(&waker->pending, 0);
+			os_wake_waiters(&waker->pending);
+		}
 	}
+	TRACE_WRITE();
 }
@@ -50,7 +50,8 @@ dispatch_file_watch(OS *os, FileWatchDirectory *fw_dir, u8 *buf, Arena arena)
 	} while (offset);
 }
 
-function void
+/* NOTE(rnp): returns 1 if any completions were handled */
+function b32
 clear_io_queue(OS *os, Arena arena)
 {
 	w32_context *ctx = (w32_context *)os->context;
@@ -59,7 +60,9 @@ clear_io_queue(OS *os, Arena arena)
 	w32_overlapped *overlapped;
 	u32  bytes_read;
 	uptr user_data;
+	b32  result = 0;
 	while (GetQueuedCompletionStatus(handle, &bytes_read, &user_data, &overlapped, 0)) {
+		result = 1;
 		w32_io_completion_event *event = (w32_io_completion_event *)user_data;
 		switch (event->tag) {
 		case W32_IO_FILE_WATCH: {
@@ -72,6 +75,7 @@ clear_io_queue(OS *os, Arena arena)
 		case W32_IO_PIPE: break;
 		}
 	}
+	return result;
 }
 
 extern s32
@@ -80,6 +84,7 @@ main(void)
 	Arena memory       = os_alloc_arena(GB(1));
 	ViewerContext *ctx = push_struct(&memory, ViewerContext);
 	ctx->arena         = memory;
+	TRACE_THREAD("main");
 
 	w32_context w32_ctx = {0};
 	w32_ctx.io_completion_handle = CreateIoCompletionPort(INVALID_FILE, 0, 0, 0);
@@ -89,10 +94,18 @@ main(void)
 
 	init_viewer(ctx);
 
+	/* NOTE(rnp): file watch completions do not wake glfw; while idle they are picked up
+	 * at least every IDLE_WAIT_SECONDS */
 	while (!ctx->should_exit) {
-		clear_io_queue(&ctx->os, ctx->arena);
-		viewer_frame_step(ctx, get_frame_time_step(ctx));
-		glfwSwapBuffers(ctx->window);
-		glfwPollEvents();
+		if (clear_io_queue(&ctx->os, ctx->arena))
+			ctx->do_update = 1;
+
+		ViewerFrameResult frame = viewer_frame_step(ctx, get_frame_time_step(ctx));
+		if (frame & ViewerFrameResult_Presented)
+			glfwSwapBuffers(ctx->window);
+
+		if (frame & ViewerFrameResult_Busy) glfwPollEvents();
+		else                                glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
 	}
+	TRACE_WRITE();
 }
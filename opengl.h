@@ -7,77 +7,137 @@
 
 #include <GL/gl.h>
 
-#define GL_DYNAMIC_STORAGE_BIT  0x0100
+#define GL_SYNC_FLUSH_COMMANDS_BIT    0x00000001
+#define GL_TEXTURE_FETCH_BARRIER_BIT  0x00000008
+#define GL_DYNAMIC_STORAGE_BIT        0x0100
+#define GL_TEXTURE_UPDATE_BARRIER_BIT 0x00000100
 
-#define GL_UNSIGNED_INT_8_8_8_8 0x8035
-#define GL_TEXTURE_3D           0x806F
-#define GL_MULTISAMPLE          0x809D
-#define GL_DEPTH_COMPONENT24    0x81A6
-#define GL_RG                   0x8227
-#define GL_RG32F                0x8230
-#define GL_PROGRAM              0x82E2
-#define GL_MIRRORED_REPEAT      0x8370
-#define GL_STATIC_DRAW          0x88E4
-#define GL_FRAGMENT_SHADER      0x8B30
-#define GL_VERTEX_SHADER        0x8B31
-#define GL_COMPILE_STATUS       0x8B81
-#define GL_LINK_STATUS          0x8B82
-#define GL_INFO_LOG_LENGTH      0x8B84
-#define GL_COLOR_ATTACHMENT0    0x8CE0
-#define GL_DEPTH_ATTACHMENT     0x8D00
-#define GL_FRAMEBUFFER          0x8D40
-#define GL_RENDERBUFFER         0x8D41
+#define GL_UNSIGNED_INT_8_8_8_8     0x8035
+#define GL_TEXTURE_3D               0x806F
+#define GL_MAX_3D_TEXTURE_SIZE      0x8073
+#define GL_MULTISAMPLE              0x809D
+#define GL_CLAMP_TO_EDGE            0x812F
+#define GL_DEPTH_COMPONENT24        0x81A6
+#define GL_DEPTH_STENCIL_ATTACHMENT 0x821A
+#define GL_RG                       0x8227
+#define GL_RG16F                    0x822F
+#define GL_RG32F                    0x8230
+#define GL_PROGRAM                  0x82E2
+#define GL_MIRRORED_REPEAT          0x8370
+#define GL_DEPTH_STENCIL            0x84F9
+#define GL_RGBA16F                  0x881A
+#define GL_QUERY_RESULT             0x8866
+#define GL_QUERY_RESULT_AVAILABLE   0x8867
+#define GL_WRITE_ONLY               0x88B9
+#define GL_TIME_ELAPSED             0x88BF
+#define GL_STATIC_DRAW              0x88E4
+#define GL_PIXEL_PACK_BUFFER        0x88EB
+#define GL_DEPTH24_STENCIL8         0x88F0
+#define GL_FRAGMENT_SHADER          0x8B30
+#define GL_VERTEX_SHADER            0x8B31
+#define GL_COMPILE_STATUS           0x8B81
+#define GL_LINK_STATUS              0x8B82
+#define GL_INFO_LOG_LENGTH          0x8B84
+#define GL_TEXTURE_2D_ARRAY         0x8C1A
+#define GL_COLOR_ATTACHMENT0        0x8CE0
+#define GL_DEPTH_ATTACHMENT         0x8D00
+#define GL_FRAMEBUFFER              0x8D40
+#define GL_RENDERBUFFER             0x8D41
+#define GL_MAX_SAMPLES              0x8D57
+#define GL_TIMESTAMP                0x8E28
+#define GL_DRAW_INDIRECT_BUFFER     0x8F3F
+#define GL_SHADER_STORAGE_BUFFER    0x90D2
+#define GL_TEXTURE_2D_MULTISAMPLE_ARRAY 0x9102
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_TIMEOUT_EXPIRED          0x911B
+#define GL_COMPUTE_SHADER           0x91B9
 
 typedef char      GLchar;
 typedef ptrdiff_t GLsizeiptr;
 typedef ptrdiff_t GLintptr;
+typedef uint64_t  GLuint64;
+typedef struct __GLsync *GLsync;
 
 /* X(name, ret, params) */
 #define OGLProcedureList \
 	X(glAttachShader,                        void,   (GLuint program, GLuint shader)) \
+	X(glBeginQuery,                          void,   (GLenum target, GLuint id)) \
+	X(glBindBuffer,                          void,   (GLenum target, GLuint buffer)) \
+	X(glBindBufferBase,                      void,   (GLenum target, GLuint index, GLuint buffer)) \
 	X(glBindFramebuffer,                     void,   (GLenum target, GLuint framebuffer)) \
+	X(glBindImageTexture,                    void,   (GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format)) \
 	X(glBindTextureUnit,                     void,   (GLuint unit, GLuint texture)) \
 	X(glBindVertexArray,                     void,   (GLuint array)) \
+	X(glBlendFuncSeparate,                   void,   (GLenum srgb, GLenum drgb, GLenum salpha, GLenum dalpha)) \
 	X(glBlitNamedFramebuffer,                void,   (GLuint sfb, GLuint dfb, GLint sx0, GLint sy0, GLint sx1, GLint sy1, GLint dx0, GLint dy0, GLint dx1, GLint dy1, GLbitfield mask, GLenum filter)) \
+	X(glClearNamedFramebufferfi,             void,   (GLuint framebuffer, GLenum buffer, GLint drawbuffer, GLfloat depth, GLint stencil)) \
 	X(glClearNamedFramebufferfv,             void,   (GLuint framebuffer, GLenum buffer, GLint drawbuffer, const GLfloat *value)) \
+	X(glClientWaitSync,                      GLenum, (GLsync sync, GLbitfield flags, GLuint64 timeout)) \
 	X(glCompileShader,                       void,   (GLuint shader)) \
 	X(glCreateBuffers,                       void,   (GLsizei n, GLuint *buffers)) \
 	X(glCreateFramebuffers,                  void,   (GLsizei n, GLuint *ids)) \
 	X(glCreateProgram,                       GLuint, (void)) \
+	X(glCreateQueries,                       void,   (GLenum target, GLsizei n, GLuint *ids)) \
 	X(glCreateRenderbuffers,                 void,   (GLsizei n, GLuint *renderbuffers)) \
 	X(glCreateShader,                        GLuint, (GLenum shaderType)) \
 	X(glCreateTextures,                      void,   (GLenum target, GLsizei n, GLuint *textures)) \
 	X(glCreateVertexArrays,                  void,   (GLsizei n, GLuint *arrays)) \
 	X(glDebugMessageCallback,                void,   (void (*)(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *user), void *user)) \
+	X(glDeleteBuffers,                       void,   (GLsizei n, const GLuint *buffers)) \
+	X(glDeleteFramebuffers,                  void,   (GLsizei n, const GLuint *framebuffers)) \
 	X(glDeleteProgram,                       void,   (GLuint program)) \
+	X(glDeleteRenderbuffers,                 void,   (GLsizei n, const GLuint *renderbuffers)) \
 	X(glDeleteShader,                        void,   (GLuint shader)) \
+	X(glDeleteSync,                          void,   (GLsync sync)) \
+	X(glDeleteVertexArrays,                  void,   (GLsizei n, const GLuint *arrays)) \
+	X(glDispatchCompute,                     void,   (GLuint x, GLuint y, GLuint z)) \
+	X(glDrawArraysInstanced,                 void,   (GLenum mode, GLint first, GLsizei count, GLsizei instancecount)) \
+	X(glDrawElementsInstancedBaseInstance,   void,   (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount, GLuint baseinstance)) \
 	X(glEnableVertexArrayAttrib,             void,   (GLuint vao, GLuint index)) \
+	X(glEndQuery,                            void,   (GLenum target)) \
+	X(glFenceSync,                           GLsync, (GLenum condition, GLbitfield flags)) \
 	X(glGenerateTextureMipmap,               void,   (GLuint texture)) \
+	X(glGetNamedBufferSubData,               void,   (GLuint buffer, GLintptr offset, GLsizeiptr size, void *data)) \
 	X(glGetProgramInfoLog,                   void,   (GLuint program, GLsizei maxLength, GLsizei *length, GLchar *infoLog)) \
 	X(glGetProgramiv,                        void,   (GLuint program, GLenum pname, GLint *params)) \
+	X(glGetQueryObjectiv,                    void,   (GLuint id, GLenum pname, GLint *params)) \
+	X(glGetQueryObjectui64v,                 void,   (GLuint id, GLenum pname, GLuint64 *params)) \
 	X(glGetShaderInfoLog,                    void,   (GLuint shader, GLsizei maxLength, GLsizei *length, GLchar *infoLog)) \
 	X(glGetShaderiv,                         void,   (GLuint shader, GLenum pname, GLint *params)) \
 	X(glGetTextureImage,                     void,   (GLuint texture, GLint level, GLenum format, GLenum type, GLsizei bufSize, void *pixels)) \
+	X(glGetTextureSubImage,                  void,   (GLuint texture, GLint level, GLint xoff, GLint yoff, GLint zoff, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, GLsizei bufSize, void *pixels)) \
 	X(glLinkProgram,                         void,   (GLuint program)) \
+	X(glMaxShaderCompilerThreadsKHR,         void,   (GLuint count)) \
+	X(glMemoryBarrier,                       void,   (GLbitfield barriers)) \
+	X(glMultiDrawArraysIndirect,             void,   (GLenum mode, const void *indirect, GLsizei drawcount, GLsizei stride)) \
 	X(glNamedBufferData,                     void,   (GLuint buffer, GLsizeiptr size, const void *data, GLenum usage)) \
 	X(glNamedBufferStorage,                  void,   (GLuint buffer, GLsizeiptr size, const void *data, GLbitfield flags)) \
 	X(glNamedBufferSubData,                  void,   (GLuint buffer, GLintptr offset, GLsizei size, const void *data)) \
 	X(glNamedFramebufferRenderbuffer,        void,   (GLuint fb, GLenum attachment, GLenum renderbuffertarget, GLuint rb)) \
 	X(glNamedFramebufferTexture,             void,   (GLuint fb, GLenum attachment, GLuint texture, GLint level)) \
+	X(glNamedFramebufferTextureLayer,        void,   (GLuint fb, GLenum attachment, GLuint texture, GLint level, GLint layer)) \
 	X(glNamedRenderbufferStorageMultisample, void,   (GLuint rb, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)) \
 	X(glObjectLabel,                         void,   (GLenum identifier, GLuint name, GLsizei length, const char *label)) \
 	X(glProgramUniform1f,                    void,   (GLuint program, GLint location, GLfloat v0)) \
+	X(glProgramUniform1i,                    void,   (GLuint program, GLint location, GLint v0)) \
 	X(glProgramUniform1ui,                   void,   (GLuint program, GLint location, GLuint v0)) \
+	X(glProgramUniform3fv,                   void,   (GLuint program, GLint location, GLsizei count, const GLfloat *value)) \
+	X(glProgramUniform3iv,                   void,   (GLuint program, GLint location, GLsizei count, const GLint *value)) \
 	X(glProgramUniform4fv,                   void,   (GLuint program, GLint location, GLsizei count, const GLfloat *value)) \
 	X(glProgramUniformMatrix4fv,             void,   (GLuint program, GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)) \
+	X(glQueryCounter,                        void,   (GLuint id, GLenum target)) \
 	X(glShaderSource,                        void,   (GLuint shader, GLsizei count, const GLchar **strings, const GLint *lengths)) \
 	X(glTextureParameteri,                   void,   (GLuint texture, GLenum pname, GLint param)) \
 	X(glTextureStorage2D,                    void,   (GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)) \
 	X(glTextureStorage3D,                    void,   (GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth)) \
+	X(glTextureStorage3DMultisample,         void,   (GLuint texture, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLboolean fixedsamplelocations)) \
+	X(glTextureSubImage2D,                   void,   (GLuint texture, GLint level, GLint xoff, GLint yoff, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pix)) \
 	X(glTextureSubImage3D,                   void,   (GLuint texture, GLint level, GLint xoff, GLint yoff, GLint zoff, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pix)) \
 	X(glUseProgram,                          void,   (GLuint program)) \
 	X(glVertexArrayAttribBinding,            void,   (GLuint vao, GLuint attribindex, GLuint bindingindex)) \
 	X(glVertexArrayAttribFormat,             void,   (GLuint vao, GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset)) \
+	X(glVertexArrayAttribIFormat,            void,   (GLuint vao, GLuint attribindex, GLint size, GLenum type, GLuint relativeoffset)) \
+	X(glVertexArrayBindingDivisor,           void,   (GLuint vao, GLuint bindingindex, GLuint divisor)) \
 	X(glVertexArrayElementBuffer,            void,   (GLuint vao, GLuint buffer)) \
 	X(glVertexArrayVertexBuffer,             void,   (GLuint vao, GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride))
 
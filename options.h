@@ -4,9 +4,87 @@
 #define OUTPUT_FRAME_RATE         60
 #define OUTPUT_BG_CLEAR_COLOUR (v4){{0.05, 0.05, 0.05, 1}}
 
+/* NOTE(rnp): encoding used for exported frames: FrameSinkKind_Raw, FrameSinkKind_QOI
+ * (concatenated lossless QOI images) or FrameSinkKind_MJPEG (MJPEG AVI) */
+#define OUTPUT_FORMAT       FrameSinkKind_Raw
+#define OUTPUT_JPEG_QUALITY 90
+
+/* NOTE(rnp): bit mask of output target mip levels to export alongside the full size
+ * frames (level 0 is always written). level N is written to the output path with
+ * "_mipN" inserted before the extension; at 1080p level 1 is 540p and level 3 is 135p */
+#define OUTPUT_MIP_LEVELS ((1 << 0) | (1 << 1) | (1 << 3))
+
 #define RAW_OUTPUT_PATH "/tmp/out.raw"
+#define QOI_OUTPUT_PATH "/tmp/out.qoi"
+#define AVI_OUTPUT_PATH "/tmp/out.avi"
+
+/* NOTE(rnp): stills (--still) may be larger than the render target; they are rendered
+ * in render target sized tiles and written as a QOI image */
+#define STILL_OUTPUT_WIDTH  7680
+#define STILL_OUTPUT_HEIGHT 4320
+#define STILL_OUTPUT_PATH   "/tmp/still.qoi"
+
+/* NOTE(rnp): each variant of a parameter sweep (--sweep) is written to
+ * SWEEP_OUTPUT_PREFIX<index>.<format extension>; SWEEP_OUTPUT_PREFIX "index.txt"
+ * lists the parameters used for each file */
+#define SWEEP_OUTPUT_PREFIX "/tmp/sweep_"
+
+/* NOTE(rnp): P cycles through showing the maximum intensity projections of each volume
+ * beside the view. headless (--projections) writes them for every volume to
+ * PROJECTION_OUTPUT_PREFIX<volume>_<lateral|depth|elevation>.qoi */
+#define PROJECTION_OUTPUT_PREFIX "/tmp/projection_"
+
+/* NOTE(rnp): G shows a gallery of GALLERY_COLUMNS wide rows of volumes instead of the view
+ * and PAGE UP/PAGE DOWN scroll it by a row. the rows start at the bottom of the view and
+ * recede on a floor tilted GALLERY_TILT degrees away from the camera. GALLERY_ITEMS cells
+ * are shown; 0 shows every volume once and larger counts repeat the volumes (there is no
+ * loader for more datasets). cells outside of the view are culled, cells smaller than
+ * GALLERY_FULL_DETAIL_PIXELS (projected radius) are ray marched with proportionally fewer
+ * samples and cells smaller than GALLERY_IMPOSTOR_PIXELS are drawn as
+ * GALLERY_IMPOSTOR_SIZE sprites. At most GALLERY_IMPOSTOR_UPDATES sprites are redrawn per
+ * frame and, while rotating, only once the rotation moved on by GALLERY_IMPOSTOR_PERIOD */
+#define GALLERY_ITEMS              0
+#define GALLERY_COLUMNS            8
+#define GALLERY_CELL_MM            30.0f
+#define GALLERY_TILT               70.0f
+#define GALLERY_FULL_DETAIL_PIXELS 96.0f
+#define GALLERY_IMPOSTOR_PIXELS    32.0f
+#define GALLERY_IMPOSTOR_SIZE      64
+#define GALLERY_IMPOSTOR_UPDATES   8
+#define GALLERY_IMPOSTOR_PERIOD    (1.0f / 32.0f)  /* fraction of a full rotation */
+
+/* NOTE(rnp): rendered frames are cached by scrub position, camera and display parameters */
+#define FRAME_CACHE_MEMORY          MB(256)
+#define FRAME_CACHE_COMPRESS        1
+#define FRAME_CACHE_PREFETCH_RADIUS 8
 
 #define RENDER_MSAA_SAMPLES    8
+/* NOTE(rnp): when non zero the scene is anti-aliased by averaging this many sub-pixel
+ * jittered single sample passes in a half float target instead of using MSAA. The
+ * interactive view shows the first pass and refines while the view is unchanged */
+#define RENDER_ACCUMULATION_SAMPLES 0
+/* NOTE(rnp): when non zero (and not accumulating) interactive contexts draw each volume
+ * into its own cached multisampled colour and depth layer and composite the layers by
+ * depth. only layers whose volume, transform or camera changed are drawn again. costs
+ * 8 bytes per sample per volume at the view size (about 400MB at 1080p with 8 samples
+ * and 3 volumes) so it is off by default */
+#define VOLUME_LAYER_CACHE          0
+/* NOTE(rnp): while the view is changing the interactive view is drawn at a reduced
+ * resolution scale and sample count, chosen from measured frame times to hold the target
+ * frame time. once input stops it is refined back to full quality over a few frames */
+#define INTERACTIVE_FRAME_TIME   (1.0f / 30.0f)
+#define INTERACTIVE_MIN_SCALE    0.25f
+#define INTERACTIVE_MSAA_SAMPLES 2
+/* NOTE(rnp): RenderProfile_Auto uses RenderProfile_Software when GL_RENDERER names a CPU
+ * rasteriser (llvmpipe, softpipe, SwiftShader). it draws with the SOFTWARE_ sample counts,
+ * stores volumes as half floats (magnitudes above 65504 do not fit), does not keep a mip
+ * chain of the interactive view and never shrinks the interactive view below one
+ * SOFTWARE_RASTER_TILE square tile per rasteriser thread. sample counts are always capped
+ * at what the context supports */
+#define RENDER_PROFILE                    RenderProfile_Auto
+#define SOFTWARE_MSAA_SAMPLES             2
+#define SOFTWARE_INTERACTIVE_MSAA_SAMPLES 0
+#define SOFTWARE_RASTER_TILE              64
 #define RENDER_TARGET_WIDTH    1920
 #define RENDER_TARGET_HEIGHT   1080
 #define CAMERA_ELEVATION_ANGLE 25.0f
@@ -17,6 +95,51 @@
 
 #define DYNAMIC_RANGE 30
 #define LOG_SCALE     1
+#define DISPLAY_GAMMA 1.0f
+
+/* NOTE(rnp): TransferColourMap_Grey or TransferColourMap_HSV */
+#define TRANSFER_COLOUR_MAP TransferColourMap_Grey
+
+/* NOTE(rnp): RenderMode_Surface, RenderMode_MIP, RenderMode_EmissionAbsorption or
+ * RenderMode_Isosurface; R cycles through them at runtime */
+#define RENDER_MODE           RenderMode_Surface
+/* NOTE(rnp): upper bound on samples along each ray; steps are lengthened to fit */
+#define RAY_MARCH_MAX_SAMPLES 256
+/* NOTE(rnp): emission-absorption extinction per unit of normalized intensity over
+ * the half width of a volume */
+#define RAY_MARCH_ABSORPTION  8.0f
+/* NOTE(rnp): RenderMode_Isosurface draws the surface where the sample magnitude crosses
+ * ISOSURFACE_LEVEL dB relative to the magnitude the threshold maps to full scale. [ and ]
+ * nudge the threshold of every volume by THRESHOLD_STEP dB. ISOSURFACE_MESH_MEMORY bounds
+ * the CPU copy of one volume's mesh; only what the mesh needs is allocated */
+#define ISOSURFACE_LEVEL       -6.0f
+#define ISOSURFACE_COLOUR      0.86, 0.78, 0.66, 1
+#define ISOSURFACE_MESH_MEMORY MB(512)
+#define THRESHOLD_STEP         0.5f
+
+/* NOTE(rnp): when non zero the GPU time of each render pass is measured with timer queries.
+ * T prints the min/avg/p99 of each pass over the last frames which ran it. the same
+ * statistics for an export are written to GPU_TIMER_CSV_PATH, in the directory the viewer
+ * runs from, once it finishes; with several export workers (--export N) they are the first
+ * worker's */
+#define GPU_TIMERS         1
+#define GPU_TIMER_CSV_PATH "gpu_timers.csv"
+
+/* NOTE(rnp): builds with CPU_TRACE keep the most recent zones which fit in
+ * TRACE_THREAD_MEMORY for each thread and write them to TRACE_OUTPUT_PATH in the run
+ * directory on exit. each --export N worker process writes its own
+ * TRACE_WORKER_OUTPUT_PREFIX<worker>.json. the files load in chrome://tracing or
+ * ui.perfetto.dev */
+#define TRACE_OUTPUT_PATH          "trace.json"
+#define TRACE_WORKER_OUTPUT_PREFIX "trace_"
+#define TRACE_THREAD_MEMORY        MB(1)
+
+/* NOTE(rnp): upper bound on how long an idle viewer blocks waiting for events */
+#define IDLE_WAIT_SECONDS     0.5
+
+/* NOTE(rnp): sector volumes are resampled onto a Cartesian grid when they are loaded;
+ * 0 forces the multithreaded CPU path even when compute shaders are available */
+#define SCAN_CONVERT_ON_GPU   1
 
 typedef struct {
 	c8  *file_path;
@@ -30,7 +153,19 @@ typedef struct {
 	f32  translate_x;   /* mm to translate by when multi display is active */
 	b32  swizzle;       /* 1 -> swap y-z coordinates when sampling texture */
 	f32  gain;          /* uniform image gain */
-	u32  texture;
+	f32  step_size;     /* ray march step in voxels along the largest dimension (0 for 1) */
+	VolumeGeometry geometry; /* sector volumes need a clip_fraction greater than 0 */
+	u32  atlas;         /* index into ViewerContext.volume_atlases */
+	u32  atlas_slot;
+	u32  instance;      /* index into the volume parameter buffer */
+	v3   centre;        /* in the scene, as last written to the volume parameter buffer */
+	b32  loaded;
+	u64  transfer_hash; /* parameters the volume's transfer function layer was built with */
+	u32  projections[3]; /* maximum intensity projections along lateral, depth and elevation */
+	u64  projection_hash; /* parameters the projections were computed with */
+	u64  layer_hash;      /* parameters the volume's cached scene layer was drawn with */
+	BrickGrid bricks;
+	Isosurface isosurface;
 } VolumeDisplayItem;
 
 #define DRAW_ALL_VOLUMES 1
@@ -38,7 +173,32 @@ global u32 single_volume_index = 0;
 global VolumeDisplayItem volumes[] = {
 	/* WALKING FORCES */
 	{"./data/walking.bin", 512, 1024, 64, {{-20.5, -9.6, 5}}, {{20.5, 9.6, 50}}, 0.62, 72, 0, 0, 3.7},
+	/* NOTE(rnp): sector example. the data files carry no geometry; an entry is only scan
+	 * converted when it is marked as a sector, e.g. this one in place of the above:
+	 * {"./data/walking.bin", 512, 1024, 64, {{-20.5, -9.6, 5}}, {{20.5, 9.6, 50}}, 0.62, 72, 0, 0, 3.7, 0,
+	 *  VolumeGeometry_Sector}, */
 	/* RCA */
 	{"./data/tpw.bin", 512, 64, 1024, {{-9.6, -9.6, 5}}, {{9.6, 9.6, 50}}, 0, 92, -5 *  18.5, 1, 5},
 	{"./data/vls.bin", 512, 64, 1024, {{-9.6, -9.6, 5}}, {{9.6, 9.6, 50}}, 0, 89,  5 *  18.5, 1, 5},
 };
+
+/* NOTE(rnp): multi-planar reconstruction. M shows the slices beside the view, TAB selects
+ * a slice, UP/DOWN move it along its normal and LEFT/RIGHT rotate it about the depth
+ * axis (about the lateral axis with SHIFT held) */
+#define MPR_SLICE_SIZE     512
+#define MPR_OFFSET_STEP_MM 0.25f
+#define MPR_ROTATE_STEP    5.0f  /* degrees */
+
+typedef struct {
+	u32  volume;        /* index into volumes */
+	v3   normal;        /* in mm axes; x: lateral, y: elevation, z: depth */
+	f32  offset_mm;     /* from the centre of the volume along normal */
+	u32  texture;
+	u64  hash;          /* parameters the texture was extracted with */
+} MPRSliceItem;
+
+global MPRSliceItem mpr_slices[] = {
+	{0, {{0, 1, 0}}, 0},
+	{0, {{1, 0, 0}}, 0},
+	{1, {{0, 0, 1}}, 0},
+};
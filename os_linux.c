@@ -5,10 +5,15 @@
 #include "util.h"
 
 #include <fcntl.h>
+#include <linux/futex.h>
 #include <poll.h>
+#include <pthread.h>
 #include <sys/inotify.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 function OS_WRITE_FILE_FN(os_write_file)
@@ -51,8 +56,14 @@ function OS_ALLOC_ARENA_FN(os_alloc_arena)
 	return result;
 }
 
+function OS_RELEASE_ARENA_FN(os_release_arena)
+{
+	if (arena.beg) munmap(arena.beg, arena.end - arena.beg);
+}
+
 function OS_READ_WHOLE_FILE_FN(os_read_whole_file)
 {
+	TRACE_BEGIN(os_read_whole_file);
 	str8 result = str8("");
 
 	struct stat sb;
@@ -64,6 +75,7 @@ function OS_READ_WHOLE_FILE_FN(os_read_whole_file)
 			result = str8("");
 	}
 	if (fd >= 0) close(fd);
+	TRACE_END(os_read_whole_file);
 
 	return result;
 }
@@ -79,6 +91,56 @@ function OS_WRITE_NEW_FILE_FN(os_write_new_file)
 	return result;
 }
 
+function OS_CREATE_FILE_FN(os_create_file)
+{
+	sptr result = open(fname, O_WRONLY|O_TRUNC|O_CREAT, 0600);
+	return result;
+}
+
+function OS_SET_FILE_POSITION_FN(os_set_file_position)
+{
+	b32 result = lseek(file, offset, SEEK_SET) == offset;
+	return result;
+}
+
+function void
+os_close_file(sptr file)
+{
+	close(file);
+}
+
+function u32
+os_get_processor_count(void)
+{
+	s64 result = sysconf(_SC_NPROCESSORS_ONLN);
+	return result > 0 ? result : 1;
+}
+
+function OS_CREATE_THREAD_FN(os_create_thread)
+{
+	pthread_t result;
+	if (pthread_create(&result, 0, (void *(*)(void *))entry_point, (void *)user_context))
+		result = 0;
+	return (sptr)result;
+}
+
+function OS_WAIT_ON_VALUE_FN(os_wait_on_value)
+{
+	struct timespec *timeout = 0, timeout_value;
+	if (timeout_ms != U32_MAX) {
+		timeout_value.tv_sec  = timeout_ms / 1000;
+		timeout_value.tv_nsec = (timeout_ms % 1000) * 1000000;
+		timeout = &timeout_value;
+	}
+	b32 result = syscall(SYS_futex, value, FUTEX_WAIT_PRIVATE, current, timeout, 0, 0) == 0;
+	return result;
+}
+
+function OS_WAKE_WAITERS_FN(os_wake_waiters)
+{
+	syscall(SYS_futex, value, FUTEX_WAKE_PRIVATE, I32_MAX, 0, 0, 0);
+}
+
 function OS_ADD_FILE_WATCH_FN(os_add_file_watch)
 {
 	str8 directory = path;
@@ -104,4 +166,5 @@ function OS_ADD_FILE_WATCH_FN(os_add_file_watch)
 	fw->user_data = user_data;
 	fw->callback  = callback;
 	fw->hash      = str8_hash(path);
+	fw->name      = push_str8_zero(a, path);
 }
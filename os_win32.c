@@ -28,6 +28,8 @@
 #define CREATE_ALWAYS  2
 #define OPEN_EXISTING  3
 
+#define FILE_BEGIN     0
+
 #define THREAD_SET_LIMITED_INFORMATION 0x0400
 
 /* NOTE: this is packed because the w32 api designers are dumb and ordered the members
@@ -47,6 +49,20 @@ typedef struct __attribute__((packed)) {
 	u32 nFileIndexLow;
 } w32_file_info;
 
+typedef struct {
+	u16  architecture;
+	u16  _pad1;
+	u32  page_size;
+	sz   minimum_application_address;
+	sz   maximum_application_address;
+	u64  active_processor_mask;
+	u32  number_of_processors;
+	u32  processor_type;
+	u32  allocation_granularity;
+	u16  processor_level;
+	u16  processor_revision;
+} w32_system_info;
+
 typedef struct {
 	u32 next_entry_offset;
 	u32 action;
@@ -95,6 +111,7 @@ W32(void *) MapViewOfFile(sptr, u32, u32, u32, u64);
 W32(b32)    ReadDirectoryChangesW(sptr, u8 *, u32, b32, u32, u32 *, void *, void *);
 W32(b32)    ReadFile(sptr, u8 *, s32, s32 *, void *);
 W32(b32)    ReleaseSemaphore(sptr, s64, s64 *);
+W32(b32)    SetFilePointerEx(sptr, s64, s64 *, u32);
 W32(s32)    SetThreadDescription(sptr, u16 *);
 W32(b32)    WaitOnAddress(void *, void *, uz, u32);
 W32(s32)    WakeByAddressAll(void *);
@@ -128,20 +145,7 @@ function OS_ALLOC_ARENA_FN(os_alloc_arena)
 {
 	Arena result = {0};
 
-	struct {
-		u16  architecture;
-		u16  _pad1;
-		u32  page_size;
-		sz   minimum_application_address;
-		sz   maximum_application_address;
-		u64  active_processor_mask;
-		u32  number_of_processors;
-		u32  processor_type;
-		u32  allocation_granularity;
-		u16  processor_level;
-		u16  processor_revision;
-	} info;
-
+	w32_system_info info;
 	GetSystemInfo(&info);
 
 	if (capacity % info.page_size != 0)
@@ -155,8 +159,14 @@ function OS_ALLOC_ARENA_FN(os_alloc_arena)
 	return result;
 }
 
+function OS_RELEASE_ARENA_FN(os_release_arena)
+{
+	if (arena.beg) VirtualFree(arena.beg, 0, MEM_RELEASE);
+}
+
 function OS_READ_WHOLE_FILE_FN(os_read_whole_file)
 {
+	TRACE_BEGIN(os_read_whole_file);
 	str8 result = str8("");
 
 	w32_file_info fileinfo;
@@ -173,6 +183,7 @@ function OS_READ_WHOLE_FILE_FN(os_read_whole_file)
 			result = str8("");
 	}
 	if (h >= 0) CloseHandle(h);
+	TRACE_END(os_read_whole_file);
 
 	return result;
 }
@@ -196,6 +207,49 @@ function OS_WRITE_NEW_FILE_FN(os_write_new_file)
 	return result;
 }
 
+function OS_CREATE_FILE_FN(os_create_file)
+{
+	sptr result = CreateFileA(fname, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+	return result;
+}
+
+function OS_SET_FILE_POSITION_FN(os_set_file_position)
+{
+	b32 result = SetFilePointerEx(file, offset, 0, FILE_BEGIN);
+	return result;
+}
+
+function void
+os_close_file(sptr file)
+{
+	CloseHandle(file);
+}
+
+function u32
+os_get_processor_count(void)
+{
+	w32_system_info info;
+	GetSystemInfo(&info);
+	return info.number_of_processors;
+}
+
+function OS_CREATE_THREAD_FN(os_create_thread)
+{
+	sptr result = CreateThread(0, 0, (sptr)entry_point, user_context, 0, 0);
+	return result;
+}
+
+function OS_WAIT_ON_VALUE_FN(os_wait_on_value)
+{
+	b32 result = WaitOnAddress(value, &current, sizeof(*value), timeout_ms);
+	return result;
+}
+
+function OS_WAKE_WAITERS_FN(os_wake_waiters)
+{
+	WakeByAddressAll(value);
+}
+
 function OS_ADD_FILE_WATCH_FN(os_add_file_watch)
 {
 	str8 directory  = path;
@@ -236,4 +290,5 @@ function OS_ADD_FILE_WATCH_FN(os_add_file_watch)
 	fw->user_data = user_data;
 	fw->callback  = callback;
 	fw->hash      = str8_hash(path);
+	fw->name      = push_str8_zero(a, path);
 }
@@ -1,14 +1,5 @@
 /* See LICENSE for license details. */
 
-/* input:  h [0,360] | s,v [0, 1] *
- * output: rgb [0,1]              */
-vec3 hsv2rgb(vec3 hsv)
-{
-	vec3 k = mod(vec3(5, 3, 1) + hsv.x / 60, 6);
-	k = max(min(min(k, 4 - k), 1), 0);
-	return hsv.z - hsv.z * hsv.y * k;
-}
-
 bool bounding_box_test(vec3 coord, float p)
 {
 	bool result = false;
@@ -18,28 +9,172 @@ bool bounding_box_test(vec3 coord, float p)
 	return result;
 }
 
-void main()
+/* NOTE: per volume parameters; these are passed flat from the vertex shader so that
+ * they stay in registers instead of being loaded from the parameter buffer per sample */
+struct {
+	float clip_fraction;
+	float threshold_scale;
+	float step_size;
+	float brick_cutoff;
+	bool  swizzle;
+	uint  atlas_slot;
+	uint  transfer_layer;
+} volume;
+
+/* size of a single volume in the atlas */
+uvec3 volume_size()
+{
+	uvec3 result = uvec3(textureSize(u_texture, 0));
+	result[u_atlas_axis] /= u_atlas_slots;
+	return result;
+}
+
+/* NOTE: volumes are stacked along one axis of the atlas; keep samples inside this volume */
+vec3 atlas_coordinate(vec3 coord)
 {
-	float smp = length(texture(u_texture, texture_coordinate).xy);
-	float threshold_val = pow(10.0f, u_threshold / 20.0f);
-	smp = clamp(smp, 0.0f, threshold_val);
-	smp = smp / threshold_val;
-	smp = pow(smp, u_gamma);
-
-	float t = test_texture_coordinate.y;
-	smp = smp * smoothstep(-0.4, 1.1, t) * u_gain;
-
-	if (u_log_scale) {
-		smp = 20 * log(smp) / log(10);
-		smp = clamp(smp, -u_db_cutoff, 0) / -u_db_cutoff;
-		smp = 1 - smp;
+	float n = float(volume_size()[u_atlas_axis]);
+	float v = clamp(floor(coord[u_atlas_axis] * n), 0, n - 1);
+	coord[u_atlas_axis] = (volume.atlas_slot * n + v + 0.5) / (n * u_atlas_slots);
+	return coord;
+}
+
+/* maps a raw sample to display colour (rgb) and intensity (a) through the volume's
+ * transfer function; t is the unclipped depth coordinate */
+vec4 display_value(vec3 coord, float t)
+{
+	float smp = length(texture(u_texture, atlas_coordinate(coord)).xy);
+	vec2  lut = transfer_lut_coordinate(smp * volume.threshold_scale, t);
+	return texture(u_transfer, vec3(lut, volume.transfer_layer));
+}
+
+/* NOTE: rays are marched in object space where the volume is the [-1, 1] cube. Samples
+ * outside of the clipping pyramid and inside bricks which are known to be empty are skipped */
+vec4 ray_march(vec3 origin, vec3 direction)
+{
+	vec3  inv_dir = 1 / direction;
+	vec3  t0      = (-1 - origin) * inv_dir;
+	vec3  t1      = ( 1 - origin) * inv_dir;
+	vec3  tmin    = min(t0, t1);
+	vec3  tmax    = max(t0, t1);
+	float t_near  = max(max(max(tmin.x, tmin.y), tmin.z), 0);
+	float t_far   = min(min(tmax.x, tmax.y), tmax.z);
+	if (t_far <= t_near) discard;
+
+	vec3 entry    = origin + t_near * direction;
+#if DRAW_BOUNDING_BOX
+	bool on_frame = bounding_box_test((entry + 1) / 2, u_bb_fraction);
+#else
+	const bool on_frame = false;
+#endif
+
+	/* NOTE: step is given in voxels along the largest dimension; the sample
+	 * budget limits the number of steps by lengthening them */
+	vec3  size = vec3(volume_size());
+	float dt   = max(volume.step_size * 2 / max(size.x, max(size.y, size.z)),
+	                 (t_far - t_near) / u_max_samples);
+
+	/* NOTE: the ray in texture space for brick lookups */
+	vec3 tex_origin    = (origin + 1) / 2;
+	vec3 tex_direction = direction / 2;
+	if (volume.swizzle) {
+		tex_origin    = tex_origin.xzy;
+		tex_direction = tex_direction.xzy;
+	}
+	vec3 brick_extent = BRICK_SIZE / size;
+
+	ivec3 brick_offset = ivec3(0);
+	brick_offset[u_atlas_axis] = int(volume.atlas_slot * (textureSize(u_bricks, 0)[u_atlas_axis] / u_atlas_slots));
+
+	/* NOTE: the proxy geometry is only a conservative bound on the clipping pyramid;
+	 * rays which never enter it are discarded */
+	bool  hit   = false;
+	float value = 0, transmittance = 1;
+	vec3  colour = vec3(0);
+	for (int k = 0;; k++) {
+		float t = t_near + (k + 0.5) * dt;
+		if (t >= t_far) break;
+
+		vec3 p = origin + t * direction;
+		if (abs(p.x) > volume.clip_fraction + (1 - volume.clip_fraction) * (p.y + 1) / 2)
+			continue;
+
+		hit = true;
+		if (on_frame) break;
+
+		vec3 coord = (p + 1) / 2;
+		vec3 tex   = volume.swizzle? coord.xzy : coord;
+
+		/* NOTE: nothing in an empty brick maps above 0; continue from the first sample
+		 * past it so that the samples taken are the same as without skipping */
+		ivec3 brick = clamp(ivec3(tex * size), ivec3(0), ivec3(size) - 1) / BRICK_SIZE;
+		if (texelFetch(u_bricks, brick_offset + brick, 0).y <= volume.brick_cutoff) {
+			vec3  lo     = brick * brick_extent;
+			vec3  bound  = mix(lo, min(lo + brick_extent, 1), greaterThan(tex_direction, vec3(0)));
+			vec3  exits  = (bound - tex_origin) / tex_direction;
+			exits        = mix(exits, vec3(t_far), lessThan(abs(tex_direction), vec3(1e-8)));
+			float t_exit = min(min(min(exits.x, exits.y), exits.z), t_far);
+			k = max(k, int(ceil((t_exit - t_near) / dt - 0.5)) - 1);
+			continue;
+		}
+
+		vec4 smp = display_value(tex, coord.y);
+#if RENDER_MODE == RENDER_MODE_MIP
+		if (smp.a > value) {
+			value  = smp.a;
+			colour = smp.rgb;
+		}
+		/* NOTE: early ray termination; nothing can exceed a saturated sample */
+		if (value >= 1) break;
+#else
+		float alpha = 1 - exp(-smp.a * u_absorption * dt);
+		colour        += transmittance * alpha * smp.rgb;
+		transmittance *= 1 - alpha;
+		/* NOTE: early ray termination; the rest of the ray is not visible */
+		if (transmittance < 0.01) break;
+#endif
 	}
 
+	if (!hit) discard;
+	if (on_frame) return u_bb_colour;
+
+#if RENDER_MODE == RENDER_MODE_MIP
+	/* NOTE: match bricks which were never rasterized; nothing visible was sampled */
+	if (value == 0) discard;
+	vec4 result = vec4(colour, 1);
+#else
+	float alpha  = 1 - transmittance;
+	vec4  result = vec4(colour / max(alpha, 1e-6), alpha);
+#endif
+	return result;
+}
+
+void main()
+{
+	volume.clip_fraction   = volume_parameters.x;
+	volume.threshold_scale = volume_parameters.y;
+	volume.step_size       = volume_parameters.z;
+	volume.brick_cutoff    = volume_parameters.w;
+	volume.atlas_slot      = volume_indices.x;
+	volume.swizzle         = volume_indices.y != 0;
+	volume.transfer_layer  = volume_indices.z;
+
+#if RENDER_MODE == RENDER_MODE_ISOSURFACE
+	/* NOTE: head light; the mesh normals and the camera are both in object space */
+	float lambert = abs(dot(normalize(normal), normalize(ray_origin - object_position)));
+	out_colour = vec4(u_isosurface_colour.rgb * (0.2 + 0.8 * lambert), u_isosurface_colour.a);
+#elif RENDER_MODE != RENDER_MODE_SURFACE
+	out_colour = ray_march(ray_origin, normalize(object_position - ray_origin));
+#else
+	/* NOTE: the frame is tested first so its fragments skip the volume lookup */
+#if DRAW_BOUNDING_BOX
 	if (bounding_box_test(test_texture_coordinate, u_bb_fraction)) {
 		out_colour = u_bb_colour;
-	} else {
-		out_colour = vec4(smp, smp, smp, 1);
+		return;
 	}
+#endif
+	vec4 smp = display_value(texture_coordinate, test_texture_coordinate.y);
+	out_colour = vec4(smp.rgb, 1);
+#endif
 
 	//out_colour = vec4(textureQueryLod(u_texture, texture_coordinate).y, 0, 0, 1);
 	//out_colour = vec4(abs(normal), 1);
@@ -99,6 +99,26 @@ v3_sub(v3 a, v3 b)
 	return result;
 }
 
+function v3
+v3_add(v3 a, v3 b)
+{
+	v3 result;
+	result.x = a.x + b.x;
+	result.y = a.y + b.y;
+	result.z = a.z + b.z;
+	return result;
+}
+
+function v3
+v3_scale(v3 a, f32 scale)
+{
+	v3 result;
+	result.x = a.x * scale;
+	result.y = a.y * scale;
+	result.z = a.z * scale;
+	return result;
+}
+
 function f32
 v3_dot(v3 a, v3 b)
 {
@@ -156,6 +176,15 @@ m4_column(m4 a, u32 column)
 	return result;
 }
 
+function v4
+m4_mul_v4(m4 a, v4 v)
+{
+	v4 result;
+	for (u32 i = 0; i < countof(result.E); i++)
+		result.E[i] = v4_dot(m4_row(a, i), v);
+	return result;
+}
+
 function m4
 m4_mul(m4 a, m4 b)
 {
@@ -393,6 +422,24 @@ c_str_to_str8(char *cstr)
 	return result;
 }
 
+function b32
+str8_equal(str8 a, str8 b)
+{
+	b32 result = a.len == b.len;
+	for (sz i = 0; result && i < a.len; i++)
+		result = a.data[i] == b.data[i];
+	return result;
+}
+
+function b32
+str8_contains_str8(str8 s, str8 needle)
+{
+	b32 result = 0;
+	for (sz i = 0; !result && i + needle.len <= s.len; i++)
+		result = str8_equal((str8){.len = needle.len, .data = s.data + i}, needle);
+	return result;
+}
+
 /* NOTE(rnp): returns < 0 if byte is not found */
 function sz
 str8_scan_backwards(str8 s, u8 byte)
@@ -462,14 +509,6 @@ str8_to_str16(Arena *a, str8 in)
 	return result;
 }
 
-function str8
-push_str8(Arena *a, str8 str)
-{
-	str8 result = str8_alloc(a, str.len);
-	mem_copy(result.data, str.data, result.len);
-	return result;
-}
-
 function str8
 push_str8_zero(Arena *a, str8 str)
 {
@@ -508,6 +547,15 @@ parse_f64(str8 s)
 	return result;
 }
 
+function u64
+parse_u64(str8 s)
+{
+	u64 result = 0;
+	for (; s.len && BETWEEN(*s.data, '0', '9'); s.data++, s.len--)
+		result = 10 * result + (*s.data - '0');
+	return result;
+}
+
 function FileWatchDirectory *
 lookup_file_watch_directory(FileWatchContext *ctx, u64 hash)
 {
@@ -521,3 +569,38 @@ lookup_file_watch_directory(FileWatchContext *ctx, u64 hash)
 	}
 	return result;
 }
+
+#if CPU_TRACE
+global TraceContext trace_context;
+global _Thread_local TraceBuffer *trace_thread_buffer;
+
+/* NOTE(rnp): the calling thread's ring fills all of arena */
+function void
+trace_thread_init(Arena arena, str8 name)
+{
+	TraceBuffer *b = push_struct(&arena, TraceBuffer);
+	if (b) {
+		b->name     = name;
+		b->capacity = (arena.end - arena.beg) / sizeof(TraceEvent);
+		b->events   = push_array(&arena, TraceEvent, b->capacity);
+		b->tid      = atomic_add_u32(&trace_context.thread_count, 1);
+		if (b->tid < countof(trace_context.buffers)) {
+			trace_context.buffers[b->tid] = b;
+			trace_thread_buffer = b;
+		}
+	}
+}
+
+function void
+trace_record(c8 *name, u64 begin, u64 end)
+{
+	TraceBuffer *b = trace_thread_buffer;
+	if (b) {
+		TraceEvent *e = b->events + b->count % b->capacity;
+		e->name  = name;
+		e->begin = begin;
+		e->end   = end;
+		atomic_store_u64(&b->count, b->count + 1);
+	}
+}
+#endif
@@ -40,12 +40,26 @@
 #define sin_f32(x)      __builtin_sinf(x)
 #define cos_f32(x)      __builtin_cosf(x)
 #define tan_f32(x)      __builtin_tanf(x)
+#define pow_f32(a, b)   __builtin_powf(a, b)
+#define log10_f32(x)    __builtin_log10f(x)
+#define fmod_f32(a, b)  __builtin_fmodf(a, b)
+#define floor_f32(x)    __builtin_floorf(x)
+#define ctz_u32(x)      __builtin_ctz(x)
+
+#define atomic_load_u32(p)        __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define atomic_store_u32(p, v)    __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define atomic_load_u64(p)        __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define atomic_store_u64(p, v)    __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define atomic_add_u32(p, v)      __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL)
+#define atomic_cas_u32(p, e, d)   __atomic_compare_exchange_n(p, e, d, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
 
 #if ARCH_ARM64
   /* TODO? debuggers just loop here forever and need a manual PC increment (step over) */
   #define debugbreak() asm volatile ("brk 0xf000")
+  #define read_cpu_timer() ({u64 _t; asm volatile ("mrs %0, cntvct_el0" : "=r"(_t)); _t;})
 #elif ARCH_X64
   #define debugbreak() asm volatile ("int3; nop")
+  #define read_cpu_timer() __builtin_ia32_rdtsc()
 #endif
 
 #ifdef _DEBUG
@@ -62,6 +76,33 @@
 	#define assert(c)
 #endif
 
+/* NOTE(rnp): CPU trace zones. TRACE_BEGIN(name)/TRACE_END(name) bracket a zone in one
+ * scope; it is recorded into the calling thread's ring of its most recent zones. threads
+ * only record once they called TRACE_THREAD and TRACE_WRITE writes every ring out as
+ * Chrome/Perfetto trace JSON. all of it compiles out unless CPU_TRACE is set; it is by
+ * default in debug builds and build.c --trace sets it for release builds */
+#ifndef CPU_TRACE
+	#ifdef _DEBUG
+		#define CPU_TRACE 1
+	#else
+		#define CPU_TRACE 0
+	#endif
+#endif
+
+#if CPU_TRACE
+	#define TRACE_THREAD(name) trace_thread_init(os_alloc_arena(TRACE_THREAD_MEMORY), str8(name))
+	#define TRACE_BEGIN(name)  u64 trace_begin_##name = read_cpu_timer()
+	#define TRACE_END(name)    trace_record(#name, trace_begin_##name, read_cpu_timer())
+	#define TRACE_WRITE()      trace_write_json(TRACE_OUTPUT_PATH)
+	#define TRACE_WRITE_WORKER(index) trace_write_worker_json(index)
+#else
+	#define TRACE_THREAD(name)
+	#define TRACE_BEGIN(name)
+	#define TRACE_END(name)
+	#define TRACE_WRITE()
+	#define TRACE_WRITE_WORKER(index)
+#endif
+
 #define InvalidCodePath assert(0)
 #define InvalidDefaultCase default: assert(0); break
 
@@ -120,6 +161,7 @@
 
 typedef char      c8;
 typedef uint8_t   u8;
+typedef int8_t    s8;
 typedef int16_t   s16;
 typedef uint16_t  u16;
 typedef int32_t   s32;
@@ -225,6 +267,8 @@ typedef FILE_WATCH_CALLBACK_FN(file_watch_callback);
 typedef struct {
 	sptr user_data;
 	u64  hash;
+	str8 name;      /* file name within its directory */
+	u32  pending;   /* set by the thread reading the watch; see ViewerEventQueue */
 	file_watch_callback *callback;
 } FileWatch;
 
@@ -246,9 +290,36 @@ typedef struct {
 	sptr  handle;
 } FileWatchContext;
 
+typedef struct {
+	u64  begin, end;  /* read_cpu_timer() ticks */
+	c8  *name;
+} TraceEvent;
+
+typedef struct {
+	TraceEvent *events;
+	u64         count;     /* zones recorded; the last capacity of them are kept */
+	u32         capacity;
+	u32         tid;
+	str8        name;
+} TraceBuffer;
+
+#define TRACE_MAX_THREADS 64
+typedef struct {
+	TraceBuffer *buffers[TRACE_MAX_THREADS];
+	u32          thread_count;
+	/* NOTE(rnp): a tick count and the time it was read at; ticks are converted to time
+	 * with the rate measured from here to when the trace is written */
+	u64          sync_ticks;
+	f64          sync_seconds;
+} TraceContext;
+
 #define OS_ALLOC_ARENA_FN(name) Arena name(sz capacity)
 typedef OS_ALLOC_ARENA_FN(os_alloc_arena_fn);
 
+/* NOTE(rnp): arena must be as returned by os_alloc_arena() */
+#define OS_RELEASE_ARENA_FN(name) void name(Arena arena)
+typedef OS_RELEASE_ARENA_FN(os_release_arena_fn);
+
 #define OS_ADD_FILE_WATCH_FN(name) void name(OS *os, Arena *a, str8 path, \
                                              file_watch_callback *callback, sptr user_data)
 typedef OS_ADD_FILE_WATCH_FN(os_add_file_watch_fn);
@@ -262,6 +333,25 @@ typedef OS_WRITE_NEW_FILE_FN(os_write_new_file_fn);
 #define OS_WRITE_FILE_FN(name) b32 name(sptr file, str8 raw)
 typedef OS_WRITE_FILE_FN(os_write_file_fn);
 
+#define OS_CREATE_FILE_FN(name) sptr name(char *fname)
+typedef OS_CREATE_FILE_FN(os_create_file_fn);
+
+#define OS_SET_FILE_POSITION_FN(name) b32 name(sptr file, sz offset)
+typedef OS_SET_FILE_POSITION_FN(os_set_file_position_fn);
+
+#define OS_THREAD_ENTRY_POINT_FN(name) sptr name(sptr user_context)
+typedef OS_THREAD_ENTRY_POINT_FN(os_thread_entry_point_fn);
+
+#define OS_CREATE_THREAD_FN(name) sptr name(os_thread_entry_point_fn *entry_point, sptr user_context)
+typedef OS_CREATE_THREAD_FN(os_create_thread_fn);
+
+/* NOTE(rnp): blocks while *value == current; timeout_ms == U32_MAX waits forever */
+#define OS_WAIT_ON_VALUE_FN(name) b32 name(u32 *value, u32 current, u32 timeout_ms)
+typedef OS_WAIT_ON_VALUE_FN(os_wait_on_value_fn);
+
+#define OS_WAKE_WAITERS_FN(name) void name(u32 *value)
+typedef OS_WAKE_WAITERS_FN(os_wake_waiters_fn);
+
 struct OS {
 	FileWatchContext file_watch_context;
 	sptr             context;
@@ -283,29 +373,428 @@ typedef struct {
 typedef struct {
 	sptr elements_offset;
 	s32  elements;
+	u32  index_type;
 	u32  buffer;
 	u32  vao;
 } RenderModel;
 
+/* NOTE(rnp): coarse min/max of the sample magnitude over VOLUME_BRICK_SIZE^3 voxel
+ * bricks. used to skip empty space while ray marching and to build a proxy mesh which
+ * only covers the bricks that can produce a visible sample */
+typedef struct {
+	v2  *ranges;
+	uv3  size;
+
+	/* NOTE(rnp): vertex range of the proxy in the shared proxy buffer */
+	u32  proxy_first;
+	u32  proxy_count;
+	f32  proxy_cutoff;
+	f32  proxy_clip_fraction;
+} BrickGrid;
+
+/* NOTE(rnp): mesh data of one brick of an isosurface; the brick's vertices are welded and
+ * its indices refer to the whole mesh */
+typedef struct {
+	u32 first_vertex;
+	u32 vertex_count;
+	u32 first_index;
+	u32 index_count;
+} IsosurfaceBrick;
+
+/* NOTE(rnp): marching cubes surface of a volume's magnitudes. it is extracted in bricks of
+ * ISOSURFACE_BRICK_SIZE^3 cells so that a change of level only extracts the bricks which
+ * had or have a surface again; the others are copied from the previous mesh */
+typedef struct {
+	/* NOTE(rnp): the next mesh is built in the arena which does not hold the current one.
+	 * each is only allocated, and grown, once a mesh needs it */
+	Arena  mesh_memory[2];
+	u32    mesh_index;
+
+	f32   *magnitudes;
+	v2    *ranges;          /* over the corners of each brick's cells */
+	IsosurfaceBrick *bricks;
+	uv3    size;            /* in bricks */
+	f32    level;           /* magnitude the mesh is for; negative before the first extraction */
+
+	/* NOTE(rnp): CPU copy of the mesh; object space positions and normals */
+	f32   *positions;
+	f32   *normals;
+	u32   *indices;
+	u32    vertex_count;
+	u32    index_count;
+
+	RenderModel model;
+} Isosurface;
+
+/* NOTE(rnp): volumes of the same shape are stacked along their shortest axis in shared
+ * textures so that all the volumes in an atlas are drawn by a single call */
+typedef struct {
+	u32 texture;
+	u32 brick_texture;
+	uv3 size;           /* of a single volume */
+	u32 axis;           /* texture axis volumes are stacked along */
+	u32 slots;
+	u32 used;
+	u32 first_instance;
+} VolumeAtlas;
+
+/* NOTE(rnp): per volume shader parameters; std430 layout (see VOLUME_PARAMETERS_GLSL) */
+typedef struct {
+	m4  model;
+	f32 clip_fraction;
+	f32 threshold_scale; /* maps a sample magnitude to the transfer function's [0, 1] input */
+	f32 step_size;
+	f32 brick_cutoff;
+	u32 swizzle;
+	u32 atlas_slot;
+	u32 draw_order;      /* place in the back to front order (see sort_volume_draws()) */
+	u32 _pad;
+} VolumeParameters;
+
+typedef struct {
+	u32 count;
+	u32 instance_count;
+	u32 first;
+	u32 base_instance;
+} DrawArraysIndirectCommand;
+
+#define WORK_QUEUE_FN(name) void name(sptr user_data)
+typedef WORK_QUEUE_FN(work_queue_fn);
+
+typedef struct {
+	work_queue_fn *fn;
+	sptr           user_data;
+} WorkQueueItem;
+
+/* NOTE(rnp): single producer, multiple consumer */
+typedef struct {
+	WorkQueueItem items[256];
+	u32 write_index;
+	u32 read_index;
+	u32 thread_count;
+} WorkQueue;
+
+typedef struct {
+	u16 codes[256];
+	u8  sizes[256];
+} JPEGHuffmanTable;
+
+typedef struct {
+	/* NOTE(rnp): natural (row major) order */
+	f32 quantization_scale[2][64];
+	u8  quantization[2][64];
+	f32 dct[8][8];
+
+	/* NOTE(rnp): [0] luma DC, [1] luma AC, [2] chroma DC, [3] chroma AC */
+	JPEGHuffmanTable huffman[4];
+} JPEGTables;
+
+typedef struct {
+	u32 offset;
+	u32 size;
+} AVIIndexEntry;
+
+typedef enum {
+	FrameSinkKind_Raw,
+	FrameSinkKind_QOI,
+	FrameSinkKind_MJPEG,
+	FrameSinkKind_Count,
+} FrameSinkKind;
+
+typedef enum {
+	FrameSlotState_Free,
+	FrameSlotState_Queued,
+	FrameSlotState_Done,
+} FrameSlotState;
+
+typedef struct FrameSink FrameSink;
+
+typedef struct {
+	FrameSink *sink;
+	u8        *pixels;
+	Stream     encoded;
+	u32        state;
+} FrameSinkSlot;
+
+/* NOTE(rnp): frames are encoded in parallel on a work queue and written in submission order */
+struct FrameSink {
+	FrameSinkKind kind;
+	sptr          file;
+	sv2           size;
+	b32           errors;
+	WorkQueue    *work_queue;
+	Arena         memory;
+
+	FrameSinkSlot slots[16];
+	u32 slot_count;
+	u32 frames_submitted;
+	u32 frames_written;
+	sz  bytes_written;
+
+	JPEGTables     jpeg_tables;
+	AVIIndexEntry *avi_index;
+	u32            avi_index_capacity;
+	u32            largest_frame;
+};
+
+/* NOTE(rnp): one sink per exported mip level of the output target. level 0 is always
+ * written; the other levels are read back from the same render. */
+#define EXPORT_MAX_MIP_LEVELS 8
+typedef struct {
+	FrameSink sinks[EXPORT_MAX_MIP_LEVELS];
+	u32       mip_levels;
+} ExportSinks;
+
+typedef struct {
+	u64 parameters_hash;
+	f32 camera_angle;
+	f32 camera_fov;
+	f32 camera_radius;
+	u32 grid_index;
+	sv2 size;
+} FrameCacheKey;
+
+typedef struct {
+	FrameCacheKey key;
+	sz  offset;
+	sz  size;
+	b32 compressed;
+} FrameCacheEntry;
+
+/* NOTE(rnp): same definition as opengl.h, which is only included after this header */
+typedef struct __GLsync *GLsync;
+
+typedef struct {
+	Arena memory;
+	Arena scratch;
+	Arena frame;
+	sz    head;
+
+	FrameCacheEntry entries[256];
+	u32 first;
+	u32 count;
+
+	/* NOTE(rnp): prefetched frame being read back into readback_buffer */
+	FrameCacheKey readback_key;
+	GLsync        readback_fence;
+	u32           readback_buffer;
+} FrameCache;
+
+/* NOTE(rnp): values are shared with the model fragment shader (RENDER_MODE_*) */
+typedef enum {
+	RenderMode_Surface            = 0, /* shade the faces of the proxy geometry */
+	RenderMode_MIP                = 1, /* ray marched maximum intensity projection */
+	RenderMode_EmissionAbsorption = 2, /* ray marched front to back compositing */
+	RenderMode_Isosurface         = 3, /* marching cubes mesh of the threshold surface */
+	RenderMode_Count,
+} RenderMode;
+
+/* NOTE(rnp): quality settings which depend on how the context is rasterised */
+typedef enum {
+	RenderProfile_Auto,     /* chosen from GL_RENDERER when the context is created */
+	RenderProfile_Hardware,
+	RenderProfile_Software, /* CPU rasterisers such as Mesa's llvmpipe */
+	RenderProfile_Count,
+} RenderProfileKind;
+
+typedef struct {
+	RenderProfileKind kind;
+	u32 msaa_samples;
+	u32 interactive_msaa_samples;
+	u32 volume_format;      /* internal format of the volume atlases */
+	b32 output_mips;        /* keep the output's mip chain up to date for the overlay */
+	u32 rasteriser_threads; /* CPU threads the driver rasterises with; 0 for a GPU */
+} RenderProfile;
+
+/* NOTE(rnp): layout of the samples stored in a volume's data file */
+typedef enum {
+	VolumeGeometry_Cartesian, /* regular grid spanning the bounding box */
+	VolumeGeometry_Sector,    /* (angle, range, elevation) about the apex of the clipping pyramid */
+} VolumeGeometry;
+
+/* NOTE(rnp): colour applied to the display value by the transfer function */
+typedef enum {
+	TransferColourMap_Grey, /* display value in every channel */
+	TransferColourMap_HSV,  /* hue from blue (0) to red (1) with the display value as value */
+	TransferColourMap_Count,
+} TransferColourMap;
+
+/* NOTE(rnp): tells the platform layer what to do after a call to viewer_frame_step() */
+typedef enum {
+	ViewerFrameResult_Idle      = 0,      /* nothing changed; block until an event arrives */
+	ViewerFrameResult_Presented = 1 << 0, /* the window was drawn and should be swapped */
+	ViewerFrameResult_Busy      = 1 << 1, /* work remains; only poll for events */
+} ViewerFrameResult;
+
+/* NOTE(rnp): window and file events are recorded by the thread pumping them and applied
+ * by the thread rendering at the start of its next frame */
+typedef enum {
+	ViewerEventKind_Key,
+	ViewerEventKind_Scroll,
+	ViewerEventKind_Resize,
+	ViewerEventKind_Refresh,
+	ViewerEventKind_Wake,     /* only wakes the render thread */
+} ViewerEventKind;
+
+typedef struct {
+	ViewerEventKind kind;
+	union {
+		struct { s32 key, action, modifiers; } key;
+		f32 scroll;
+		sv2 size;
+	};
+} ViewerEvent;
+
+/* NOTE(rnp): single producer, single consumer. window events are dropped while the
+ * consumer is a whole queue behind. file changes must never be lost so they are flagged
+ * on their FileWatch (pending) and in files_changed instead of being queued */
+typedef struct {
+	ViewerEvent items[64];
+	u32 write_index;
+	u32 read_index;
+	u32 files_changed;
+} ViewerEventQueue;
+
+typedef enum {
+	SweepParameter_Threshold,    /* dB added to each volume's threshold */
+	SweepParameter_Gain,         /* multiplies each volume's gain */
+	SweepParameter_DynamicRange, /* dB */
+	SweepParameter_Elevation,    /* camera elevation angle in degrees */
+	SweepParameter_Count,
+} SweepParameter;
+
+#define SWEEP_MAX_VALUES 16
+typedef struct {
+	f32 values[SweepParameter_Count][SWEEP_MAX_VALUES];
+	u32 counts[SweepParameter_Count];
+} SweepSpec;
+
+/* NOTE(rnp): a cell of the gallery. far away or tiny cells are drawn as a sprite of the
+ * cell's volume which is kept in the cell's layer of the impostor texture */
+typedef struct {
+	u64 impostor_hash;     /* parameters the impostor was drawn with; 0 if never drawn */
+	f32 impostor_cycle_t;  /* rotation the impostor was drawn at */
+} GalleryItem;
+
+typedef struct {
+	GalleryItem  *items;
+	u32           item_count;
+	u32           first_row;        /* row shown at the top of the view */
+	u32           stale_impostors;  /* impostors in view left to redraw after the last frame */
+	b32           shown;
+
+	u32           impostor_texture;
+	u32           impostor_depth;
+	u32           impostor_fb;
+	u32           sprites;
+	RenderContext sprite_render_context;
+} Gallery;
+
+typedef enum {
+	GPUPass_Scene,     /* drawing the volumes, layers or gallery */
+	GPUPass_Resolve,   /* multisample resolves, scaling blits and accumulation */
+	GPUPass_Mipmaps,   /* mip chain of the output target */
+	GPUPass_Overlay,   /* drawing the output and panels into the window */
+	GPUPass_Readback,  /* GPU side of copying frames back for export or the frame cache;
+	                    * the CPU stall on synchronous copies is not part of it */
+	GPUPass_Count,
+} GPUPass;
+
+/* NOTE(rnp): each pass is bracketed by a pair of timestamp queries. a frame's queries are
+ * only read once they are available; GPU_TIMER_FRAMES frames may be in flight before the
+ * oldest one is dropped instead of waited on */
+#define GPU_TIMER_FRAMES  4
+#define GPU_TIMER_ZONES   32
+#define GPU_TIMER_HISTORY 256
+#define GPU_TIMER_NO_ZONE ((u32)-1)
+
+typedef struct {
+	u32 queries[GPU_TIMER_ZONES][2];
+	u8  passes[GPU_TIMER_ZONES];
+	u32 zone_count;
+} GPUTimerFrame;
+
+typedef struct {
+	GPUTimerFrame frames[GPU_TIMER_FRAMES];
+	u32 write_index;   /* frames[write_index % GPU_TIMER_FRAMES] is being recorded */
+	u32 read_index;    /* oldest frame not yet collected */
+	u32 dropped_frames;
+	u32 skipped_zones; /* passes left untimed because their frame ran out of zones */
+
+	/* NOTE(rnp): milliseconds of each pass for the last frames which ran it */
+	f32 history[GPUPass_Count][GPU_TIMER_HISTORY];
+	u32 history_count[GPUPass_Count];
+	b32 enabled;
+} GPUTimers;
+
+typedef struct {
+	f32 min, avg, p99;
+	u32 count;
+} GPUTimerStats;
+
+/* NOTE(rnp): GPU time of the last interactive frames and the scale each was drawn at. the
+ * results are picked up once available instead of waiting for the frame to finish; when
+ * every query is in flight frames are drawn untimed */
+#define INTERACTIVE_TIMER_FRAMES 4
+typedef struct {
+	u32 queries[INTERACTIVE_TIMER_FRAMES];
+	f32 scales[INTERACTIVE_TIMER_FRAMES];
+	u32 write_index;
+	u32 read_index;
+} InteractiveFrameTimer;
+
 typedef struct {
 	Arena arena;
 	OS    os;
 
-	RenderContext model_render_context;
+	u32           model_programs[RenderMode_Count]; /* render_model.frag.glsl built per mode */
+	u32           model_program_reloads;            /* program names are reused after reloads */
 	RenderContext overlay_render_context;
+	RenderContext accumulate_render_context;
+	RenderContext composite_render_context;
 
 	RenderTarget multisample_target;
 	RenderTarget output_target;
+	RenderTarget cache_target;
+	RenderTarget accumulation_target;
+	RenderTarget interactive_target;
+	RenderTarget volume_layers;
 	RenderModel  unit_cube;
 
+	VolumeAtlas *volume_atlases;
+	u32          volume_atlas_count;
+	u32          volume_instances;
+	u32          volume_parameters;
+	u32          volume_commands;
+	u32         *volume_draw_order;  /* volumes back to front (see sort_volume_draws()) */
+	RenderModel  volume_proxies;
+	u32          transfer_function;
+	u32          scan_convert_shader;
+	u32          slice_shader;
+	u32          projection_shader;
+
+	u32 accumulated_samples;
+
+	/* NOTE(rnp): interactive resolution governor */
+	f32 interactive_scale;  /* scale for the next frame drawn while the view is changing */
+	f32 displayed_scale;    /* scale of the frame in the output target; 1 when refined */
+	InteractiveFrameTimer interactive_timer;
+
 	sv2 window_size;
 
 	b32 demo_mode;
+	b32 show_slices;
+	u32 selected_slice;
+	u32 projection_volume;  /* 1 + index of the volume whose projections are shown; 0 for none */
 	f32 cycle_t;
 	f32 camera_angle;
 	f32 camera_fov;
 	f32 camera_radius;
 	v3  camera_position;
+	f32 dynamic_range;
+
+	RenderMode    render_mode;
+	RenderProfile profile;
 
 	u32 output_frames_count;
 
@@ -313,9 +802,15 @@ typedef struct {
 	b32 do_update;
 
 	b32 should_exit;
-
-	Arena video_arena;
-	sz    video_arena_offset;
+	b32 headless;
+	u32 process_count; /* processes exporting at once; 0 means this is the only one */
+
+	WorkQueue        *work_queue;
+	ViewerEventQueue  events;
+	ExportSinks       export_sinks;
+	FrameCache        frame_cache;
+	Gallery           gallery;
+	GPUTimers         gpu_timers;
 
 	void *window;
 } ViewerContext;